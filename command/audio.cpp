@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "audio.h"
+#include "trace.h"
 
 
 cAudio::cAudio(cDecoder *decoderParam, cIndex *indexParam, cCriteria *criteriaParam) {
@@ -46,48 +47,55 @@ void cAudio::AddMark(int type, const int packetNumber, const int64_t framePTS, c
 
 
 void cAudio::Silence() {
-    int normVolume = decoder->GetVolume();
-    if (normVolume < 0) return;  // no valid volume
-
-    // set start/end, with audio packets there is packet PTS the same as frame PTS
-    if ((normVolume == 0) && (audioMP2Silence.startAudioPTS <  0)) {
-        audioMP2Silence.startAudioPTS = decoder->GetPacketPTS();   // start of silence
+    sAudioLevel audioLevel;
+    while (decoder->GetNextAudioLevel(&audioLevel)) {  // process all audio levels from audio decode thread since last call
+        // set start/end
+        if ((audioLevel.normVolume == 0) && (audioMP2Silence.startAudioPTS <  0)) {
+            audioMP2Silence.startAudioPTS = audioLevel.pts;   // start of silence
 #ifdef DEBUG_VOLUME
-        dsyslog("cAudio::Silence(): packet (%d): start silence at audio PTS %ld detected", decoder->GetPacketNumber(), audioMP2Silence.startAudioPTS);
+            dsyslog("cAudio::Silence(): packet (%d): start silence at audio PTS %ld detected, rms %d, peak %d", decoder->GetPacketNumber(), audioMP2Silence.startAudioPTS, audioLevel.rms, audioLevel.peak);
 #endif
-    }
-    if ((normVolume >= MIN_NONSILENCE_VOLUME) && (audioMP2Silence.startAudioPTS >= 0) && (audioMP2Silence.stopAudioPTS < 0)) {
-        audioMP2Silence.stopAudioPTS = decoder->GetPacketPTS();  // end of silence
+        }
+        if ((audioLevel.normVolume >= MIN_NONSILENCE_VOLUME) && (audioMP2Silence.startAudioPTS >= 0)) {
+            audioMP2Silence.stopAudioPTS = audioLevel.pts;  // end of silence
 #ifdef DEBUG_VOLUME
-        dsyslog("cAudio::Silence(): packet (%d): stop silence at audio PTS %ld detected", decoder->GetPacketNumber(), audioMP2Silence.stopAudioPTS);
+            dsyslog("cAudio::Silence(): packet (%d): stop silence at audio PTS %ld detected, rms %d, peak %d", decoder->GetPacketNumber(), audioMP2Silence.stopAudioPTS, audioLevel.rms, audioLevel.peak);
 #endif
+            // one batch of audio levels can contain more than one silence, queue it until video packets are in index
+            silences.push_back(audioMP2Silence);
+            audioMP2Silence = {};
+        }
     }
-    // get nearesr video packet number and PTS
+    SilenceMarks();  // video packet of silence can be in index now
+}
+
+
+void cAudio::SilenceMarks() {
+    // get video packet of start of current silence as soon as possible, index has only a limited PTS ring
     if ((audioMP2Silence.startAudioPTS >= 0) && (audioMP2Silence.startPacketNumber < 0)) audioMP2Silence.startPacketNumber = index->GetPacketNumberBeforePTS(audioMP2Silence.startAudioPTS, &audioMP2Silence.startVideoPTS);
-    if ((audioMP2Silence.stopAudioPTS  >= 0) && (audioMP2Silence.stopPacketNumber  < 0)) audioMP2Silence.stopPacketNumber = index->GetPacketNumberAfterPTS(audioMP2Silence.stopAudioPTS, &audioMP2Silence.stopVideoPTS);
-    // return result
-    if ((audioMP2Silence.startPacketNumber >= 0) && (audioMP2Silence.stopPacketNumber >= 0)) {  // silence ready, can be processed
+
+    // process silences in order, stop at first silence without video packets in index
+    while (!silences.empty()) {
+        sAudioMP2Silence &silence = silences.front();
+        // get nearesr video packet number and PTS
+        if (silence.startPacketNumber < 0) silence.startPacketNumber = index->GetPacketNumberBeforePTS(silence.startAudioPTS, &silence.startVideoPTS);
+        if (silence.stopPacketNumber  < 0) silence.stopPacketNumber  = index->GetPacketNumberAfterPTS(silence.stopAudioPTS, &silence.stopVideoPTS);
+        if ((silence.startPacketNumber < 0) || (silence.stopPacketNumber < 0)) return;  // not yet in index
 
 #ifdef DEBUG_VOLUME
-        dsyslog("cAudio::Silence(): packet (%d): start: packet (%d), audio PIS %ld, video PTS %ld", decoder->GetPacketNumber(), audioMP2Silence.startPacketNumber, audioMP2Silence.startAudioPTS, audioMP2Silence.startVideoPTS);
-        dsyslog("cAudio::Silence(): packet (%d): stop:  packet (%d), audio PIS %ld, video PTS %ld", decoder->GetPacketNumber(), audioMP2Silence.stopPacketNumber, audioMP2Silence.stopAudioPTS, audioMP2Silence.stopVideoPTS);
+        dsyslog("cAudio::SilenceMarks(): packet (%d): start: packet (%d), audio PIS %ld, video PTS %ld", decoder->GetPacketNumber(), silence.startPacketNumber, silence.startAudioPTS, silence.startVideoPTS);
+        dsyslog("cAudio::SilenceMarks(): packet (%d): stop:  packet (%d), audio PIS %ld, video PTS %ld", decoder->GetPacketNumber(), silence.stopPacketNumber, silence.stopAudioPTS, silence.stopVideoPTS);
 #endif
         // very short silence with can result in reversed start/stop video packet numbers becaue of negativ PTS offset
         // swap start/stop position to fix that, don't care on position, for mark position we use PTS
-        if (audioMP2Silence.startPacketNumber > audioMP2Silence.stopPacketNumber) {
-            dsyslog("cAudio::Silence(): start (%d) > stop (%d), swap position", audioMP2Silence.startPacketNumber, audioMP2Silence.stopPacketNumber);
-            std::swap(audioMP2Silence.startPacketNumber, audioMP2Silence.stopPacketNumber);
+        if (silence.startPacketNumber > silence.stopPacketNumber) {
+            dsyslog("cAudio::SilenceMarks(): start (%d) > stop (%d), swap position", silence.startPacketNumber, silence.stopPacketNumber);
+            std::swap(silence.startPacketNumber, silence.stopPacketNumber);
         }
         // add marks
-        AddMark(MT_SOUNDSTOP,  audioMP2Silence.startPacketNumber, audioMP2Silence.startVideoPTS, 0, 0);
-        AddMark(MT_SOUNDSTART, audioMP2Silence.stopPacketNumber,  audioMP2Silence.stopVideoPTS,  0, 0);
-        // reset all values
-        audioMP2Silence.startPacketNumber = -1;
-        audioMP2Silence.startAudioPTS     = -1;
-        audioMP2Silence.startVideoPTS     = -1;
-        audioMP2Silence.stopPacketNumber  = -1;
-        audioMP2Silence.stopAudioPTS      = -1;
-        audioMP2Silence.stopVideoPTS      = -1;
+        AddMark(MT_SOUNDSTOP,  silence.startPacketNumber, silence.startVideoPTS, 0, 0);
+        AddMark(MT_SOUNDSTART, silence.stopPacketNumber,  silence.stopVideoPTS,  0, 0);
+        silences.pop_front();
     }
     return;
 }
@@ -109,11 +117,24 @@ void cAudio::ChannelChange() {
 }
 
 
+void cAudio::GetState(sDetectorState *state) const {
+    if (!state) return;
+    state->silenceStartPTS = audioMP2Silence.startAudioPTS;
+    state->silenceStopPTS  = (silences.empty()) ? -1 : silences.back().stopAudioPTS;
+}
+
+
 sMarkAdMarks *cAudio::Detect() {
     ResetMarks();
     // do audio based checks
-    if (criteria->GetDetectionState(MT_CHANNELCHANGE)) ChannelChange();
-    if (criteria->GetDetectionState(MT_SOUNDCHANGE))   Silence();
+    if (criteria->GetDetectionState(MT_CHANNELCHANGE)) {
+        cTraceSpan trace("ChannelChange", "audio");
+        ChannelChange();
+    }
+    if (criteria->GetDetectionState(MT_SOUNDCHANGE)) {
+        cTraceSpan trace("Silence", "audio");
+        Silence();
+    }
     // return list of new marks
     if (audioMarks.Count > 0) {
         return &audioMarks;
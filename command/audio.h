@@ -8,6 +8,8 @@
 #ifndef __audio_h_
 #define __audio_h_
 
+#include <deque>
+
 #include "global.h"
 #include "debug.h"
 #include "index.h"
@@ -35,6 +37,12 @@ public:
      */
     sMarkAdMarks *Detect();
 
+    /**
+     * get state of audio detectors
+     * @param[out] state detector state, video part is not changed
+     */
+    void GetState(sDetectorState *state) const;
+
 private:
     /**
      * MP2 stream silence
@@ -60,10 +68,15 @@ private:
     void ChannelChange();
 
     /**
-     * detect silence marks
+     * detect silence from audio levels of audio decode thread
      */
     void Silence();
 
+    /**
+     * add silence marks of finished silences in order if video packets of start and end of silence are known
+     */
+    void SilenceMarks();
+
     /**
      *  reset audio marks array
      */
@@ -89,7 +102,9 @@ private:
     //!<
     sMarkAdMarks audioMarks        = {};                     //!< array of marks to add to list
     //!<
-    sAudioMP2Silence audioMP2Silence   = {};                       //!< start/stop of silence
+    sAudioMP2Silence audioMP2Silence = {};                   //!< start of current silence
+    //!<
+    std::deque<sAudioMP2Silence> silences;                   //!< finished silences, wait for video packets of start and end in index
     //!<
 };
 #endif
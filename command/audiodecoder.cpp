@@ -0,0 +1,311 @@
+/*
+ * audiodecoder.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <algorithm>
+#include <math.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "audiodecoder.h"
+#include "memorybudget.h"
+#include "trace.h"
+
+
+/**
+ * audio level sums of a block of samples
+ */
+typedef struct sAudioLevelSum {
+    int64_t sumAbs    = 0;   //!< sum of absolute sample values
+    //!<
+    int64_t sumSquare = 0;   //!< sum of squared sample values
+    //!<
+    int peak          = 0;   //!< max absolute sample value
+    //!<
+} sAudioLevelSum;
+
+
+/**
+ * add audio level of a block of 16 bit samples, simple loop without early exit, so compiler can vectorize it <br>
+ * always inlined, so each caller gets it compiled with its own target instructions
+ * @param[in]     samples pointer to samples
+ * @param[in]     count   number of samples, at most AUDIO_LEVEL_BLOCK
+ * @param[in,out] sum     audio level sums
+ */
+static inline __attribute__((always_inline)) void AudioLevelBlockBody(const int16_t *samples, const int count, sAudioLevelSum *sum) {
+    int blockAbs        = 0;   // AUDIO_LEVEL_BLOCK * 32768 fits in 32 bit
+    int64_t blockSquare = 0;
+    int blockPeak       = 0;
+    for (int i = 0; i < count; i++) {
+        int value = abs(samples[i]);
+        blockAbs    += value;
+        blockSquare += value * value;
+        blockPeak    = std::max(blockPeak, value);
+    }
+    sum->sumAbs    += blockAbs;
+    sum->sumSquare += blockSquare;
+    sum->peak       = std::max(sum->peak, blockPeak);
+}
+
+
+/**
+ * AudioLevelBlockBody() compiled with base instructions
+ */
+static void AudioLevelBlockGeneric(const int16_t *samples, const int count, sAudioLevelSum *sum) {
+    AudioLevelBlockBody(samples, count, sum);
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * AudioLevelBlockBody() compiled with AVX2 vector instructions
+ */
+__attribute__((target("avx2"))) static void AudioLevelBlockAVX2(const int16_t *samples, const int count, sAudioLevelSum *sum) {
+    AudioLevelBlockBody(samples, count, sum);
+}
+#endif
+
+
+/**
+ * add audio level of a block of 16 bit samples, use AVX2 if CPU supports it
+ */
+static void AudioLevelBlock(const int16_t *samples, const int count, sAudioLevelSum *sum) {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    if (hasAVX2) {
+        AudioLevelBlockAVX2(samples, count, sum);
+        return;
+    }
+#endif
+    AudioLevelBlockGeneric(samples, count, sum);
+}
+
+
+cAudioDecoder::cAudioDecoder(const AVStream *streamParam) {
+    stream = streamParam;
+}
+
+
+cAudioDecoder::~cAudioDecoder() {
+    if (threadRunning) {
+        pthread_mutex_lock(&mutex);
+        threadStop = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(decodeThread, nullptr);
+        threadRunning = false;
+    }
+    Flush();
+    if (codecCtx) {
+        FREE(sizeof(*codecCtx), "audioDecoder->codecCtx");
+        avcodec_free_context(&codecCtx);
+    }
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond);
+}
+
+
+bool cAudioDecoder::Start() {
+    if (!stream)       return false;
+    if (threadRunning) return true;
+
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        esyslog("cAudioDecoder::Start(): could not find decoder for codec id %d", stream->codecpar->codec_id);
+        return false;
+    }
+    codecCtx = avcodec_alloc_context3(codec);
+    if (!codecCtx) {
+        esyslog("cAudioDecoder::Start(): avcodec_alloc_context3 failed");
+        return false;
+    }
+    ALLOC(sizeof(*codecCtx), "audioDecoder->codecCtx");
+    if (avcodec_parameters_to_context(codecCtx, stream->codecpar) < 0) {
+        esyslog("cAudioDecoder::Start(): avcodec_parameters_to_context failed");
+        return false;
+    }
+    codecCtx->thread_count = 1;   // MP2 decoding is cheap, one thread is enough
+    if (avcodec_open2(codecCtx, codec, nullptr) < 0) {
+        esyslog("cAudioDecoder::Start(): avcodec_open2 failed");
+        return false;
+    }
+    if (pthread_create(&decodeThread, nullptr, DecodeThread, this) != 0) {
+        esyslog("cAudioDecoder::Start(): failed to create audio decode thread");
+        return false;
+    }
+    threadRunning = true;
+    dsyslog("cAudioDecoder::Start(): audio decode thread started for stream %d: %s", stream->index, codec->long_name);
+    return true;
+}
+
+
+bool cAudioDecoder::Send(const AVPacket *packet) {
+    if (!packet || !threadRunning) return false;
+    AVPacket *packetCopy = av_packet_clone(packet);
+    if (!packetCopy) return false;
+    ALLOC(sizeof(*packetCopy), "audioDecoder->packet");
+
+    size_t maxPackets = cMemoryBudget::IsTight() ? AUDIO_DECODER_MIN_PACKETS : AUDIO_DECODER_MAX_PACKETS;  // less decode-ahead if memory is short
+    pthread_mutex_lock(&mutex);
+    while ((packets.size() >= maxPackets) && !threadStop) pthread_cond_wait(&cond, &mutex);
+    packets.push_back(packetCopy);
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+
+bool cAudioDecoder::GetLevel(sAudioLevel *level) {
+    if (!level) return false;
+    pthread_mutex_lock(&mutex);
+    bool found = !levels.empty();
+    if (found) {
+        *level = levels.front();
+        levels.pop_front();
+    }
+    pthread_mutex_unlock(&mutex);
+    return found;
+}
+
+
+void cAudioDecoder::Flush() {
+    pthread_mutex_lock(&mutex);
+    for (AVPacket *packet : packets) {
+        FREE(sizeof(*packet), "audioDecoder->packet");
+        av_packet_free(&packet);
+    }
+    packets.clear();
+    levels.clear();
+    generation++;   // decode thread flushes codec before next packet and drops levels of current packet
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+void cAudioDecoder::Wait() {
+    pthread_mutex_lock(&mutex);
+    while (threadRunning && !threadStop && (!packets.empty() || decoding)) pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+void *cAudioDecoder::DecodeThread(void *audioDecoder) {
+    static_cast<cAudioDecoder *>(audioDecoder)->Decode();
+    return nullptr;
+}
+
+
+void cAudioDecoder::Decode() {
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        esyslog("cAudioDecoder::Decode(): av_frame_alloc failed");
+        return;
+    }
+    int codecGeneration = -1;
+    int packetCount     = 0;   // trace sample of audio thread, counts audio packets instead of video packets
+    while (true) {
+        // get next packet
+        pthread_mutex_lock(&mutex);
+        while (packets.empty() && !threadStop) pthread_cond_wait(&cond, &mutex);
+        if (threadStop) {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        AVPacket *packet = packets.front();
+        packets.pop_front();
+        decoding             = true;
+        int packetGeneration = generation;
+        pthread_cond_broadcast(&cond);   // wake up sender if queue was full
+        pthread_mutex_unlock(&mutex);
+
+        // input stream was seeked since last packet, drop decoder state
+        if (codecGeneration != packetGeneration) {
+            avcodec_flush_buffers(codecCtx);
+            codecGeneration = packetGeneration;
+        }
+
+        // decode packet, ignore invalid packets, next MP2 frame is independent
+        cTrace::SetPacket(packetCount++);
+        int rc = 0;
+        {
+            cTraceSpan trace("SendAudioPacketToDecoder", "decoder");
+            rc = avcodec_send_packet(codecCtx, packet);
+        }
+        if (rc == 0) {
+            while (true) {
+                {
+                    cTraceSpan trace("ReceiveAudioFrameFromDecoder", "decoder");
+                    rc = avcodec_receive_frame(codecCtx, frame);
+                }
+                if (rc != 0) break;
+                sAudioLevel level;
+                bool valid = false;
+                {
+                    cTraceSpan trace("AudioLevel", "audio");
+                    valid = CalcLevel(frame, &level);
+                }
+                if (valid) {
+                    level.pts = (frame->pts != AV_NOPTS_VALUE) ? frame->pts : packet->pts;
+                    pthread_mutex_lock(&mutex);
+                    if (generation == packetGeneration) levels.push_back(level);
+                    pthread_mutex_unlock(&mutex);
+                }
+                av_frame_unref(frame);
+            }
+        }
+        FREE(sizeof(*packet), "audioDecoder->packet");
+        av_packet_free(&packet);
+
+        pthread_mutex_lock(&mutex);
+        decoding = false;
+        pthread_cond_broadcast(&cond);   // wake up waiting for decoded packets
+        pthread_mutex_unlock(&mutex);
+    }
+    av_frame_free(&frame);
+}
+
+
+bool cAudioDecoder::CalcLevel(const AVFrame *frame, sAudioLevel *level) {
+    if (!frame || !level) return false;
+    *level = {};
+    if (frame->format != AV_SAMPLE_FMT_S16P) {
+        esyslog("cAudioDecoder::CalcLevel(): invalid format %d", frame->format);
+        return false;
+    }
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+    int channels = frame->ch_layout.nb_channels;
+#else
+    int channels = frame->channels;
+#endif
+    if ((channels <= 0) || (frame->nb_samples <= 0)) return false;
+
+    // scan all channel planes block by block, check for non silence only after each block
+    int64_t noSilenceLimit = static_cast<int64_t>(frame->nb_samples) * channels * MIN_NONSILENCE_VOLUME;
+    int64_t scanned        = 0;
+    bool complete          = true;
+    sAudioLevelSum sum;
+    for (int channel = 0; (channel < channels) && complete; channel++) {
+        const int16_t *samples = reinterpret_cast<const int16_t*>(frame->data[channel]);
+        for (int sample = 0; sample < frame->nb_samples; sample += AUDIO_LEVEL_BLOCK) {
+            int count = std::min(AUDIO_LEVEL_BLOCK, frame->nb_samples - sample);
+            AudioLevelBlock(samples + sample, count, &sum);
+            scanned += count;
+#if !defined(DEBUG_VOLUME)
+            if (sum.sumAbs > noSilenceLimit) {  // non silence reached
+                complete = false;
+                break;
+            }
+#endif
+        }
+    }
+    level->normVolume = sum.sumAbs / frame->nb_samples / channels;
+    level->rms        = sqrt(static_cast<double>(sum.sumSquare) / scanned);
+    level->peak       = sum.peak;
+    level->complete   = complete;
+    return true;
+}
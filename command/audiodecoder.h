@@ -0,0 +1,141 @@
+/*
+ * audiodecoder.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __audiodecoder_h_
+#define __audiodecoder_h_
+
+#include <deque>
+#include <pthread.h>
+
+#include "global.h"
+#include "debug.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+
+#define AUDIO_LEVEL_BLOCK         256   // count of audio samples scanned before check for non silence
+#define AUDIO_DECODER_MAX_PACKETS 512   // max count of queued packets, about 12s of MP2 audio
+#define AUDIO_DECODER_MIN_PACKETS  64   // max count of queued packets if memory budget is tight
+
+
+/**
+ * decode MP2 audio stream in a separate thread and calculate audio level of each frame <br>
+ * own codec context, packets are fed by demuxer of the video decoder, result is a queue of timestamped audio levels
+ */
+class cAudioDecoder {
+public:
+
+    /**
+     * cAudioDecoder constructor
+     * @param streamParam audio stream to decode
+     */
+    explicit cAudioDecoder(const AVStream *streamParam);
+
+    ~cAudioDecoder();
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cAudioDecoder(const cAudioDecoder &origin) {
+        stream        = origin.stream;
+        codecCtx      = nullptr;
+        threadRunning = false;
+        threadStop    = false;
+        decoding      = false;
+        generation    = 0;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cAudioDecoder &operator =(const cAudioDecoder *origin) {
+        stream        = origin->stream;
+        codecCtx      = nullptr;
+        threadRunning = false;
+        threadStop    = false;
+        decoding      = false;
+        generation    = 0;
+        return *this;
+    };
+
+    /**
+     * open codec and start decode thread
+     * @return true if successful, false otherwise
+     */
+    bool Start();
+
+    /**
+     * queue copy of audio packet for decode thread, wait if queue is full
+     * @param packet audio packet from demuxer
+     * @return true if packet is queued, false otherwise
+     */
+    bool Send(const AVPacket *packet);
+
+    /**
+     * get next audio level from decode thread, do not wait for it
+     * @param[out] level audio level with PTS of audio frame
+     * @return true if we got an audio level, false if there is no new audio level
+     */
+    bool GetLevel(sAudioLevel *level);
+
+    /**
+     * drop all queued packets and audio levels, used after seek in input stream
+     */
+    void Flush();
+
+    /**
+     * wait until all queued packets are decoded, audio levels of all packets sent so far are available after return
+     */
+    void Wait();
+
+    /**
+     * calculate audio level of a decoded S16P frame, scan stops at first block with non silence
+     * @param[in]  frame decoded audio frame
+     * @param[out] level audio level
+     * @return true if successful, false otherwise
+     */
+    static bool CalcLevel(const AVFrame *frame, sAudioLevel *level);
+
+private:
+
+    /**
+     * decode thread
+     */
+    static void *DecodeThread(void *audioDecoder);
+
+    /**
+     * decode packets from queue until stop is requested
+     */
+    void Decode();
+
+    const AVStream *stream          = nullptr;    //!< audio stream to decode
+    //!<
+    AVCodecContext *codecCtx        = nullptr;    //!< codec context of audio stream, only used in decode thread
+    //!<
+    pthread_t decodeThread          = {};         //!< decode thread
+    //!<
+    pthread_mutex_t mutex           = PTHREAD_MUTEX_INITIALIZER;   //!< mutex for packet and level queue
+    //!<
+    pthread_cond_t cond             = PTHREAD_COND_INITIALIZER;    //!< condition for packet queue changes
+    //!<
+    bool threadRunning              = false;      //!< true if decode thread is running
+    //!<
+    bool threadStop                 = false;      //!< true if decode thread has to stop
+    //!<
+    bool decoding                   = false;      //!< true if decode thread decodes a packet taken from queue
+    //!<
+    int generation                  = 0;          //!< incremented by each flush, levels of packets from before a flush are dropped
+    //!<
+    std::deque<AVPacket *> packets;               //!< queued packets to decode
+    //!<
+    std::deque<sAudioLevel> levels;               //!< audio levels of decoded frames
+    //!<
+};
+#endif
@@ -586,3 +586,47 @@ void cCriteria::ListDetection() const {
     dsyslog("cMarkCriteria::ListDetectionState(): MT_VIDEO:             %s", GetDetectionState(MT_VIDEO)             ? "on" : "off");
     dsyslog("cMarkCriteria::ListDetectionState(): MT_AUDIO:             %s", GetDetectionState(MT_AUDIO)             ? "on" : "off");
 }
+
+
+void cCriteria::GetState(char *state, const size_t size) const {
+    if (!state || (size == 0)) return;
+    snprintf(state, size, "criteria %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d", logo, hborder, vborder, aspectratio, channel, closingCreditsState, closingCreditsPos, sceneDetection, soundDetection, lowerBorderDetection, blackscreenDetection, logoDetection, vborderDetection, hborderDetection, aspectratioDetection, channelDetection, videoDecoding, audioDecoding);
+}
+
+
+void cCriteria::WriteState(FILE *file) const {
+    if (!file) return;
+    char state[CRITERIA_STATE_SIZE] = {0};
+    GetState(state, sizeof(state));
+    fprintf(file, "%s\n", state);
+}
+
+
+bool cCriteria::ReadState(const char *line) {
+    if (!line) return false;
+    int state[18] = {0};
+    if (sscanf(line, "criteria %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d", &state[0], &state[1], &state[2], &state[3], &state[4], &state[5], &state[6], &state[7], &state[8], &state[9], &state[10], &state[11], &state[12], &state[13], &state[14], &state[15], &state[16], &state[17]) != 18) {
+        esyslog("cCriteria::ReadState(): invalid line <%s>", line);
+        return false;
+    }
+    logo                 = state[0];
+    hborder              = state[1];
+    vborder              = state[2];
+    aspectratio          = state[3];
+    channel              = state[4];
+    closingCreditsState  = state[5];
+    closingCreditsPos    = state[6];
+    sceneDetection       = state[7];
+    soundDetection       = state[8];
+    lowerBorderDetection = state[9];
+    blackscreenDetection = state[10];
+    logoDetection        = state[11];
+    vborderDetection     = state[12];
+    hborderDetection     = state[13];
+    aspectratioDetection = state[14];
+    channelDetection     = state[15];
+    videoDecoding        = state[16];
+    audioDecoding        = state[17];
+    dsyslog("cCriteria::ReadState(): mark type states and detection states restored");
+    return true;
+}
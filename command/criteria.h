@@ -11,6 +11,8 @@
 #include "marks.h"
 #include "tools.h"
 
+#define CRITERIA_STATE_SIZE 128   // buffer size for state line of GetState()
+
 enum eCriteria {
     CRITERIA_USED        =  2,
     CRITERIA_AVAILABLE   =  1,
@@ -188,6 +190,26 @@ public:
      */
     void ListDetection() const;
 
+    /**
+     * get mark type states and detection states as text line, same format as in checkpoint file
+     * @param[out] state buffer for state line
+     * @param      size  size of buffer, CRITERIA_STATE_SIZE is enough
+     */
+    void GetState(char *state, const size_t size) const;
+
+    /**
+     * write mark type states and detection states to checkpoint file
+     * @param file checkpoint file
+     */
+    void WriteState(FILE *file) const;
+
+    /**
+     * restore mark type states and detection states from checkpoint file line
+     * @param line line from checkpoint file, written by WriteState()
+     * @return true if successful, false otherwise
+     */
+    bool ReadState(const char *line);
+
 private:
     /**
      * convert state to printable text
@@ -124,6 +124,9 @@
 // debug encoder
 // #define DEBUG_ENCODER
 
+// always close and open video encoder at smart cut boundaries, compare with reuse of flushed encoder context (contrib/markad_getcuttime)
+// #define DEBUG_ENCODER_NO_REUSE
+
 // debug mark optimization
 // #define DEBUG_MARK_OPTIMIZATION
 
@@ -14,6 +14,7 @@
 #include "win32/mingw64.h"
 #endif
 #include "decoder.h"
+#include "trace.h"
 
 
 // global variables
@@ -163,6 +164,11 @@ void cDecoder::Reset() {
             audioAC3Channels[streamIndex].processed          = true;
         }
     }
+    if (audioDecoder) {  // uses stream of avctx
+        FREE(sizeof(*audioDecoder), "audioDecoder");
+        delete audioDecoder;
+        audioDecoder = nullptr;
+    }
     FreeCodecContext();
 
     fileNumber       = 0;
@@ -223,6 +229,11 @@ bool cDecoder::GetForceHWaccel() const {
 }
 
 
+bool cDecoder::GetForceInterlaced() const {
+    return forceInterlaced;
+}
+
+
 const char* cDecoder::GetRecordingDir() const {
     return recordingDir;
 }
@@ -233,26 +244,65 @@ int cDecoder::GetThreadCount() const {
 }
 
 
+void cDecoder::SetDropCache(const bool dropCacheParam) {
+    dropCache = dropCacheParam;
+}
+
+
+void cDecoder::SetDemuxOnly(const bool demuxOnlyParam) {
+    dsyslog("cDecoder::SetDemuxOnly(): %s", (demuxOnlyParam) ? "demux only, open no codec" : "demux and decode");
+    demuxOnly = demuxOnlyParam;
+}
+
+
+void cDecoder::SetFastDecode(const bool fastDecodeParam) {
+    dsyslog("cDecoder::SetFastDecode(): %s", (fastDecodeParam) ? "analysis decode profile" : "full quality decode profile");
+    fastDecode = fastDecodeParam;
+}
+
+
+void cDecoder::SetByteSeek(const bool byteSeekParam) {
+    dsyslog("cDecoder::SetByteSeek(): %s", (byteSeekParam) ? "seek to byte position of key packet" : "seek by read all packets");
+    byteSeek = byteSeekParam;
+}
+
+
+void cDecoder::SetCodecOptions(const int streamIndex) {
+    codecCtxArray[streamIndex]->thread_count = threads;
+    if (!fastDecode || !IsVideoStream(streamIndex)) return;
+    // mark detection only needs edges and average brightness, no bit exact picture
+    codecCtxArray[streamIndex]->skip_loop_filter = AVDISCARD_NONKEY;
+    codecCtxArray[streamIndex]->skip_idct        = AVDISCARD_NONKEY;
+    codecCtxArray[streamIndex]->flags2          |= AV_CODEC_FLAG2_FAST;
+    dsyslog("cDecoder::SetCodecOptions(): stream %d: use analysis decode profile", streamIndex);
+}
+
+
 bool cDecoder::ReadNextFile() {
     if (!recordingDir)      return false;
-    if (fileNumber >= 1000) return false;  // limit for max ts files per recording
     if (eof)                return false;
+    if (avctx) {
+        // all ts files are one logical stream, we are called after end of last file
+        dsyslog("cDecoder:::ReadNextFile(): end of last file %05i.ts reached", fileNumber);
+        eof = true;
+        return false;
+    }
 
     char *filename;
-    fileNumber++;
-    if (asprintf(&filename, "%s/%05i.ts", recordingDir, fileNumber) == -1) {
+    if (asprintf(&filename, "%s/%05i.ts", recordingDir, 1) == -1) {
         esyslog("cDecoder:::ReadNextFile(): failed to allocate string, out of memory?");
         return false;
     }
     ALLOC(strlen(filename), "filename");
 
     // check if file exists
-    dsyslog("cDecoder:::ReadNextFile(): search next file %s", filename);
+    dsyslog("cDecoder:::ReadNextFile(): search first file %s", filename);
     bool ret = false;
     struct stat buffer;
     int fileExists = stat(filename, &buffer);
     if (fileExists == 0 ) {
-        dsyslog("cDecoder:::ReadNextFile(): next file %s found", filename);
+        dsyslog("cDecoder:::ReadNextFile(): first file %s found", filename);
+        fileNumber = 1;
         if (fileNumber > maxFileNumber) maxFileNumber = fileNumber;
         ret = InitDecoder(filename);
         if (!ret && useHWaccel) {
@@ -268,14 +318,11 @@ bool cDecoder::ReadNextFile() {
         }
     }
     else {
-        dsyslog("cDecoder:::ReadNextFile(): next file %s does not exists", filename);
-        if (fileNumber <= 1) {
-            FREE(strlen(filename), "filename");
-            free(filename);
-            esyslog("cDecoder:::ReadNextFile(): file 00001.ts does not exists");
-            exit(EXIT_FAILURE);
-        }
-        eof = true;
+        FREE(strlen(filename), "filename");
+        free(filename);
+        esyslog("cDecoder:::ReadNextFile(): file 00001.ts does not exists");
+        cTrace::Close();
+        exit(EXIT_FAILURE);
     }
     FREE(strlen(filename), "filename");
     free(filename);
@@ -330,10 +377,14 @@ void cDecoder::FreeCodecContext() {
     }
     if (avctx) {
         FREE(sizeof(avctx), "avctx");
-        avformat_close_input(&avctx);
+        avformat_close_input(&avctx);  // does not close custom AVIO context
         avctx = nullptr;
     }
-
+    if (tsReader) {
+        FREE(sizeof(*tsReader), "tsReader");
+        delete tsReader;
+        tsReader = nullptr;
+    }
 }
 
 
@@ -454,7 +505,7 @@ bool cDecoder::RestartCodec(const int streamIndex) {
         esyslog("cDecoder::RestartCodec(): avcodec_parameters_to_context failed");
         return false;
     }
-    codecCtxArray[streamIndex]->thread_count = threads;
+    SetCodecOptions(streamIndex);
     if (avcodec_open2(codecCtxArray[streamIndex], codec, nullptr) < 0) {
         esyslog("cDecoder::RestartCodec(): avcodec_open2 failed");
         return false;
@@ -473,17 +524,27 @@ bool cDecoder::InitDecoder(const char *filename) {
 #endif
     FreeCodecContext();
 
-    // open first/next file
+    // create input layer, present all ts files as one logical stream
+    tsReader = new cTsReader(recordingDir, dropCache);
+    ALLOC(sizeof(*tsReader), "tsReader");
+    AVIOContext *avioContext = tsReader->Open();
+    avctx = avformat_alloc_context();
+    if (!avioContext || !avctx) {
+        esyslog("could not open source file %s", filename);
+        cTrace::Close();
+        exit(EXIT_FAILURE);
+    }
+    avctx->pb = avioContext;
+
+    // open first file, avformat_open_input() frees avctx on failure
     if (avformat_open_input(&avctx, filename, nullptr, nullptr) == 0) {
         ALLOC(sizeof(avctx), "avctx");
         dsyslog("cDecoder::InitDecoder(): opened file %s", filename);
     }
     else {
-        if (fileNumber <= 1) {
-            esyslog("could not open source file %s", filename);
-            exit(EXIT_FAILURE);
-        }
-        return false;
+        esyslog("could not open source file %s", filename);
+        cTrace::Close();
+        exit(EXIT_FAILURE);
     }
     if (avformat_find_stream_info(avctx, nullptr) < 0) {
         dsyslog("cDecoder::InitDecoder(): could not get stream infos %s", filename);
@@ -495,6 +556,18 @@ bool cDecoder::InitDecoder(const char *filename) {
     ALLOC(sizeof(AVCodecContext *) * avctx->nb_streams, "codecCtxArray");
     memset(codecCtxArray, 0, sizeof(AVCodecContext *) * avctx->nb_streams);
 
+    // demux only, we need no codec, keep all codec contexts unset
+    if (demuxOnly) {
+        for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
+            if (IsVideoStream(streamIndex) && index && (fileNumber == 1)) index->SetStartPTS(avctx->streams[streamIndex]->start_time, avctx->streams[streamIndex]->time_base);  // register stream infos in index
+        }
+        // stream infos are detected, now we can allow byte based seek without read the end of the recording
+        tsReader->SetSeekable(true);
+        dsyslog("cDecoder::InitDecoder(): demux only, no codec opened");
+        LogSeparator(false);
+        return true;
+    }
+
     for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
         AVCodecID codec_id = avctx->streams[streamIndex]->codecpar->codec_id;
         sCodecInfo codecInfo = {};
@@ -614,7 +687,7 @@ bool cDecoder::InitDecoder(const char *filename) {
             dsyslog("cDecoder::InitDecoder(): avcodec_parameters_to_context failed");
             return false;
         }
-        codecCtxArray[streamIndex]->thread_count = threads;
+        SetCodecOptions(streamIndex);
         if (avcodec_open2(codecCtxArray[streamIndex], codecInfo.codec, nullptr) < 0) {
             dsyslog("cDecoder::InitDecoder(): avcodec_open2 failed");
             return false;
@@ -626,6 +699,7 @@ bool cDecoder::InitDecoder(const char *filename) {
         }
     }
     dsyslog("cDecoder::InitDecoder(): first MP2 audio stream index: %d", firstMP2Index);
+    if (byteSeek) tsReader->SetSeekable(true);  // stream infos are detected, allow byte based seek
 
     LogSeparator(false);
     return true;
@@ -733,6 +807,7 @@ int cDecoder::GetVideoRealFrameRate() {
 bool cDecoder::ReadPacket() {
     if (!avctx) return false;
     if (eof)    return false;
+    cTraceSpan trace("ReadPacket", "decoder");
 
     frameValid = false;
     av_packet_unref(&avpkt);
@@ -751,6 +826,17 @@ bool cDecoder::ReadPacket() {
         // analyse video packet
         if (IsVideoPacket()) {
             packetNumber++;   // increase packet counter even on invalid video packets
+            if (cTrace::IsActive()) cTrace::SetPacket(packetNumber);
+
+            // get ts file number of packet from input layer
+            if (tsReader) {
+                int packetFileNumber = tsReader->GetFileNumber(avpkt.pos);
+                if (packetFileNumber > fileNumber) {
+                    dsyslog("cDecoder::ReadPacket(): packet (%5d): input file changed from %d to %d", packetNumber, fileNumber, packetFileNumber);
+                    fileNumber = packetFileNumber;
+                    if (fileNumber > maxFileNumber) maxFileNumber = fileNumber;
+                }
+            }
 #ifdef DEBUG_PACKET_PTS
             dsyslog("cDecoder::ReadPacket():  file %d, packet (%5d): PTS %" PRId64 ", DTS %" PRId64 ", duration %" PRId64 ", flags %d, dtsBefore %" PRId64 ", time_base.num %d, time_base.den %d",  fileNumber, packetNumber, avpkt.pts, avpkt.dts, avpkt.duration, avpkt.flags, dtsBefore, avctx->streams[avpkt.stream_index]->time_base.num, avctx->streams[avpkt.stream_index]->time_base.den);
 #endif
@@ -789,9 +875,14 @@ bool cDecoder::ReadPacket() {
                             lastPacket->isPTSinSlice = false;
                         }
                     }
+                    // without full decoding get p-slices from slice headers of packets
+                    if (!fullDecode) {
+                        int64_t pSlicePTS = sliceScanner.Process(packetNumber, avpkt.pts, avpkt.data, avpkt.size);
+                        if (pSlicePTS >= 0) index->AddPSlice(pSlicePTS);
+                    }
                 }
                 // store file number and PTS key frames
-                if (IsVideoKeyPacket()) index->Add(fileNumber, packetNumber, avpkt.pts);
+                if (IsVideoKeyPacket()) index->Add(fileNumber, packetNumber, avpkt.pts, avpkt.pos);
             }
 
         }
@@ -887,42 +978,34 @@ int64_t cDecoder::GetPacketDuration() const {
 #endif
 
 
-int cDecoder::GetVolume() {
-    if (!fullDecode)                         return -1;   // no audio frames decoded
-    if (avpkt.stream_index != firstMP2Index) return -1;   // only check first MP2 stream
-    if (avpkt.pts < index->GetStartPTS())    return -1;   // audio starts before video stream, ignore audio packets with PTS before video stream start PTS
-
-    // get volume of MP2 frame
-    if (avFrame.format == AV_SAMPLE_FMT_S16P) {
-        int level = 0;
-#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
-        int noSilenceLimit = avFrame.nb_samples * avFrame.ch_layout.nb_channels * MIN_NONSILENCE_VOLUME;
-        for (int channel = 0; channel < avFrame.ch_layout.nb_channels; channel++)
-#else
-        int noSilenceLimit = avFrame.nb_samples * avFrame.channels * MIN_NONSILENCE_VOLUME;
-        for (int channel = 0; channel < avFrame.channels; channel++)
-#endif
-        {
-            const int16_t *samples = reinterpret_cast<int16_t*>(avFrame.data[channel]);
-            for (int sample = 0; sample < avFrame.nb_samples; sample++) {
-                level += abs(samples[sample]);
-#if !defined(DEBUG_VOLUME)
-                if (level > noSilenceLimit) break;  // non silence reached
-#endif
-            }
+bool cDecoder::SendAudioPacket() {
+    if (!audioDecoder && !audioDecoderFailed) {
+        audioDecoder = new cAudioDecoder(avctx->streams[firstMP2Index]);
+        ALLOC(sizeof(*audioDecoder), "audioDecoder");
+        if (!audioDecoder->Start()) {
+            esyslog("cDecoder::SendAudioPacket(): start of audio decode thread failed, no silence detection possible");
+            FREE(sizeof(*audioDecoder), "audioDecoder");
+            delete audioDecoder;
+            audioDecoder       = nullptr;
+            audioDecoderFailed = true;
         }
-#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
-        int normVolume =  level / avFrame.nb_samples / avFrame.ch_layout.nb_channels;
-#else
-        int normVolume =  level / avFrame.nb_samples / avFrame.channels;
-#endif
-#ifdef DEBUG_VOLUME
-        dsyslog("cDecoder::GetSilence(): packet (%d), stream %d: avpkt.pts %ld: normVolume %d", packetNumber, avpkt.stream_index, avpkt.pts, normVolume);
-#endif
-        return normVolume;
     }
-    else esyslog("cDecoder::GetSilence(): packet (%d), stream %d: invalid format %d", packetNumber, avpkt.stream_index, avFrame.format);
-    return -1;
+    if (!audioDecoder) return false;
+    return audioDecoder->Send(&avpkt);
+}
+
+
+bool cDecoder::GetNextAudioLevel(sAudioLevel *level) {
+    if (!audioDecoder || !level) return false;
+    while (audioDecoder->GetLevel(level)) {
+        if (!index || (level->pts >= index->GetStartPTS())) return true;   // audio starts before video stream, ignore audio frames with PTS before video stream start PTS
+    }
+    return false;
+}
+
+
+void cDecoder::WaitForAudioLevels() {
+    if (audioDecoder) audioDecoder->Wait();
 }
 
 
@@ -1031,8 +1114,10 @@ bool cDecoder::DecodeNextFrame(const bool audioDecode) {
                 if (abortNow) return false;
                 if(ReadNextPacket()) {        // got a packet
                     if (!fullDecode      && !IsVideoKeyPacket()) continue; // decode only iFrames, no audio decode without full decode
-                    if (!audioDecode     && !IsVideoPacket())    continue; // decode only video frames
-                    if (!IsVideoPacket() && !IsAudioPacket())    continue; // ignore all other types (e.g. subtitle
+                    if (!IsVideoPacket()) {                                // audio is decoded in audio decode thread, video decode never waits for it
+                        if (audioDecode && (avpkt.stream_index == firstMP2Index)) SendAudioPacket();  // only first MP2 stream is used for silence detection, AC3 channel change needs no decoding
+                        continue;
+                    }
                     decoderSendState = SendPacketToDecoder(false);      // send packet to decoder, no flash flag
 #ifdef DEBUG_DECODE_NEXT_FRAME
                     dsyslog("cDecoder::DecodeNextFrame(): packet        (%5d), stream %d, fullDecode %d: avpkt.flags %d send to decoder", packetNumber, avpkt.stream_index, fullDecode, avpkt.flags);
@@ -1104,6 +1189,7 @@ bool cDecoder::ConvertVideoPixelFormat(enum AVPixelFormat pixelFormat) {
         dsyslog("cDecoder::ConvertVideoPixelFormat(): frame not valid");
         return false;
     }
+    cTraceSpan trace("ConvertVideoPixelFormat", "decoder");
     Time(true);
     av_frame_unref(&avFrameConvert);
     avFrameConvert.width  = GetVideoWidth();
@@ -1252,6 +1338,14 @@ bool cDecoder::SeekToPacket(int seekPacketNumber) {
             avcodec_flush_buffers(codecCtxArray[streamIndex]);
         }
     }
+    if (audioDecoder) audioDecoder->Flush();
+
+    // demux only or byte seek allowed, we need not to read all packets before seek position, jump direct to byte position of key packet
+    if ((demuxOnly || byteSeek) && ((seekPacketNumber - packetNumber) > SEEK_BYTE_MIN_PACKETS)) {
+        if (SeekToKeyPacketPos(seekPacketNumber)) return true;
+        if (abortNow) return false;
+        dsyslog("cDecoder::SeekToPacket(): packet (%6d): byte seek failed, fallback to read all packets", packetNumber);
+    }
 
     while (ReadNextPacket()) {
         if (abortNow) return false;
@@ -1263,6 +1357,40 @@ bool cDecoder::SeekToPacket(int seekPacketNumber) {
 }
 
 
+bool cDecoder::SeekToKeyPacketPos(const int seekPacketNumber) {
+    if (!index || !tsReader) return false;
+    const sIndexElement *keyPacket = index->GetKeyPacket(seekPacketNumber);
+    if (!keyPacket || (keyPacket->pos < 0)) {
+        dsyslog("cDecoder::SeekToKeyPacketPos(): packet (%6d): no byte position of key packet (%d) in index", packetNumber, seekPacketNumber);
+        return false;
+    }
+    int rc = av_seek_frame(avctx, -1, keyPacket->pos, AVSEEK_FLAG_BYTE);
+    if (rc < 0) {
+        dsyslog("cDecoder::SeekToKeyPacketPos(): packet (%6d): av_seek_frame() to byte position %" PRId64 " failed, rc = %d: %s", packetNumber, keyPacket->pos, rc, av_err2str(rc));
+        return false;
+    }
+    // read position has changed, set packet counter to packet before key packet, next video packet is seek packet
+    av_packet_unref(&avpkt);
+    packetNumber   = seekPacketNumber - 1;
+    fileNumber     = keyPacket->fileNumber;
+    dtsBefore      = -1;
+    decoderRestart = true;
+    while (ReadPacket()) {
+        if (abortNow) return false;
+        if (!IsVideoPacket() || (avpkt.pts == AV_NOPTS_VALUE)) continue;
+        if ((packetNumber == seekPacketNumber) && (avpkt.pts == keyPacket->pts) && IsVideoKeyPacket()) {
+            dsyslog("cDecoder::SeekToKeyPacketPos(): packet (%6d): byte seek to position %" PRId64 " in file %05d.ts successful", packetNumber, keyPacket->pos, fileNumber);
+            return true;
+        }
+        break;
+    }
+    // read position is unknown now, restart from the beginning of the recording
+    esyslog("cDecoder::SeekToKeyPacketPos(): packet (%6d): PTS %" PRId64 " after byte seek does not match index PTS %" PRId64 ", restart decoder", packetNumber, avpkt.pts, keyPacket->pts);
+    Restart();
+    return false;
+}
+
+
 void cDecoder::Time(bool start) {
     if (start) {
         startDecode = std::chrono::high_resolution_clock::now();
@@ -1292,6 +1420,7 @@ int cDecoder::SendPacketToDecoder(const bool flush) {
         esyslog("cDecoder::cDecoder::SendPacketToDecoder():     packet (%5d) stream %d: type not supported", packetNumber, avpkt.stream_index);
         return AVERROR_EXIT;
     }
+    cTraceSpan trace("SendPacketToDecoder", "decoder");
     Time(true);
 
 #ifdef DEBUG_DECODER
@@ -1352,6 +1481,7 @@ int cDecoder::SendPacketToDecoder(const bool flush) {
 
 int cDecoder::ReceiveFrameFromDecoder() {
     if (!avctx) return AVERROR_EXIT;
+    cTraceSpan trace("ReceiveFrameFromDecoder", "decoder");
 
     // init avFrame for new frame
     av_frame_unref(&avFrame);
@@ -16,6 +16,9 @@
 #include "debug.h"
 #include "tools.h"
 #include "index.h"
+#include "tsreader.h"
+#include "audiodecoder.h"
+#include "slicescanner.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -37,6 +40,8 @@ extern "C" {
 #define AVLOGLEVEL AV_LOG_ERROR
 // #define AVLOGLEVEL AV_LOG_VERBOSE
 
+#define SEEK_BYTE_MIN_PACKETS 250   // use byte based seek only if we skip more than this count of video packets
+
 
 // error codes from AC3 parser
 #define AAC_AC3_PARSE_ERROR_SYNC         -0x1030c0a
@@ -132,12 +137,19 @@ public:
         decoderRestart         = origin.decoderRestart;
         sumDuration            = origin.sumDuration;
         firstMP2Index          = origin.firstMP2Index;
+        audioDecoder           = nullptr;
         frameRate              = origin.frameRate;
         dtsBefore              = origin.dtsBefore;
         decodeErrorCount       = origin.decodeErrorCount;
         decodeErrorFrame       = origin.decodeErrorFrame;
         timeStartCalled        = origin.timeStartCalled;
         startSlicePTS          = origin.startSlicePTS;
+        sliceScanner           = origin.sliceScanner;
+        dropCache              = origin.dropCache;
+        tsReader               = nullptr;
+        demuxOnly              = origin.demuxOnly;
+        fastDecode             = origin.fastDecode;
+        byteSeek               = origin.byteSeek;
     }
 
 
@@ -178,12 +190,19 @@ public:
         decoderRestart         = origin->decoderRestart;
         sumDuration            = origin->sumDuration;
         firstMP2Index          = origin->firstMP2Index;
+        audioDecoder           = nullptr;
         frameRate              = origin->frameRate;
         dtsBefore              = origin->dtsBefore;
         decodeErrorCount       = origin->decodeErrorCount;
         decodeErrorFrame       = origin->decodeErrorFrame;
         timeStartCalled        = origin->timeStartCalled;
         startSlicePTS          = origin->startSlicePTS;
+        sliceScanner           = origin->sliceScanner;
+        dropCache              = origin->dropCache;
+        tsReader               = nullptr;
+        demuxOnly              = origin->demuxOnly;
+        fastDecode             = origin->fastDecode;
+        byteSeek               = origin->byteSeek;
         return *this;
     }
 
@@ -233,14 +252,52 @@ public:
     */
     bool GetForceHWaccel() const;
 
+    /**
+    * get force interlaced
+    */
+    bool GetForceInterlaced() const;
+
     /**
     * get decoder thread count
     */
     int GetThreadCount() const;
 
     /**
-     * set decoder to first/next file of the directory
-     * @return true if first/next ts file found, false otherwise
+     * drop consumed pages of the recording from page cache
+     * has to be called before first ReadNextFile()
+     * @param dropCacheParam true to drop consumed pages
+     */
+    void SetDropCache(const bool dropCacheParam);
+
+    /**
+     * demux recording without opening any decoder codec context
+     * used for key packet cut, packets are only copied, never decoded <br>
+     * in this mode SeekToPacket() uses byte position of key packets from index
+     * has to be called before Restart()
+     * @param demuxOnlyParam true to open no codec
+     */
+    void SetDemuxOnly(const bool demuxOnlyParam);
+
+    /**
+     * use analysis decode profile for video codec contexts
+     * skip loop filter and IDCT of non key frames and allow non spec compliant speedup tricks <br>
+     * decoded pictures are good enough for mark detection, but not for encoding
+     * has to be called before Restart()
+     * @param fastDecodeParam true to use analysis decode profile, false for full quality decoding
+     */
+    void SetFastDecode(const bool fastDecodeParam);
+
+    /**
+     * allow SeekToPacket() to jump to byte position of key packet from index if we decode
+     * index has to contain all packets up to seek position, e.g. after mark detection
+     * has to be called before Restart()
+     * @param byteSeekParam true to use byte position seek
+     */
+    void SetByteSeek(const bool byteSeekParam);
+
+    /**
+     * open input of recording, all ts files are presented as one logical stream by cTsReader
+     * @return true if input was opened, false if input is already open (end of last ts file reached) or open failed
      */
     bool ReadNextFile();
 
@@ -251,8 +308,8 @@ public:
     int GetErrorCount() const;
 
     /**
-     * setup decoder codec context for current file
-     * @param filename file name
+     * setup decoder codec context for recording
+     * @param filename file name of first ts file
      * @return true if setup was successful, false otherwiese
      */
     bool InitDecoder(const char * filename);
@@ -465,10 +522,15 @@ public:
      */
     int64_t GetPacketDuration() const;
 
-    /** get current vulume of MP2 stream
-     * @return MP2 volume
+    /** get next audio level of first MP2 stream from audio decode thread, do not wait for it
+     * @param[out] level audio level with PTS of audio frame
+     * @return true if we got an audio level, false if there is no new audio level
+     */
+    bool GetNextAudioLevel(sAudioLevel *level);
+
+    /** wait until audio decode thread has decoded all packets sent so far
      */
-    int GetVolume();
+    void WaitForAudioLevels();
 
     /** check if stream is subtitle
      * @param streamIndex stream index
@@ -576,12 +638,28 @@ private:
      */
     void GetVideoCodec(AVCodecID codecID, sCodecInfo *codecInfo) const;
 
+    /** seek read position of recording to key packet, use byte position of key packet from index
+     * @param seekPacketNumber key packet number to seek
+     * @return true if successful, false otherwise
+     */
+    bool SeekToKeyPacketPos(const int seekPacketNumber);
+
+    /** set codec context options before open codec, thread count and decode profile
+     * @param streamIndex stream index
+     */
+    void SetCodecOptions(const int streamIndex);
+
     /** convert frame pixel format to AV_PIX_FMT_YUV420P
      * @param pixelFormat   target pixel format
      * @return true if successful, false otherwise
      */
     bool ConvertVideoPixelFormat(enum AVPixelFormat pixelFormat);
 
+    /** send current packet of first MP2 stream to audio decode thread, start thread with first packet
+     * @return true if packet is sent to audio decode thread, false otherwise
+     */
+    bool SendAudioPacket();
+
     /** set start and end time of decoding, use for statitics
      * @param start true for start decoding, false otherwise
      */
@@ -687,8 +765,24 @@ private:
     //!<
     int64_t startSlicePTS              = -1;                      //!< PTS of slice start
     //!<
+    cSliceScanner sliceScanner;                                   //!< p-slice detection from slice headers, used without full decoding
+    //!<
+    bool dropCache                     = false;                   //!< true if we drop consumed pages from page cache
+    //!<
+    cTsReader *tsReader                = nullptr;                 //!< input layer of recording
+    //!<
+    bool demuxOnly                     = false;                   //!< true if we only demux and open no codec
+    //!<
+    bool fastDecode                    = false;                   //!< true if we use analysis decode profile for video
+    //!<
+    bool byteSeek                      = false;                   //!< true if we seek to byte position of key packet from index with decoding
+    //!<
     sAudioAC3Channels audioAC3Channels[MAXSTREAMS] = {};          //!< AC3 audio stream channel count state
     //!<
+    cAudioDecoder *audioDecoder        = nullptr;                 //!< decode thread of first MP2 stream
+    //!<
+    bool audioDecoderFailed            = false;                   //!< true if audio decode thread could not be started
+    //!<
     std::chrono::high_resolution_clock::time_point startDecode;   //!< time stamp of SendPacketToDecoder()
     //!<
 };
@@ -5,8 +5,11 @@
  *
  */
 
+#include <chrono>
+
 #include "decoder.h"
 #include "encoder.h"
+#include "trace.h"
 
 
 // make av_err2str usable in c++
@@ -319,7 +322,7 @@ bool cEncoder::OpenFile() {
     dsyslog("cEncoder::OpenFile(): output format %s", avctxOut->oformat->long_name);
 
     codecCtxArrayIn = decoder->GetAVCodecContext();
-    if (!codecCtxArrayIn) {
+    if (!codecCtxArrayIn && (cutMode != CUT_MODE_KEY)) {  // key packet cut needs no codec, decoder may have opened none
         esyslog("cEncoder::OpenFile(): failed to get input codec context");
         FREE(strlen(filename)+1, "filename");
         free(filename);
@@ -342,8 +345,32 @@ bool cEncoder::OpenFile() {
         dsyslog("cEncoder::OpenFile(): best audio: stream %d", bestAudioStream);
     }
 
+    // key packet cut only copies packets, add output streams without any codec
+    if (cutMode == CUT_MODE_KEY) {
+        for (int streamIndex = 0; streamIndex < static_cast<int>(avctxIn->nb_streams); streamIndex++) {
+            streamMap[streamIndex] = -1;
+            if (!decoder->IsVideoStream(streamIndex) && !decoder->IsAudioStream(streamIndex) && !decoder->IsSubtitleStream(streamIndex)) {
+                dsyslog("cEncoder::OpenFile(): stream %d is no audio, no video and no subtitle, ignoring", streamIndex);
+                continue;
+            }
+            if (decoder->IsAudioStream(streamIndex) && avctxIn->streams[streamIndex]->codecpar->sample_rate == 0) {  // ignore mute audio stream
+                dsyslog("cEncoder::OpenFile(): input stream %d: sample_rate not set, ignore mute audio stream", streamIndex);
+                continue;
+            }
+            streamMap[streamIndex] = AddOutStreamCopy(streamIndex);
+            dsyslog("cEncoder::OpenFile(): source stream %d -----> target stream %d (stream copy)", streamIndex, streamMap[streamIndex]);
+            if ((streamMap[streamIndex] < 0) && decoder->IsVideoStream(streamIndex)) {  // without video stream, abort
+                esyslog("cEncoder::OpenFile(): add output video stream failed");
+                FREE(strlen(filename)+1, "filename");
+                free(filename);
+                return false;
+            }
+        }
+    }
+
     // init all needed encoder streams
     for (int streamIndex = 0; streamIndex < static_cast<int>(avctxIn->nb_streams); streamIndex++) {
+        if (cutMode == CUT_MODE_KEY) break;         // output streams already added
         if (!codecCtxArrayIn[streamIndex]) break;   // if we have no input codec we can not decode and encode this stream and all after
         if ((cutMode == CUT_MODE_FULL) && bestStream) {
             if (streamIndex == bestVideoStream) streamMap[streamIndex] = 0;
@@ -634,6 +661,38 @@ char *cEncoder::GetEncoderName(const int streamIndexIn) {
 }
 
 
+int cEncoder::AddOutStreamCopy(const unsigned int streamIndexIn) {
+    if (!avctxIn)  return -1;
+    if (!avctxOut) return -1;
+    if (streamIndexIn >= avctxIn->nb_streams) {
+        dsyslog("cEncoder::AddOutStreamCopy(): streamindex %d out of range", streamIndexIn);
+        return -1;
+    }
+    const AVCodecParameters *codecParIn = avctxIn->streams[streamIndexIn]->codecpar;
+    if (codecParIn->codec_id == AV_CODEC_ID_NONE) {
+        dsyslog("cEncoder::AddOutStreamCopy(): input stream %d: unknown codec, ignoring", streamIndexIn);
+        return -1;
+    }
+    AVStream *out_stream = avformat_new_stream(avctxOut, nullptr);
+    if (!out_stream) {
+        esyslog("cEncoder::AddOutStreamCopy(): input stream %d: failed to add output stream", streamIndexIn);
+        return -1;
+    }
+    if (avcodec_parameters_copy(out_stream->codecpar, codecParIn) < 0) {
+        esyslog("cEncoder::AddOutStreamCopy(): input stream %d: failed to copy codec parameters", streamIndexIn);
+        return -1;
+    }
+    out_stream->codecpar->codec_tag = 0;    // let muxer choose codec tag
+    out_stream->time_base           = avctxIn->streams[streamIndexIn]->time_base;
+    out_stream->avg_frame_rate      = avctxIn->streams[streamIndexIn]->avg_frame_rate;
+    out_stream->r_frame_rate        = avctxIn->streams[streamIndexIn]->r_frame_rate;
+    out_stream->sample_aspect_ratio = avctxIn->streams[streamIndexIn]->sample_aspect_ratio;
+    av_dict_copy(&out_stream->metadata, avctxIn->streams[streamIndexIn]->metadata, 0);  // keep language of audio and subtitle streams
+    dsyslog("cEncoder::AddOutStreamCopy(): input stream %d: codec id %d -> output stream %d", streamIndexIn, codecParIn->codec_id, out_stream->index);
+    return out_stream->index;
+}
+
+
 bool cEncoder::InitEncoderCodec(const unsigned int streamIndexIn, const unsigned int streamIndexOut, const bool addOutStream, AVPixelFormat forcePixFmt, const bool verbose) {
     if (!decoder)  return false;
     if (!avctxIn)  return false;
@@ -1070,7 +1129,10 @@ bool cEncoder::InitEncoderCodec(const unsigned int streamIndexIn, const unsigned
         codecCtxArrayOut[streamIndexOut] = nullptr;
         if (decoder->IsVideoStream(streamIndexIn)) return false;  // video stream is essential
     }
-    else dsyslog("cEncoder::InitEncoderCodec(): avcodec_open2 for stream %i successful", streamIndexOut);
+    else {
+        dsyslog("cEncoder::InitEncoderCodec(): avcodec_open2 for stream %i successful", streamIndexOut);
+        contextOpen++;
+    }
 
     // restore correct value, intentionally set false from FFmpeg bug workaround
     codecCtxArrayOut[streamIndexOut]->sample_aspect_ratio = codecCtxArrayIn[streamIndexIn]->sample_aspect_ratio;
@@ -1152,7 +1214,7 @@ bool cEncoder::CutOut(cMark *startMark, cMark *stopMark) {
     dsyslog("cEncoder::CutOut(): packet (%d): start position (%d) PTS %" PRId64 ", stop position (%d) PTS %" PRId64 " in pass: %d, cut mode %d", decoder->GetPacketNumber(), startMark->position, startMark->pts, stopMark->position, stopMark->pts, pass, cutMode);
     // store video input and output stream index
     for (int streamIndex = 0; streamIndex < static_cast<int>(avctxIn->nb_streams); streamIndex++) {
-        if (codecCtxArrayIn[streamIndex] && decoder->IsVideoStream(streamIndex)) {
+        if (((cutMode == CUT_MODE_KEY) || codecCtxArrayIn[streamIndex]) && decoder->IsVideoStream(streamIndex)) {
             videoInputStreamIndex  = streamIndex;
             videoOutputStreamIndex = streamMap[streamIndex];
         }
@@ -1192,6 +1254,23 @@ bool cEncoder::CutOut(cMark *startMark, cMark *stopMark) {
 
 int cEncoder::GetPSliceKeyPacketNumberAfterPTS(int64_t pts, int64_t *pSlicePTS, const int keyPacketNumberBeforeStop) {
     if (!pSlicePTS) return -1;
+    // p-slices from slice headers, found while packets were read by decoder
+    int keyPacketNumberPSlice = index->GetPSliceKeyPacketNumberAfterPTS(pts, pSlicePTS);
+    if (keyPacketNumberPSlice >= 0) {
+        if (keyPacketNumberPSlice >= keyPacketNumberBeforeStop) {
+            dsyslog("cEncoder::GetPSliceAfterPTS(): no p-slice found in index before next stop mark");
+            return -1;
+        }
+        dsyslog("cEncoder::GetPSliceAfterPTS(): found p-slice key packet (%d) with PTS %" PRId64 " after PTS %" PRId64 " in index", keyPacketNumberPSlice, *pSlicePTS, pts);
+        return keyPacketNumberPSlice;
+    }
+    // range up to next stop mark was already read by decoder, slice headers of all packets are in index, there is no p-slice
+    const sIndexElement *lastPacket = index->GetLastPacket();
+    if (lastPacket && (lastPacket->packetNumber > keyPacketNumberBeforeStop)) {
+        dsyslog("cEncoder::GetPSliceAfterPTS(): no p-slice found in index before next stop mark, index is complete up to packet (%d)", lastPacket->packetNumber);
+        return -1;
+    }
+    // not yet in index, full decode from key packet before
     if (!indexLocal) {
         indexLocal = new cIndex(true);  // full decode
         ALLOC(sizeof(*indexLocal), "indexLocal");
@@ -1210,7 +1289,7 @@ int cEncoder::GetPSliceKeyPacketNumberAfterPTS(int64_t pts, int64_t *pSlicePTS,
             return -1;
         }
         if (decoderLocal->IsVideoKeyPacket()) {
-            int keyPacketNumberPSlice = indexLocal->GetPSliceKeyPacketNumberAfterPTS(pts, pSlicePTS);
+            keyPacketNumberPSlice = indexLocal->GetPSliceKeyPacketNumberAfterPTS(pts, pSlicePTS);
             if (keyPacketNumberPSlice >= 0) {
                 dsyslog("cEncoder::GetPSliceAfterPTS(): packet (%d): found p-slice key packet (%d) with PTS %" PRId64 " after PTS %" PRId64, decoderLocal->GetPacketNumber(), keyPacketNumberPSlice, *pSlicePTS, pts);
                 return keyPacketNumberPSlice;
@@ -1265,29 +1344,48 @@ bool cEncoder::DrainVideoReEncode(const int64_t startPTS, const int64_t stopPTS)
 
 bool cEncoder::ResetDecoderEncodeCodec() {
     dsyslog("cEncoder::ResetDecoderEncodeCodec(): reset decoder and encoder codec context");
+    auto startReset = std::chrono::high_resolution_clock::now();
     firstFrameToEncoder = true;
-    AVPixelFormat forcePixFmt = codecCtxArrayOut[videoOutputStreamIndex]->pix_fmt;   // keep same pixel format
-    avcodec_flush_buffers(codecCtxArrayOut[videoOutputStreamIndex]);
-    if (codecCtxArrayOut[videoOutputStreamIndex]->hw_frames_ctx) {
-#ifdef DEBUG_HW_DEVICE_CTX_REF
-        dsyslog("cEncoder::ResetDecoderEncodeCodec: av_buffer_get_ref_count(codecCtxArrayOut[videoOutputStreamIndex]->hw_frames_ctx) %d", av_buffer_get_ref_count(codecCtxArrayOut[videoOutputStreamIndex]->hw_frames_ctx));
-#endif
-        av_buffer_unref(&codecCtxArrayOut[videoOutputStreamIndex]->hw_frames_ctx);
-    }
-    FREE(sizeof(*codecCtxArrayOut[videoOutputStreamIndex]), "codecCtxArrayOut[streamIndex]");
-    avcodec_free_context(&codecCtxArrayOut[videoOutputStreamIndex]);
+    AVCodecContext *codecCtxOut = codecCtxArrayOut[videoOutputStreamIndex];
+    AVPixelFormat forcePixFmt   = codecCtxOut->pix_fmt;   // keep same pixel format
 
     // restart input codec context, required after flush queue
     if (!decoder->RestartCodec(videoOutputStreamIndex)) {
         esyslog("cEncoder::ResetDecoderEncodeCodec(): restart decoder context failed");
         return false;
     }
-    // restart output codec context
-    if (!InitEncoderCodec(videoInputStreamIndex, videoOutputStreamIndex, false, forcePixFmt, false)) {  // keep same video pixel format
-        esyslog("cEncoder::ResetDecoderEncodeCodec(): failed to re-init codec after flash buffer");
-        return false;
+
+    // encoder with flush support can be used again after drain, avoid close and open of encoder (e.g. libx264 init and lookahead)
+    // hwaccel encoder has to be linked to the new hw_frames_ctx of restarted decoder
+    // FFmpeg allows avcodec_flush_buffers() only for encoder with AV_CODEC_CAP_ENCODER_FLUSH, all other are closed and opened again
+    bool reuse = false;
+#if defined(AV_CODEC_CAP_ENCODER_FLUSH) && !defined(DEBUG_ENCODER_NO_REUSE)
+    reuse = !codecCtxOut->hw_frames_ctx && (codecCtxOut->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH);
+#endif
+    if (reuse) {
+        avcodec_flush_buffers(codecCtxOut);
+        dsyslog("cEncoder::ResetDecoderEncodeCodec(): reuse flushed encoder context %s", codecCtxOut->codec->name);
+        av_opt_set_int(codecCtxOut->priv_data, "forced-idr", 1, 0);  // forced I frame of first frame after cut is an IDR frame (libx264, libx265), ignore if not supported
+        contextReuse++;
     }
+    else {
+        if (codecCtxOut->hw_frames_ctx) {
+#ifdef DEBUG_HW_DEVICE_CTX_REF
+            dsyslog("cEncoder::ResetDecoderEncodeCodec: av_buffer_get_ref_count(codecCtxArrayOut[videoOutputStreamIndex]->hw_frames_ctx) %d", av_buffer_get_ref_count(codecCtxOut->hw_frames_ctx));
+#endif
+            av_buffer_unref(&codecCtxOut->hw_frames_ctx);
+        }
+        FREE(sizeof(*codecCtxArrayOut[videoOutputStreamIndex]), "codecCtxArrayOut[streamIndex]");
+        avcodec_free_context(&codecCtxArrayOut[videoOutputStreamIndex]);
 
+        // restart output codec context
+        if (!InitEncoderCodec(videoInputStreamIndex, videoOutputStreamIndex, false, forcePixFmt, false)) {  // keep same video pixel format
+            esyslog("cEncoder::ResetDecoderEncodeCodec(): failed to re-init codec after flash buffer");
+            return false;
+        }
+    }
+    std::chrono::duration<double, std::milli> durationReset = std::chrono::high_resolution_clock::now() - startReset;
+    resetTime += durationReset.count();
     return true;
 }
 
@@ -1915,7 +2013,17 @@ bool cEncoder::EncodeVideoFrame() {
         return false;
     }
     // send frame to encoder
-    avFrame->pict_type = AV_PICTURE_TYPE_NONE;     // encoder decides picture type
+    // encoder decides picture type, except first frame after reset of encoder
+    // flush of reused encoder context does not reset its references, first frame must not reference frames before the cut
+    if (firstFrameToEncoder) {
+        avFrame->pict_type = AV_PICTURE_TYPE_I;
+#ifdef AV_FRAME_FLAG_KEY
+        avFrame->flags |= AV_FRAME_FLAG_KEY;
+#else
+        avFrame->key_frame = 1;
+#endif
+    }
+    else avFrame->pict_type = AV_PICTURE_TYPE_NONE;
     if (!SendFrameToEncoder(streamIndexOut, avFrame)) {
         esyslog("cEncoder::EncodeFrame(): decoder packet (%d): SendFrameToEncoder() failed", decoder->GetPacketNumber());
         return false;
@@ -2060,6 +2168,7 @@ bool cEncoder::WritePacket(AVPacket *avpkt, const bool reEncoded) {
         esyslog("cEncoder::WritePacket():  out (%d): invalid packet", decoder->GetPacketNumber());  // packet invalid, try next
         return true;
     }
+    cTraceSpan trace("WritePacket", "encoder");
 #ifdef DEBUG_CUT_WRITE
     if ((avpkt->stream_index == DEBUG_CUT_WRITE) || (DEBUG_CUT_WRITE == -1)) {
         dsyslog("cEncoder::WritePacket():  out (%5d), stream %d: flags %d, PTS %10ld, DTS %10ld", decoder->GetPacketNumber(), avpkt->stream_index, avpkt->flags, avpkt->pts, avpkt->dts);
@@ -2276,6 +2385,10 @@ bool cEncoder::CloseFile() {
         dsyslog("cEncoder::CloseFile(): could not close file");
         return false;
     }
+    dsyslog("cEncoder::CloseFile(): encoder contexts: %d opened, %d reused, %.1fms to reset decoder and encoder at cut boundaries", contextOpen, contextReuse, resetTime);
+    contextOpen  = 0;
+    contextReuse = 0;
+    resetTime    = 0;
 
     // free output codec context
     for (unsigned int streamIndex = 0; streamIndex < avctxIn->nb_streams; streamIndex++) {  // we have alocaed codec context for all possible input streams
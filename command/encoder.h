@@ -125,6 +125,9 @@ public:
         pass                   = origin.pass;
         rollover               = origin.rollover;
         firstFrameToEncoder    = origin.firstFrameToEncoder;
+        contextOpen            = origin.contextOpen;
+        contextReuse           = origin.contextReuse;
+        resetTime              = origin.resetTime;
 
         for (int i = 0; i < MAXSTREAMS; i++) {
             streamMap[i]        = origin.streamMap[i];
@@ -161,6 +164,9 @@ public:
         pass                   = origin->pass;
         rollover               = origin->rollover;
         firstFrameToEncoder    = origin->firstFrameToEncoder;
+        contextOpen            = origin->contextOpen;
+        contextReuse           = origin->contextReuse;
+        resetTime              = origin->resetTime;
         software_pix_fmt       = origin->software_pix_fmt;
 
         for (int i = 0; i < MAXSTREAMS; i++) {
@@ -277,9 +283,18 @@ private:
      */
     bool InitEncoderCodec(const unsigned int streamIndexIn, const unsigned int streamIndexOut, const bool addOutStream, AVPixelFormat forcePixFmt, const bool verbose);
 
+    /**
+     * add output stream with stream parameters copied from input stream, no codec will be opened
+     * used for key packet cut, packets are only copied
+     * @param streamIndexIn  input stream index
+     * @return               output stream index, -1 on error
+     */
+    int AddOutStreamCopy(const unsigned int streamIndexIn);
+
     /**
      * reset decoder and encoder codex context
      * have to start with empty decoder end encoder queues
+     * encoder context is flushed and reused if encoder supports it, otherwise closed and opened again
      * @return true if successful, false otherwise
      */
     bool ResetDecoderEncodeCodec();
@@ -316,7 +331,7 @@ private:
 
     /**
      * get next p-slice after PTS
-     * used if we have no p-slice index from decoder because of no full decode
+     * used without full decode, take p-slice from slice header index if packets after PTS are already read, otherwise full decode from key packet before
      * @param pts                       presentation timestamp
      * @param pSlicePTS                 PTS from key packet number of next p-slice
      * @param keyPacketNumberBeforeStop key packet before next stop
@@ -378,6 +393,12 @@ private:
     //!<
     cAC3VolumeFilter *volumeFilterAC3[MAXSTREAMS] = {nullptr};        //!< AC3 volume filter
     //!<
+    int contextOpen                               = 0;                //!< count of opened encoder contexts
+    //!<
+    int contextReuse                              = 0;                //!< count of flushed and reused video encoder contexts at smart cut boundaries
+    //!<
+    double resetTime                              = 0;                //!< sum of time to reset decoder and encoder after smart cut boundaries in ms
+    //!<
 
 
     /**
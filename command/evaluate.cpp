@@ -5,8 +5,11 @@
  *
  */
 
+#include <algorithm>
 
 #include "evaluate.h"
+#include "memorybudget.h"
+#include "trace.h"
 
 
 extern bool abortNow;
@@ -730,6 +733,15 @@ cDetectLogoStopStart::~cDetectLogoStopStart() {
     }
 #endif
     compareResult.clear();
+#ifdef DEBUG_MEM
+    size = streamResult.size();
+    for (int i = 0 ; i < size; i++) {
+        FREE(sizeof(sCompareInfo), "streamResult");
+    }
+#endif
+    cMemoryBudget::Release(sizeof(sCompareInfo) * streamResult.size());
+    streamResult.clear();
+    FreeLogos(streamLogo);
 
     sobel->FreeAreaBuffer(&area);
     FREE(sizeof(*sobel), "sobel");
@@ -755,14 +767,24 @@ int cDetectLogoStopStart::FindFrameFirstPixel(const uchar *picture, const int co
     int searchY       = startY;   // keep startY for debug function
 #endif
 
-    while ((startX >= X_BOUNDARY) && (startX <= (width - X_BOUNDARY) && (startY >= Y_BOUNDARY) && (startY <= (height - Y_BOUNDARY)))) {
-        if (picture[startY * width + startX] == 0) {  // pixel found
-            foundX = startX;
-            foundY = startY;
+    // count of steps inside boundary, walk with pointer without bounds check of each step
+    int steps = -1;
+    if ((startX >= X_BOUNDARY) && (startY >= Y_BOUNDARY) && ((offsetX != 0) || (offsetY != 0))) {
+        steps = INT_MAX;
+        if (offsetX > 0) steps = std::min(steps, (width - X_BOUNDARY - startX) / offsetX);
+        if (offsetX < 0) steps = std::min(steps, (startX - X_BOUNDARY) / -offsetX);
+        if (offsetY > 0) steps = std::min(steps, (height - Y_BOUNDARY - startY) / offsetY);
+        if (offsetY < 0) steps = std::min(steps, (startY - Y_BOUNDARY) / -offsetY);
+    }
+    const uchar *pixel = picture + (startY * width) + startX;
+    const int stride   = (offsetY * width) + offsetX;
+    for (int step = 0; step <= steps; step++) {
+        if (*pixel == 0) {  // pixel found
+            foundX = startX + (step * offsetX);
+            foundY = startY + (step * offsetY);
             break;
         }
-        startX += offsetX;
-        startY += offsetY;
+        pixel += stride;
     }
 
 #ifdef DEBUG_FRAME_DETECTION_PICTURE
@@ -1037,7 +1059,6 @@ bool cDetectLogoStopStart::Detect(int startFrame, int endFrame) {
 #endif
         compareResult.clear();
     }
-    int maxLogoPixel = area.logoSize.width * area.logoSize.height;
 
     // check if we have anything todo with this channel
     if (!criteria->IsInfoLogoChannel() && !criteria->IsLogoChangeChannel() && !criteria->IsClosingCreditsChannel()
@@ -1046,13 +1067,19 @@ bool cDetectLogoStopStart::Detect(int startFrame, int endFrame) {
         return false;
     }
     dsyslog("cDetectLogoStopStart::Detect(): detect from (%d) to (%d)", startFrame, endFrame);
+
+    // use compare results of main detection pass if they cover the full range, no decoding necessary
+    if (compareStream && compareStream->CopyStreamResult(startFrame, endFrame, &compareResult)) {
+        dsyslog("cDetectLogoStopStart::Detect(): use %zu compare results from main detection pass", compareResult.size());
+        return true;
+    }
+
     if (!decoder->SeekToPacket(startFrame)) {
         esyslog("cDetectLogoStopStart::Detect(): SeekToPacket (%d) failed", startFrame);
         return false;
     }
 
     sLogoInfo *logo1[CORNERS];
-    sLogoInfo *logo2[CORNERS];
     for (int corner = 0; corner < CORNERS; corner++) {
         logo1[corner] = new sLogoInfo;
         ALLOC(sizeof(*logo1[corner]), "logo");
@@ -1071,81 +1098,163 @@ bool cDetectLogoStopStart::Detect(int startFrame, int endFrame) {
         }
 
         sCompareInfo compareInfo;
-        for (int corner = 0; corner < CORNERS; corner++) {
-            area.logoCorner = corner;
-            if (!sobel->SobelPlane(picture, &area, 0)) continue;   // plane 0
-#ifdef DEBUG_COMPARE_FRAME_RANGE
-            if (corner == DEBUG_COMPARE_FRAME_RANGE) iFrameNumberNext = -2;
-#endif
+        CompareFrame(picture, logo1, &compareInfo);
+        if (compareInfo.frameNumber1 >= 0) {  // got valid pair
+            compareResult.push_back(compareInfo);
+            ALLOC((sizeof(sCompareInfo)), "compareResult");
+        }
+    }
+
+    // free memory of last logo
+    FreeLogos(logo1);
+    return true;
+}
+
+
+void cDetectLogoStopStart::CompareFrame(const sVideoPicture *picture, sLogoInfo *logo1[CORNERS], sCompareInfo *compareInfo) {
+    cTraceSpan trace("LogoStopStartCompare", "logo");
+    int maxLogoPixel = area.logoSize.width * area.logoSize.height;
+    for (int corner = 0; corner < CORNERS; corner++) {
+        area.logoCorner = corner;
+        if (!sobel->SobelPlane(picture, &area, 0)) continue;   // plane 0
 
 #ifdef DEBUG_MARK_OPTIMIZATION
-            // save plane 0 of sobel transformation
-            char *fileName = nullptr;
-            if (asprintf(&fileName,"%s/F__%07d-P0-C%1d_Detect.pgm", decoder->GetRecordingDir(), frameNumber, corner) >= 1) {
-                ALLOC(strlen(fileName)+1, "fileName");
-                sobel->SaveSobelPlane(fileName, area.sobel[0], area.logoSize.width, area.logoSize.height);
-                FREE(strlen(fileName)+1, "fileName");
-                free(fileName);
-            }
+        // save plane 0 of sobel transformation
+        char *fileName = nullptr;
+        if (asprintf(&fileName,"%s/F__%07d-P0-C%1d_Detect.pgm", decoder->GetRecordingDir(), picture->packetNumber, corner) >= 1) {
+            ALLOC(strlen(fileName)+1, "fileName");
+            sobel->SaveSobelPlane(fileName, area.sobel[0], area.logoSize.width, area.logoSize.height);
+            FREE(strlen(fileName)+1, "fileName");
+            free(fileName);
+        }
 #endif
 
-            compareInfo.framePortion[corner] = DetectFrame(area.sobel[0], area.logoSize.width, area.logoSize.height, corner);
+        compareInfo->framePortion[corner] = DetectFrame(area.sobel[0], area.logoSize.width, area.logoSize.height, corner);
 
-            logo2[corner] = new sLogoInfo;
-            ALLOC(sizeof(*logo2[corner]), "logo");
-            logo2[corner]->frameNumber = picture->packetNumber;
-            logo2[corner]->pts         = picture->pts;
+        sLogoInfo *logo2 = new sLogoInfo;
+        ALLOC(sizeof(*logo2), "logo");
+        logo2->frameNumber = picture->packetNumber;
+        logo2->pts         = picture->pts;
 
-            // alloc memory and copy sobel transformed corner picture
-            logo2[corner]->sobel = new uchar*[PLANES];
-            for (int plane = 0; plane < PLANES; plane++) {
-                logo2[corner]->sobel[plane] = new uchar[maxLogoPixel];
-                memcpy(logo2[corner]->sobel[plane], area.sobel[plane], sizeof(uchar) * maxLogoPixel);
-            }
-            ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "logo[corner]->sobel");
+        // alloc memory and copy sobel transformed corner picture
+        logo2->sobel = new uchar*[PLANES];
+        for (int plane = 0; plane < PLANES; plane++) {
+            logo2->sobel[plane] = new uchar[maxLogoPixel];
+            memcpy(logo2->sobel[plane], area.sobel[plane], sizeof(uchar) * cSobel::GetPlanePixel(area.logoSize, plane));
+        }
+        ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "logo[corner]->sobel");
 
-            if (logo1[corner]->frameNumber >= 0) {  // we have a logo pair
-                if (CompareLogoPair(logo1[corner], logo2[corner], area.logoSize.height, area.logoSize.width, corner, &compareInfo.rate[corner])) {
-                }
-            }
-            if (corner == 0) {  // set current frame numbers, needed only once
-                compareInfo.frameNumber1 = logo1[corner]->frameNumber;
-                compareInfo.pts1         = logo1[corner]->pts;
-                compareInfo.frameNumber2 = logo2[corner]->frameNumber;
-                compareInfo.pts2         = logo2[corner]->pts;
-            }
+        if (logo1[corner]->frameNumber >= 0) {  // we have a logo pair
+            CompareLogoPair(logo1[corner], logo2, area.logoSize.height, area.logoSize.width, corner, &compareInfo->rate[corner]);
+        }
+        if (corner == 0) {  // set current frame numbers, needed only once
+            compareInfo->frameNumber1 = logo1[corner]->frameNumber;
+            compareInfo->pts1         = logo1[corner]->pts;
+            compareInfo->frameNumber2 = logo2->frameNumber;
+            compareInfo->pts2         = logo2->pts;
+        }
 
-            // free memory
-            if (logo1[corner]->sobel) {  // at first iteration logo1[corner]->sobel is not allocated
-                for (int plane = 0; plane < PLANES; plane++) {
-                    delete[] logo1[corner]->sobel[plane];
-                }
-                delete[] logo1[corner]->sobel;
-                FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "logo[corner]->sobel");
-            }
-            FREE(sizeof(*logo1[corner]), "logo");
-            delete logo1[corner];
+        // free memory of previous logo
+        FreeLogo(logo1[corner]);
+        logo1[corner] = logo2;
+    }
+}
 
-            logo1[corner] = logo2[corner];
-        }
-        if (compareInfo.frameNumber1 >= 0) {  // got valid pair
-            compareResult.push_back(compareInfo);
-            ALLOC((sizeof(sCompareInfo)), "compareResult");
+
+void cDetectLogoStopStart::FreeLogo(sLogoInfo *logo) {
+    if (!logo) return;
+    if (logo->sobel) {  // at first iteration sobel is not allocated
+        for (int plane = 0; plane < PLANES; plane++) {
+            delete[] logo->sobel[plane];
         }
+        delete[] logo->sobel;
+        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area.logoSize.width * area.logoSize.height, "logo[corner]->sobel");
     }
+    FREE(sizeof(*logo), "logo");
+    delete logo;
+}
 
-    // free memory of last logo
+
+void cDetectLogoStopStart::FreeLogos(sLogoInfo *logo[CORNERS]) {
     for (int corner = 0; corner < CORNERS; corner++) {
-        if (logo1[corner]->sobel) {
-            for (int plane = 0; plane < PLANES; plane++) {
-                delete[] logo1[corner]->sobel[plane];
-            }
-            delete[] logo1[corner]->sobel;
-            FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "logo[corner]->sobel");
+        FreeLogo(logo[corner]);
+        logo[corner] = nullptr;
+    }
+}
+
+
+void cDetectLogoStopStart::ProcessStream(const sVideoPicture *picture) {
+    if (!picture) return;
+    if (!streamResult.empty() && (picture->packetNumber <= streamResult.back().frameNumber2)) {  // decoder restarted, results have to be ascending
+        dsyslog("cDetectLogoStopStart::ProcessStream(): frame (%d): decoder restarted, drop %zu compare results", picture->packetNumber, streamResult.size());
+#ifdef DEBUG_MEM
+        for (unsigned int i = 0; i < streamResult.size(); i++) {
+            FREE(sizeof(sCompareInfo), "streamResult");
+        }
+#endif
+        cMemoryBudget::Release(sizeof(sCompareInfo) * streamResult.size());
+        streamResult.clear();
+        streamBudgetReached = false;
+        FreeLogos(streamLogo);
+    }
+    if (streamBudgetReached) return;  // ranges after last result are decoded again in post processing
+    if (!streamLogo[0]) {  // first picture after start or seek
+        for (int corner = 0; corner < CORNERS; corner++) {
+            streamLogo[corner] = new sLogoInfo;
+            ALLOC(sizeof(*streamLogo[corner]), "logo");
         }
-        FREE(sizeof(*logo1[corner]), "logo");
-        delete logo1[corner];
     }
+    sCompareInfo compareInfo;
+    CompareFrame(picture, streamLogo, &compareInfo);
+    if (compareInfo.frameNumber1 >= 0) {  // got valid pair
+        if (!cMemoryBudget::Reserve(sizeof(sCompareInfo), "logo compare results")) {
+            dsyslog("cDetectLogoStopStart::ProcessStream(): frame (%d): memory budget reached, stop to keep compare results", picture->packetNumber);
+            streamBudgetReached = true;
+            FreeLogos(streamLogo);
+            return;
+        }
+        streamResult.push_back(compareInfo);
+        ALLOC((sizeof(sCompareInfo)), "streamResult");
+    }
+}
+
+
+void cDetectLogoStopStart::BreakStream() {
+    if (!streamLogo[0]) return;
+    FreeLogos(streamLogo);
+    dsyslog("cDetectLogoStopStart::BreakStream(): compare chain of main detection pass interrupted after %zu results", streamResult.size());
+}
+
+
+void cDetectLogoStopStart::SetCompareStream(const cDetectLogoStopStart *compareStreamParam) {
+    compareStream = compareStreamParam;
+}
+
+
+bool cDetectLogoStopStart::CopyStreamResult(const int startFrame, const int endFrame, std::vector<sCompareInfo> *result) const {
+    if (!result) return false;
+    // first pair in range, frame numbers of main detection pass are ascending
+    std::vector<sCompareInfo>::const_iterator first = std::lower_bound(streamResult.begin(), streamResult.end(), startFrame, [](const sCompareInfo &info, const int frame) {
+        return info.frameNumber1 < frame;
+    });
+    if ((first == streamResult.begin()) || (first == streamResult.end())) return false;  // main detection pass started in range or ended before range
+
+    // compare chain has to be continuous from last pair before range to first pair after range, no seek and no gap between
+    std::vector<sCompareInfo>::const_iterator last = first;
+    while (last->frameNumber2 < endFrame) {
+        if (last->frameNumber1 != (last - 1)->frameNumber2) return false;
+        ++last;
+        if (last == streamResult.end()) return false;  // main detection pass ended in range
+    }
+    if (last->frameNumber1 != (last - 1)->frameNumber2) return false;
+    if (last == first) return false;  // no pair in range
+
+    result->assign(first, last);
+#ifdef DEBUG_MEM
+    for (unsigned int i = 0; i < result->size(); i++) {
+        ALLOC(sizeof(sCompareInfo), "compareResult");
+    }
+#endif
     return true;
 }
 
@@ -207,6 +207,9 @@ public:
         criteria = origin.criteria;
         index = origin.index;
         decoder =origin.decoder;
+        compareStream = origin.compareStream;
+        streamResult = origin.streamResult;
+        streamBudgetReached = origin.streamBudgetReached;
     }
 
     /**
@@ -221,6 +224,9 @@ public:
         criteria = origin->criteria;
         index = origin->index;
         decoder = origin->decoder;
+        compareStream = origin->compareStream;
+        streamResult = origin->streamResult;
+        streamBudgetReached = origin->streamBudgetReached;
         return *this;
     }
 
@@ -318,6 +324,24 @@ public:
      */
     void AdInFrameWithLogo(int startPos, int endPos,  sMarkPos *adInFrame, const bool isStartMark, const bool isEndMark);
 
+    /**
+     * compare corners of picture with previous picture of main detection pass and keep result for later Detect()
+     * @param picture video picture of main detection pass
+     */
+    void ProcessStream(const sVideoPicture *picture);
+
+    /**
+     * interrupt compare chain of main detection pass, used before seek in input stream
+     */
+    void BreakStream();
+
+    /**
+     * set object with compare results of main detection pass <br>
+     * Detect() uses them instead of a new decoding pass if they cover the full range
+     * @param compareStreamParam object with compare results of main detection pass
+     */
+    void SetCompareStream(const cDetectLogoStopStart *compareStreamParam);
+
     /**
      * check if current range is a introduction logo
      * @param startPos          search start position
@@ -370,6 +394,44 @@ private:
     };
     std::vector<sCompareInfo> compareResult;                //!< vector of frame compare results
     //!<
+    const cDetectLogoStopStart *compareStream = nullptr;    //!< object with compare results of main detection pass
+    //!<
+    std::vector<sCompareInfo> streamResult;                 //!< compare results of main detection pass
+    //!<
+    sLogoInfo *streamLogo[CORNERS] = {nullptr};             //!< corners of previous picture of main detection pass
+    //!<
+    bool streamBudgetReached = false;                       //!< true if memory budget refused more compare results of main detection pass
+    //!<
+
+    /**
+     * compare corners of picture with corners of previous picture
+     * @param         picture     video picture
+     * @param[in,out] logo1       in: corners of previous picture, out: corners of current picture
+     * @param[out]    compareInfo compare result of picture pair
+     */
+    void CompareFrame(const sVideoPicture *picture, sLogoInfo *logo1[CORNERS], sCompareInfo *compareInfo);
+
+    /**
+     * free corner picture
+     * @param logo corner picture
+     */
+    void FreeLogo(sLogoInfo *logo);
+
+    /**
+     * free corner pictures of all corners
+     * @param logo corner pictures
+     */
+    void FreeLogos(sLogoInfo *logo[CORNERS]);
+
+    /**
+     * copy compare results of main detection pass
+     * @param      startFrame start of range
+     * @param      endFrame   end of range
+     * @param[out] result     compare results from startFrame to endFrame
+     * @return true if compare results of main detection pass cover full range without gap, false otherwise
+     */
+    bool CopyStreamResult(const int startFrame, const int endFrame, std::vector<sCompareInfo> *result) const;
+
     cEvaluateLogoStopStartPair *evaluateLogoStopStartPair;  //!< class to evaluate logo stop/start pairs
     //!<
     const char *aCorner[CORNERS] = { "TOP_LEFT", "TOP_RIGHT", "BOTTOM_LEFT", "BOTTOM_RIGHT" };  //!< array to convert corner anum to text
@@ -0,0 +1,310 @@
+/*
+ * fingerprint.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <algorithm>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#ifdef POSIX
+#include <fcntl.h>
+#include <sys/file.h>
+#endif
+#include "fingerprint.h"
+
+
+// global variables
+extern bool abortNow;
+
+
+cFingerprintIndex::cFingerprintIndex(cDecoder *decoderParam, const char *logoCacheDirectoryParam, const char *channelNameParam) {
+    decoder = decoderParam;
+    if (!logoCacheDirectoryParam || !channelNameParam) return;
+    if (asprintf(&fileName, "%s/%s.fingerprint", logoCacheDirectoryParam, channelNameParam) == -1) {
+        fileName = nullptr;
+        return;
+    }
+    ALLOC(strlen(fileName) + 1, "fileName");
+    if (Load()) dsyslog("cFingerprintIndex::cFingerprintIndex(): %zu known separators loaded from %s", separators.size(), fileName);
+    else dsyslog("cFingerprintIndex::cFingerprintIndex(): no fingerprint index %s found", fileName);
+}
+
+
+cFingerprintIndex::~cFingerprintIndex() {
+    if (fileName) {
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+    }
+}
+
+
+bool cFingerprintIndex::Load() {
+    if (!fileName) return false;
+    FILE *file = fopen(fileName, "r");
+    if (!file) return false;
+
+    char *line    = nullptr;
+    size_t length = 0;
+    int version   = -1;
+    while (getline(&line, &length, file) != -1) {
+        if (sscanf(line, "markad fingerprint %d", &version) == 1) continue;
+        if (version != FINGERPRINT_VERSION) break;   // unknown file version, start with empty index
+
+        sSeparator separator;
+        long int lastUsed = 0;
+        int offset        = 0;
+        if (sscanf(line, "separator %i %d %ld%n", &separator.type, &separator.hits, &lastUsed, &offset) != 3) continue;
+        separator.lastUsed = lastUsed;
+        const char *pos = line + offset;
+        bool valid = true;
+        for (int i = 0; i < 2 * FINGERPRINT_SEPARATOR_LENGTH; i++) {
+            int used = 0;
+            if (sscanf(pos, " %" SCNx64 "/%d%n", &separator.signature[i].dHash, &separator.signature[i].brightness, &used) != 2) {
+                valid = false;
+                break;
+            }
+            pos += used;
+        }
+        if (valid) separators.push_back(separator);
+    }
+    if (line) free(line);
+    fclose(file);
+    if (version != FINGERPRINT_VERSION) {
+        dsyslog("cFingerprintIndex::Load(): fingerprint index %s has version %d, expected %d, ignore it", fileName, version, FINGERPRINT_VERSION);
+        separators.clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool cFingerprintIndex::Save() {
+    if (!fileName) return false;
+    char *fileNameTmp = nullptr;
+    if (asprintf(&fileNameTmp, "%s.tmp", fileName) == -1) return false;
+    ALLOC(strlen(fileNameTmp) + 1, "fileNameTmp");
+
+    bool ok = false;
+    FILE *file = fopen(fileNameTmp, "w");
+    if (file) {
+        fprintf(file, "markad fingerprint %d\n", FINGERPRINT_VERSION);
+        for (const sSeparator &separator : separators) {
+            fprintf(file, "separator 0x%X %d %ld", separator.type, separator.hits, static_cast<long int>(separator.lastUsed));
+            for (int i = 0; i < 2 * FINGERPRINT_SEPARATOR_LENGTH; i++) fprintf(file, " %016" PRIx64 "/%d", separator.signature[i].dHash, separator.signature[i].brightness);
+            fprintf(file, "\n");
+        }
+        ok = (fflush(file) == 0);
+        fclose(file);
+        // replace index atomic, other markad processes can read it at the same time
+        ok = ok && (rename(fileNameTmp, fileName) == 0);
+        if (!ok) unlink(fileNameTmp);
+    }
+    if (ok) dsyslog("cFingerprintIndex::Save(): %zu known separators saved to %s", separators.size(), fileName);
+    else esyslog("cFingerprintIndex::Save(): write fingerprint index %s failed", fileName);
+
+    FREE(strlen(fileNameTmp) + 1, "fileNameTmp");
+    free(fileNameTmp);
+    return ok;
+}
+
+
+void cFingerprintIndex::Process() {
+    if (!decoder) return;
+    int frameRate = decoder->GetVideoFrameRate();
+    if (frameRate <= 0) return;
+    int second = decoder->GetPacketNumber() / frameRate;
+    if (second <= lastSecond) return;  // we have already a signature of this second
+
+    const sVideoPicture *picture = decoder->GetVideoPicture();
+    if (!picture || !picture->plane[0]) return;
+
+    // same picture area as overlap detection, ignore info borders at top and bottom
+    int startY = picture->height * 0.22;
+    int endY   = picture->height * 0.82;
+    if ((picture->width < 9) || ((endY - startY) < 8)) return;
+
+    // difference hash and brightness, every second pixel is accurate enough for a signature
+    int64_t blockSum[8][9] = {};
+    int64_t sum            = 0;
+    int pixelCount         = 0;
+    for (int y = startY; y < endY; y += 2) {
+        int64_t *blockRow = blockSum[(y - startY) * 8 / (endY - startY)];
+        const uchar *line = picture->plane[0] + (y * picture->planeLineSize[0]);
+        for (int x = 0; x < picture->width; x += 2) {
+            blockRow[x * 9 / picture->width] += line[x];
+            sum += line[x];
+            pixelCount++;
+        }
+    }
+    sSignature signature;
+    for (int row = 0; row < 8; row++) {
+        for (int column = 0; column < 8; column++) {
+            signature.dHash <<= 1;
+            if (blockSum[row][column] > blockSum[row][column + 1]) signature.dHash |= 1;
+        }
+    }
+    signature.brightness   = sum / pixelCount;
+    signature.packetNumber = picture->packetNumber;
+    timeline.push_back(signature);
+    lastSecond = second;
+}
+
+
+int cFingerprintIndex::GetTimelineIndex(const int position) const {
+    std::vector<sSignature>::const_iterator it = std::lower_bound(timeline.begin(), timeline.end(), position, [](const sSignature &signature, const int packetNumber) {
+        return signature.packetNumber < packetNumber;
+    });
+    return it - timeline.begin();
+}
+
+
+bool cFingerprintIndex::Match(const sSeparator *separator, const int center) const {
+    if ((center - FINGERPRINT_SEPARATOR_LENGTH) < 0) return false;
+    if ((center + FINGERPRINT_SEPARATOR_LENGTH) > static_cast<int>(timeline.size())) return false;
+
+    int hamming    = 0;
+    int brightness = 0;
+    for (int i = 0; i < 2 * FINGERPRINT_SEPARATOR_LENGTH; i++) {
+        const sSignature *signature = &timeline[center - FINGERPRINT_SEPARATOR_LENGTH + i];
+        hamming    += __builtin_popcountll(signature->dHash ^ separator->signature[i].dHash);
+        brightness += abs(signature->brightness - separator->signature[i].brightness);
+        if (hamming > (FINGERPRINT_HAMMING_MAX * 2 * FINGERPRINT_SEPARATOR_LENGTH)) return false;  // early exit, most separators do not match
+    }
+    return (brightness <= (FINGERPRINT_BRIGHTNESS_MAX * 2 * FINGERPRINT_SEPARATOR_LENGTH));
+}
+
+
+bool cFingerprintIndex::IsKnownSeparator(const int position, const int type) {
+    if (separators.empty() || timeline.empty()) return false;
+    int center = GetTimelineIndex(position);
+    for (const sSeparator &separator : separators) {
+        if (separator.type != (type & 0x0F)) continue;
+        if (separator.hits < FINGERPRINT_MIN_HITS) continue;  // not yet verified often enough
+        for (int offset = -FINGERPRINT_RANGE; offset <= FINGERPRINT_RANGE; offset++) {
+            if (Match(&separator, center + offset)) {
+                dsyslog("cFingerprintIndex::IsKnownSeparator(): mark (%d) matches known separator with %d hits, distance %ds", position, separator.hits, offset);
+                confirmed.push_back(center + offset);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+void cFingerprintIndex::Learn(cMarks *marks) {
+    if (!marks || !fileName || abortNow) return;
+    if (timeline.empty()) return;
+    if (learned) {
+        dsyslog("cFingerprintIndex::Learn(): separators of this recording already learned");
+        return;
+    }
+    learned = true;
+
+#ifdef POSIX
+    // other markad processes of this channel can learn at the same time, lock index from load to save
+    int lockFd = -1;
+    char *lockFileName = nullptr;
+    if (asprintf(&lockFileName, "%s.lock", fileName) != -1) {
+        ALLOC(strlen(lockFileName) + 1, "lockFileName");
+        lockFd = open(lockFileName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if ((lockFd >= 0) && (flock(lockFd, LOCK_EX) != 0)) {
+            close(lockFd);
+            lockFd = -1;
+        }
+        if (lockFd < 0) esyslog("cFingerprintIndex::Learn(): lock %s failed: %s", lockFileName, strerror(errno));
+        FREE(strlen(lockFileName) + 1, "lockFileName");
+        free(lockFileName);
+    }
+#endif
+
+    // merge with current index file, other markad processes can have changed it since constructor
+    separators.clear();
+    Load();
+
+    // remove separators without verified hit for a long time, if they still exist full analysis will learn them again
+    time_t now = time(nullptr);
+    size_t oldSize = separators.size();
+    separators.erase(std::remove_if(separators.begin(), separators.end(), [now](const sSeparator &separator) {
+        return difftime(now, separator.lastUsed) > (FINGERPRINT_MAX_AGE * 24 * 60 * 60);
+    }), separators.end());
+    if (separators.size() < oldSize) dsyslog("cFingerprintIndex::Learn(): %zu expired separators removed", oldSize - separators.size());
+
+    int newSeparators = 0;
+    for (cMark *mark = marks->GetFirst(); mark; mark = mark->Next()) {
+        int type = mark->type & 0x0F;
+        if ((type != MT_START) && (type != MT_STOP)) continue;
+        int center = GetTimelineIndex(mark->position);
+        if ((center - FINGERPRINT_SEPARATOR_LENGTH) < 0) continue;
+        if ((center + FINGERPRINT_SEPARATOR_LENGTH) > static_cast<int>(timeline.size())) continue;
+
+        // mark was confirmed by index without full analysis, do not count it as verified hit
+        bool isConfirmed = false;
+        for (int confirmedCenter : confirmed) {
+            if (abs(confirmedCenter - center) <= FINGERPRINT_RANGE) {
+                isConfirmed = true;
+                break;
+            }
+        }
+        if (isConfirmed) {
+            dsyslog("cFingerprintIndex::Learn(): mark (%5d): confirmed by known separator, not learned again", mark->position);
+            continue;
+        }
+
+        // known separator, count hit
+        bool known = false;
+        for (sSeparator &separator : separators) {
+            if ((separator.type == type) && Match(&separator, center)) {
+                separator.hits++;
+                separator.lastUsed = now;
+                known = true;
+                break;
+            }
+        }
+        if (known) continue;
+
+        // new separator, ignore static content, it will match everywhere
+        sSeparator separator;
+        separator.type     = type;
+        separator.hits     = 1;
+        separator.lastUsed = now;
+        int distinct       = 1;
+        for (int i = 0; i < 2 * FINGERPRINT_SEPARATOR_LENGTH; i++) {
+            separator.signature[i] = timeline[center - FINGERPRINT_SEPARATOR_LENGTH + i];
+            separator.signature[i].packetNumber = -1;  // position is only valid in this recording
+            if ((i > 0) && (__builtin_popcountll(separator.signature[i].dHash ^ separator.signature[i - 1].dHash) > FINGERPRINT_HAMMING_MAX)) distinct++;
+        }
+        if (distinct < FINGERPRINT_MIN_DISTINCT) {
+            dsyslog("cFingerprintIndex::Learn(): mark (%5d): only %d distinct signatures, ignore separator", mark->position, distinct);
+            continue;
+        }
+        separators.push_back(separator);
+        newSeparators++;
+    }
+
+    // keep most recent verified separators, more hits first for same time, so new separators replace least recently verified ones
+    std::stable_sort(separators.begin(), separators.end(), [](const sSeparator &a, const sSeparator &b) {
+        if (a.lastUsed != b.lastUsed) return a.lastUsed > b.lastUsed;
+        return a.hits > b.hits;
+    });
+    if (separators.size() > FINGERPRINT_MAX_SEPARATORS) separators.resize(FINGERPRINT_MAX_SEPARATORS);
+
+    dsyslog("cFingerprintIndex::Learn(): %d new separators learned, %zu known separators", newSeparators, separators.size());
+    Save();
+
+#ifdef POSIX
+    if (lockFd >= 0) close(lockFd);  // release lock
+#endif
+}
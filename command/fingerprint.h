@@ -0,0 +1,169 @@
+/*
+ * fingerprint.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __fingerprint_h_
+#define __fingerprint_h_
+
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+#include "tools.h"
+#include "marks.h"
+#include "decoder.h"
+
+
+#define FINGERPRINT_VERSION              1   // version of fingerprint index file
+#define FINGERPRINT_SEPARATOR_LENGTH     8   // seconds of signatures before and after a separator
+#define FINGERPRINT_MAX_SEPARATORS      64   // max count of known separators per channel
+#define FINGERPRINT_HAMMING_MAX          8   // max average hamming distance (of 64 bit) per signature of a matching separator
+#define FINGERPRINT_BRIGHTNESS_MAX      16   // max average brightness difference per signature of a matching separator
+#define FINGERPRINT_MIN_DISTINCT         6   // min count of distinct signatures, static separators (e.g. black screen) are not unique
+#define FINGERPRINT_RANGE                2   // max distance in seconds of a mark from a known separator to be confirmed
+#define FINGERPRINT_MIN_HITS             3   // min count of recordings with this separator verified by full analysis before it confirms a mark
+#define FINGERPRINT_MAX_AGE             90   // days without a verified hit after that a separator is removed from index
+
+
+/**
+ * signature of one second of video
+ */
+typedef struct sSignature {
+    uint64_t dHash   = 0;     //!< difference hash of the first picture of this second
+    //!<
+    int brightness   = 0;     //!< average brightness of the first picture of this second
+    //!<
+    int packetNumber = -1;    //!< packet number of the picture
+    //!<
+} sSignature;
+
+
+/**
+ * known separator between broadcast and advertising of a channel
+ */
+typedef struct sSeparator {
+    int type        = MT_UNDEFINED;   //!< MT_START or MT_STOP
+    //!<
+    int hits        = 0;              //!< count of recordings with this separator verified by full analysis
+    //!<
+    time_t lastUsed = 0;              //!< time of last recording with this separator verified by full analysis
+    //!<
+    sSignature signature[2 * FINGERPRINT_SEPARATOR_LENGTH];  //!< signatures before and after separator, first signature after separator at index FINGERPRINT_SEPARATOR_LENGTH
+    //!<
+} sSeparator;
+
+
+/**
+ * per channel index of separators between broadcast and advertising, shared by all recordings of this channel <br>
+ * stored in logo cache directory, learned from final marks of each successful run <br>
+ * a mark at the position of a separator with at least FINGERPRINT_MIN_HITS hits was already verified by full analysis in former recordings <br>
+ * marks confirmed by the index are not learned again, so the index can not confirm itself and separators without full analysis expire
+ */
+class cFingerprintIndex : private cTools {
+public:
+
+    /**
+     * constructor, load fingerprint index of channel
+     * @param decoderParam           pointer to decoder
+     * @param logoCacheDirectoryParam logo cache directory
+     * @param channelNameParam       channel name
+     */
+    cFingerprintIndex(cDecoder *decoderParam, const char *logoCacheDirectoryParam, const char *channelNameParam);
+
+    ~cFingerprintIndex();
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cFingerprintIndex(const cFingerprintIndex &origin) {
+        decoder    = origin.decoder;
+        fileName   = nullptr;
+        separators = origin.separators;
+        timeline   = origin.timeline;
+        lastSecond = origin.lastSecond;
+        confirmed  = origin.confirmed;
+        learned    = origin.learned;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cFingerprintIndex &operator =(const cFingerprintIndex *origin) {
+        decoder    = origin->decoder;
+        fileName   = nullptr;
+        separators = origin->separators;
+        timeline   = origin->timeline;
+        lastSecond = origin->lastSecond;
+        confirmed  = origin->confirmed;
+        learned    = origin->learned;
+        return *this;
+    };
+
+    /**
+     * add signature of current video frame to timeline of recording, only first picture of each second is used
+     */
+    void Process();
+
+    /**
+     * check if mark is at position of a known separator of this channel
+     * @param position packet number of mark
+     * @param type     mark type, only MT_START or MT_STOP part is used
+     * @return true if a known separator matches, false otherwise
+     */
+    bool IsKnownSeparator(const int position, const int type);
+
+    /**
+     * learn separators from final marks and save fingerprint index file, only once per recording <br>
+     * index file is locked while load, merge and save, other markad processes of same channel can learn at the same time
+     * @param marks final marks of recording
+     */
+    void Learn(cMarks *marks);
+
+private:
+
+    /**
+     * load fingerprint index file
+     * @return true if successful, false otherwise
+     */
+    bool Load();
+
+    /**
+     * save fingerprint index file
+     * @return true if successful, false otherwise
+     */
+    bool Save();
+
+    /**
+     * get index of first signature in timeline at or after position
+     * @param position packet number
+     * @return index of signature, timeline size if position is after last signature
+     */
+    int GetTimelineIndex(const int position) const;
+
+    /**
+     * compare separator with signatures of timeline
+     * @param separator known separator
+     * @param center    index of first timeline signature after separator
+     * @return true if separator matches, false otherwise
+     */
+    bool Match(const sSeparator *separator, const int center) const;
+
+    cDecoder *decoder = nullptr;          //!< pointer to decoder
+    //!<
+    char *fileName    = nullptr;          //!< file name of fingerprint index
+    //!<
+    std::vector<sSeparator> separators;   //!< known separators of channel
+    //!<
+    std::vector<sSignature> timeline;     //!< one signature per second of current recording
+    //!<
+    int lastSecond    = -1;               //!< second of last signature in timeline
+    //!<
+    std::vector<int> confirmed;           //!< timeline index of marks confirmed by a known separator, not learned again
+    //!<
+    bool learned      = false;            //!< true if separators of this recording are already learned
+    //!<
+};
+#endif
@@ -0,0 +1,743 @@
+/*
+ * generator.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <inttypes.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "generator.h"
+
+// global variable
+extern bool abortNow;
+
+#define GENERATOR_SAMPLE_RATE 48000
+#define GENERATOR_TONE        440     // frequency of test tone in Hz
+
+
+/**
+ * hash of picture block, same seed and block gives same value
+ * @param seed  seed of segment
+ * @param x     block column
+ * @param y     block line
+ * @return hash value
+ */
+static uint32_t BlockHash(const int seed, const int x, const int y) {
+    uint32_t hash = (static_cast<uint32_t>(seed) * 73856093U) ^ (static_cast<uint32_t>(x) * 19349663U) ^ (static_cast<uint32_t>(y) * 83492791U);
+    hash ^= hash >> 13;
+    hash *= 0x5BD1E995U;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+
+cGenerator::cGenerator(const char *recDirParam) {
+    recDir = recDirParam;
+}
+
+
+cGenerator::~cGenerator() {
+    Close();
+}
+
+
+bool cGenerator::ReadScript(const char *scriptFile) {
+    if (!scriptFile) return false;
+    FILE *script = fopen(scriptFile, "r");
+    if (!script) {
+        esyslog("cGenerator::ReadScript(): failed to open script %s", scriptFile);
+        return false;
+    }
+    segments.clear();
+    bool valid      = true;
+    char *line      = nullptr;
+    size_t length   = 0;
+    int lineNumber  = 0;
+    while (valid && (getline(&line, &length, script) != -1)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = 0;
+        char *end = line + strlen(line);
+        while ((end > line) && isspace(*(end - 1))) *(--end) = 0;
+        char *start = line;
+        while (isspace(*start)) start++;
+        if (*start == 0) continue;
+
+        char keyword[16] = {0};
+        if (sscanf(start, "%15s", keyword) != 1) continue;
+        const char *parameter = start + strlen(keyword);
+        while (isspace(*parameter)) parameter++;
+
+        if (strcmp(keyword, "video") == 0) {
+            char codec[16] = {0};
+            if (sscanf(parameter, "%15s %dx%d %d", codec, &width, &height, &frameRate) != 4) valid = false;
+            else if (strcmp(codec, "mpeg2") == 0) codecID = AV_CODEC_ID_MPEG2VIDEO;
+            else if (strcmp(codec, "h264")  == 0) codecID = AV_CODEC_ID_H264;
+            else if (strcmp(codec, "hevc")  == 0) codecID = AV_CODEC_ID_H265;
+            else valid = false;
+            if ((width < 64) || (height < 64) || ((width % 2) != 0) || ((height % 2) != 0) || (frameRate < 1) || (frameRate > 60)) valid = false;
+        }
+        else if (strcmp(keyword, "channel") == 0) {
+            if (*parameter == 0) valid = false;
+            else {
+                strncpy(channelName, parameter, sizeof(channelName) - 1);
+                channelName[sizeof(channelName) - 1] = 0;
+            }
+        }
+        else if (strcmp(keyword, "logo") == 0) {
+            char corner[16] = {0};
+            int count = sscanf(parameter, "%15s %dx%d", corner, &logoWidth, &logoHeight);
+            if ((count != 1) && (count != 3)) valid = false;
+            else if (strcmp(corner, "TOP_LEFT")     == 0) logoCorner = TOP_LEFT;
+            else if (strcmp(corner, "TOP_RIGHT")    == 0) logoCorner = TOP_RIGHT;
+            else if (strcmp(corner, "BOTTOM_LEFT")  == 0) logoCorner = BOTTOM_LEFT;
+            else if (strcmp(corner, "BOTTOM_RIGHT") == 0) logoCorner = BOTTOM_RIGHT;
+            else valid = false;
+        }
+        else if (strcmp(keyword, "audio") == 0) {
+            audio = 0;
+            if (strstr(parameter, "ac3")) audio |= GENERATOR_AUDIO_AC3;
+            if (strstr(parameter, "mp2")) audio |= GENERATOR_AUDIO_MP2;
+        }
+        else valid = ParseSegment(start);
+
+        if (!valid) esyslog("cGenerator::ReadScript(): %s line %d is invalid: %s", scriptFile, lineNumber, start);
+    }
+    if (line) free(line);
+    fclose(script);
+
+    if (valid && segments.empty()) {
+        esyslog("cGenerator::ReadScript(): %s has no segments", scriptFile);
+        valid = false;
+    }
+    if (!valid) return false;
+
+    CalculateMarks();
+    dsyslog("cGenerator::ReadScript(): video codec %d %dx%d %d fps, logo corner %d, audio 0x%X, %zu segments, %zu ground truth marks", codecID, width, height, frameRate, logoCorner, audio, segments.size(), marks.size());
+    return true;
+}
+
+
+bool cGenerator::ParseSegment(const char *line) {
+    if (!line) return false;
+    sGeneratorSegment segment;
+    char type[16] = {0};
+    int offset    = 0;
+    if (sscanf(line, "%15s %d%n", type, &segment.length, &offset) != 2) return false;
+    if (segment.length <= 0) return false;
+
+    // defaults of content type, ad and black screen are without logo and with AC3 2.0
+    if (strcmp(type, "broadcast") == 0) segment.type = GENERATOR_BROADCAST;
+    else if (strcmp(type, "ad") == 0) {
+        segment.type        = GENERATOR_AD;
+        segment.logo        = false;
+        segment.ac3Channels = 2;
+    }
+    else if (strcmp(type, "black") == 0) {
+        segment.type        = GENERATOR_BLACK;
+        segment.logo        = false;
+        segment.ac3Channels = 2;
+        segment.silence     = true;
+    }
+    else return false;
+    segment.seed = segments.size() + 1;  // each segment has its own content if no seed is set
+
+    // options
+    const char *option = line + offset;
+    char value[16]     = {0};
+    while (*option) {
+        while (isspace(*option)) option++;
+        if (*option == 0) break;
+        if (sscanf(option, "seed=%d", &segment.seed) == 1) {}
+        else if (sscanf(option, "border=%15s", value) == 1) {
+            if (strcmp(value, "none") == 0)         segment.border = GENERATOR_BORDER_NONE;
+            else if (strcmp(value, "hborder") == 0) segment.border = GENERATOR_BORDER_H;
+            else if (strcmp(value, "vborder") == 0) segment.border = GENERATOR_BORDER_V;
+            else return false;
+        }
+        else if (sscanf(option, "logo=%15s", value) == 1)    segment.logo    = (strcmp(value, "yes") == 0);
+        else if (sscanf(option, "silence=%15s", value) == 1) segment.silence = (strcmp(value, "yes") == 0);
+        else if (sscanf(option, "ac3=%15s", value) == 1) {
+            if (strcmp(value, "2.0") == 0)      segment.ac3Channels = 2;
+            else if (strcmp(value, "5.1") == 0) segment.ac3Channels = 6;
+            else return false;
+        }
+        else return false;
+        while (*option && !isspace(*option)) option++;
+    }
+    segments.push_back(segment);
+    return true;
+}
+
+
+void cGenerator::CalculateMarks() {
+    marks.clear();
+    int frame           = 0;
+    bool inBroadcast    = false;
+    for (const sGeneratorSegment &segment : segments) {
+        bool broadcast = (segment.type == GENERATOR_BROADCAST);
+        if (broadcast && !inBroadcast) {
+            sGeneratorMark mark;
+            mark.type     = MT_START;
+            mark.position = frame;
+            marks.push_back(mark);
+        }
+        else if (!broadcast && inBroadcast) {
+            sGeneratorMark mark;
+            mark.type     = MT_STOP;
+            mark.position = frame - 1;
+            marks.push_back(mark);
+        }
+        inBroadcast = broadcast;
+        frame += segment.length * frameRate;
+    }
+    if (inBroadcast) {
+        sGeneratorMark mark;
+        mark.type     = MT_STOP;
+        mark.position = frame - 1;
+        marks.push_back(mark);
+    }
+}
+
+
+bool cGenerator::Generate() {
+    if (!recDir) return false;
+    if (segments.empty()) return false;
+    if (!Open()) {
+        Close();
+        return false;
+    }
+
+    int64_t frameNumber = 0;
+    bool ok = true;
+    for (const sGeneratorSegment &segment : segments) {
+        dsyslog("cGenerator::Generate(): frame (%6" PRId64 "): segment type %d, %ds, seed %d, border %d, logo %d, AC3 channels %d, silence %d", frameNumber, segment.type, segment.length, segment.seed, segment.border, segment.logo, segment.ac3Channels, segment.silence);
+        // channel layout of AC3 stream changes, same as on channel with 5.1 broadcast and 2.0 ads
+        if ((audio & GENERATOR_AUDIO_AC3) && (segment.ac3Channels != ac3OpenChannels) && !OpenAC3(segment.ac3Channels)) {
+            ok = false;
+            break;
+        }
+        int frames = segment.length * frameRate;
+        for (int segmentFrame = 0; segmentFrame < frames; segmentFrame++) {
+            if (abortNow) {
+                ok = false;
+                break;
+            }
+            if (av_frame_make_writable(videoFrame) < 0) {
+                ok = false;
+                break;
+            }
+            DrawPicture(&segment, segmentFrame);
+            videoFrame->pts = frameNumber;
+            if (!Encode(videoCtx, videoStream, videoFrame)) {
+                ok = false;
+                break;
+            }
+            frameNumber++;
+
+            // audio up to end of current video frame
+            int64_t audioEnd = frameNumber * GENERATOR_SAMPLE_RATE / frameRate;
+            while (ok && ac3Ctx && (ac3Samples < audioEnd)) {
+                if (av_frame_make_writable(ac3Frame) < 0) ok = false;
+                else {
+                    FillAudio(ac3Frame, ac3Samples, segment.silence);
+                    ac3Frame->pts = ac3Samples;
+                    ok = Encode(ac3Ctx, ac3Stream, ac3Frame);
+                    ac3Samples += ac3Frame->nb_samples;
+                }
+            }
+            while (ok && mp2Ctx && (mp2Samples < audioEnd)) {
+                if (av_frame_make_writable(mp2Frame) < 0) ok = false;
+                else {
+                    FillAudio(mp2Frame, mp2Samples, segment.silence);
+                    mp2Frame->pts = mp2Samples;
+                    ok = Encode(mp2Ctx, mp2Stream, mp2Frame);
+                    mp2Samples += mp2Frame->nb_samples;
+                }
+            }
+            if (!ok) break;
+        }
+        if (!ok) break;
+    }
+
+    // flush encoders
+    if (ok) ok = Encode(videoCtx, videoStream, nullptr);
+    if (ok && ac3Ctx) ok = Encode(ac3Ctx, ac3Stream, nullptr);
+    if (ok && mp2Ctx) ok = Encode(mp2Ctx, mp2Stream, nullptr);
+    if (ok && (av_write_trailer(avctxOut) < 0)) {
+        esyslog("cGenerator::Generate(): failed to write trailer");
+        ok = false;
+    }
+    Close();
+    if (!ok) {
+        esyslog("cGenerator::Generate(): failed to generate recording at frame (%" PRId64 ")", frameNumber);
+        return false;
+    }
+    if (!WriteInfo() || !WriteMarks()) return false;
+    isyslog("synthetic recording with %" PRId64 " frames and %zu ground truth marks generated", frameNumber, marks.size());
+    return true;
+}
+
+
+bool cGenerator::Open() {
+    char *fileName = nullptr;
+    if (asprintf(&fileName, "%s/00001.ts", recDir) == -1) return false;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    avformat_alloc_output_context2(&avctxOut, nullptr, "mpegts", fileName);
+    if (!avctxOut) {
+        esyslog("cGenerator::Open(): failed to allocate mpeg ts output context");
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+
+    // video stream
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+(1<<8)+100) // ffmpeg 4.5
+    const AVCodec *codec = avcodec_find_encoder(codecID);
+#else
+    AVCodec *codec = avcodec_find_encoder(codecID);
+#endif
+    if (!codec) {
+        esyslog("cGenerator::Open(): no encoder for video codec %d", codecID);
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+    AVStream *stream = avformat_new_stream(avctxOut, nullptr);
+    videoCtx         = avcodec_alloc_context3(codec);
+    if (!stream || !videoCtx) {
+        esyslog("cGenerator::Open(): failed to allocate video stream");
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+    videoStream                    = stream->index;
+    videoCtx->width                = width;
+    videoCtx->height               = height;
+    videoCtx->pix_fmt              = AV_PIX_FMT_YUV420P;
+    videoCtx->time_base            = {1, frameRate};
+    videoCtx->framerate            = {frameRate, 1};
+    videoCtx->gop_size             = frameRate / 2;   // same as broadcast
+    videoCtx->keyint_min           = videoCtx->gop_size;
+    videoCtx->max_b_frames         = 0;               // decode order is presentation order, packet number is frame number of ground truth marks
+    av_reduce(&videoCtx->sample_aspect_ratio.num, &videoCtx->sample_aspect_ratio.den, 16 * height, 9 * width, INT_MAX);  // 16:9
+    if (codecID == AV_CODEC_ID_MPEG2VIDEO) videoCtx->bit_rate = static_cast<int64_t>(width) * height * frameRate / 4;
+    else {
+        av_opt_set(videoCtx->priv_data, "preset", "veryfast", 0);
+        av_opt_set(videoCtx->priv_data, "crf", "23", 0);
+    }
+    if (avcodec_open2(videoCtx, codec, nullptr) < 0) {
+        esyslog("cGenerator::Open(): failed to open video encoder %s", codec->name);
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+    avcodec_parameters_from_context(stream->codecpar, videoCtx);
+    stream->time_base = videoCtx->time_base;
+
+    videoFrame = av_frame_alloc();
+    if (!videoFrame) {
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+    videoFrame->format = videoCtx->pix_fmt;
+    videoFrame->width  = width;
+    videoFrame->height = height;
+    if (av_frame_get_buffer(videoFrame, 0) < 0) {
+        esyslog("cGenerator::Open(): failed to allocate video frame");
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+
+    // audio streams
+    if ((audio & GENERATOR_AUDIO_AC3) && !OpenAC3(segments.front().ac3Channels)) {
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return false;
+    }
+    if (audio & GENERATOR_AUDIO_MP2) {
+        codec  = avcodec_find_encoder(AV_CODEC_ID_MP2);
+        stream = avformat_new_stream(avctxOut, nullptr);
+        if (codec && stream) mp2Ctx = avcodec_alloc_context3(codec);
+        if (!mp2Ctx) {
+            esyslog("cGenerator::Open(): failed to allocate MP2 stream");
+            FREE(strlen(fileName) + 1, "fileName");
+            free(fileName);
+            return false;
+        }
+        mp2Stream           = stream->index;
+        mp2Ctx->sample_rate = GENERATOR_SAMPLE_RATE;
+        mp2Ctx->sample_fmt  = AV_SAMPLE_FMT_S16;
+        mp2Ctx->bit_rate    = 192000;
+        mp2Ctx->time_base   = {1, GENERATOR_SAMPLE_RATE};
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+        av_channel_layout_default(&mp2Ctx->ch_layout, 2);
+#else
+        mp2Ctx->channel_layout = AV_CH_LAYOUT_STEREO;
+        mp2Ctx->channels       = 2;
+#endif
+        if (avcodec_open2(mp2Ctx, codec, nullptr) < 0) {
+            esyslog("cGenerator::Open(): failed to open MP2 encoder");
+            FREE(strlen(fileName) + 1, "fileName");
+            free(fileName);
+            return false;
+        }
+        avcodec_parameters_from_context(stream->codecpar, mp2Ctx);
+        stream->time_base = mp2Ctx->time_base;
+
+        mp2Frame              = av_frame_alloc();
+        if (!mp2Frame) {
+            FREE(strlen(fileName) + 1, "fileName");
+            free(fileName);
+            return false;
+        }
+        mp2Frame->nb_samples  = mp2Ctx->frame_size;
+        mp2Frame->format      = mp2Ctx->sample_fmt;
+        mp2Frame->sample_rate = mp2Ctx->sample_rate;
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+        av_channel_layout_copy(&mp2Frame->ch_layout, &mp2Ctx->ch_layout);
+#else
+        mp2Frame->channel_layout = mp2Ctx->channel_layout;
+        mp2Frame->channels       = mp2Ctx->channels;
+#endif
+        if (av_frame_get_buffer(mp2Frame, 0) < 0) {
+            esyslog("cGenerator::Open(): failed to allocate MP2 frame");
+            FREE(strlen(fileName) + 1, "fileName");
+            free(fileName);
+            return false;
+        }
+    }
+
+    // write header
+    bool ok = true;
+    if (avio_open(&avctxOut->pb, fileName, AVIO_FLAG_WRITE) < 0) {
+        esyslog("cGenerator::Open(): failed to open %s", fileName);
+        ok = false;
+    }
+    else if (avformat_write_header(avctxOut, nullptr) < 0) {
+        esyslog("cGenerator::Open(): failed to write header to %s", fileName);
+        ok = false;
+    }
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+    if (!ok) return false;
+
+    // VDR index
+    char *indexName = nullptr;
+    if (asprintf(&indexName, "%s/index", recDir) == -1) return false;
+    ALLOC(strlen(indexName) + 1, "indexName");
+    indexFile = fopen(indexName, "w");
+    if (!indexFile) esyslog("cGenerator::Open(): failed to open %s", indexName);
+    FREE(strlen(indexName) + 1, "indexName");
+    free(indexName);
+    return (indexFile != nullptr);
+}
+
+
+bool cGenerator::OpenAC3(const int channels) {
+    // flush and close encoder with former channel layout, output stream stays the same
+    if (ac3Ctx) {
+        if (!Encode(ac3Ctx, ac3Stream, nullptr)) return false;
+        avcodec_free_context(&ac3Ctx);
+    }
+    if (ac3Frame) av_frame_free(&ac3Frame);
+    ac3OpenChannels = 0;
+
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+(1<<8)+100) // ffmpeg 4.5
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AC3);
+#else
+    AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AC3);
+#endif
+    if (!codec) {
+        esyslog("cGenerator::OpenAC3(): no AC3 encoder");
+        return false;
+    }
+    ac3Ctx = avcodec_alloc_context3(codec);
+    if (!ac3Ctx) return false;
+    ac3Ctx->sample_rate = GENERATOR_SAMPLE_RATE;
+    ac3Ctx->sample_fmt  = AV_SAMPLE_FMT_FLTP;
+    ac3Ctx->bit_rate    = (channels == 6) ? 448000 : 192000;
+    ac3Ctx->time_base   = {1, GENERATOR_SAMPLE_RATE};
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+    av_channel_layout_default(&ac3Ctx->ch_layout, channels);
+#else
+    ac3Ctx->channel_layout = av_get_default_channel_layout(channels);
+    ac3Ctx->channels       = channels;
+#endif
+    if (avcodec_open2(ac3Ctx, codec, nullptr) < 0) {
+        esyslog("cGenerator::OpenAC3(): failed to open AC3 encoder with %d channels", channels);
+        return false;
+    }
+    if (ac3Stream < 0) {  // stream parameter from first channel layout, header is not yet written
+        AVStream *stream = avformat_new_stream(avctxOut, nullptr);
+        if (!stream) return false;
+        ac3Stream = stream->index;
+        avcodec_parameters_from_context(stream->codecpar, ac3Ctx);
+        stream->time_base = ac3Ctx->time_base;
+    }
+
+    ac3Frame = av_frame_alloc();
+    if (!ac3Frame) return false;
+    ac3Frame->nb_samples  = ac3Ctx->frame_size;
+    ac3Frame->format      = ac3Ctx->sample_fmt;
+    ac3Frame->sample_rate = ac3Ctx->sample_rate;
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+    av_channel_layout_copy(&ac3Frame->ch_layout, &ac3Ctx->ch_layout);
+#else
+    ac3Frame->channel_layout = ac3Ctx->channel_layout;
+    ac3Frame->channels       = ac3Ctx->channels;
+#endif
+    if (av_frame_get_buffer(ac3Frame, 0) < 0) {
+        esyslog("cGenerator::OpenAC3(): failed to allocate AC3 frame");
+        return false;
+    }
+    ac3OpenChannels = channels;
+    return true;
+}
+
+
+void cGenerator::Close() {
+    if (videoCtx) avcodec_free_context(&videoCtx);
+    if (ac3Ctx) avcodec_free_context(&ac3Ctx);
+    if (mp2Ctx) avcodec_free_context(&mp2Ctx);
+    if (videoFrame) av_frame_free(&videoFrame);
+    if (ac3Frame) av_frame_free(&ac3Frame);
+    if (mp2Frame) av_frame_free(&mp2Frame);
+    if (avctxOut) {
+        if (avctxOut->pb) avio_closep(&avctxOut->pb);
+        avformat_free_context(avctxOut);
+        avctxOut = nullptr;
+    }
+    if (indexFile) {
+        fclose(indexFile);
+        indexFile = nullptr;
+    }
+}
+
+
+void cGenerator::DrawPicture(const sGeneratorSegment *segment, const int segmentFrame) {
+    if (!segment) return;
+    uchar *plane0   = videoFrame->data[0];
+    int lineSize0   = videoFrame->linesize[0];
+
+    // chroma planes are neutral, only luma has content
+    for (int plane = 1; plane < PLANES; plane++) {
+        for (int line = 0; line < height / 2; line++) memset(videoFrame->data[plane] + line * videoFrame->linesize[plane], 128, width / 2);
+    }
+    if (segment->type == GENERATOR_BLACK) {
+        for (int line = 0; line < height; line++) memset(plane0 + line * lineSize0, 16, width);
+        return;
+    }
+
+    // picture area inside border
+    int xStart = 0;
+    int xEnd   = width;
+    int yStart = 0;
+    int yEnd   = height;
+    if (segment->border == GENERATOR_BORDER_H) {
+        yStart = (height / 8) & ~1;
+        yEnd   = height - yStart;
+    }
+    else if (segment->border == GENERATOR_BORDER_V) {
+        xStart = (width / 8) & ~1;
+        xEnd   = width - xStart;
+    }
+
+    // moving blocks, block size and direction from seed, same seed and frame in segment gives same picture
+    int blockSize = 16 + ((segment->seed % 4) * 8);
+    int speedX    = 1 + (segment->seed % 5);
+    int speedY    = 1 + ((segment->seed / 5) % 3);
+    for (int line = 0; line < height; line++) {
+        uchar *pixel = plane0 + line * lineSize0;
+        if ((line < yStart) || (line >= yEnd)) {
+            memset(pixel, 16, width);
+            continue;
+        }
+        int blockY = (line + (segmentFrame * speedY)) / blockSize;
+        for (int column = 0; column < width; column++) {
+            if ((column < xStart) || (column >= xEnd)) pixel[column] = 16;
+            else pixel[column] = 40 + (BlockHash(segment->seed, (column + (segmentFrame * speedX)) / blockSize, blockY) % 180);
+        }
+    }
+    if (!segment->logo) return;
+
+    // opaque logo on same position in all segments with logo
+    int logoW   = ((logoWidth  > 0) ? logoWidth  : (width / 8)) & ~1;
+    int logoH   = ((logoHeight > 0) ? logoHeight : (height / 10)) & ~1;
+    int marginX = width / 20;
+    int marginY = height / 15;
+    int logoX   = ((logoCorner == TOP_LEFT) || (logoCorner == BOTTOM_LEFT)) ? marginX : (width - marginX - logoW);
+    int logoY   = ((logoCorner == TOP_LEFT) || (logoCorner == TOP_RIGHT))   ? marginY : (height - marginY - logoH);
+    int frame   = std::max(2, logoH / 8);
+    for (int line = 0; line < logoH; line++) {
+        uchar *pixel = plane0 + ((logoY + line) * lineSize0) + logoX;
+        for (int column = 0; column < logoW; column++) {
+            bool white = (line < frame) || (line >= (logoH - frame)) || (column < frame) || (column >= (logoW - frame));             // frame
+            white |= (column >= logoW / 6) && (column < logoW / 3) && (line >= logoH / 4) && (line < (3 * logoH) / 4);              // vertical bar
+            white |= (column >= logoW / 2) && (column < (5 * logoW) / 6) && (line >= (logoH / 2) - frame) && (line < (logoH / 2) + frame);  // horizontal bar
+            pixel[column] = white ? 235 : 30;
+        }
+    }
+}
+
+
+void cGenerator::FillAudio(AVFrame *frame, const int64_t sampleStart, const bool silence) {
+    if (!frame) return;
+#if LIBAVCODEC_VERSION_INT >= ((59<<16)+( 25<<8)+100)
+    int channels = frame->ch_layout.nb_channels;
+#else
+    int channels = frame->channels;
+#endif
+    for (int sample = 0; sample < frame->nb_samples; sample++) {
+        double value = 0;
+        if (!silence) value = 0.25 * sin(2 * M_PI * GENERATOR_TONE * (sampleStart + sample) / GENERATOR_SAMPLE_RATE);
+        for (int channel = 0; channel < channels; channel++) {
+            if (frame->format == AV_SAMPLE_FMT_FLTP) reinterpret_cast<float *>(frame->data[channel])[sample] = value;
+            else reinterpret_cast<int16_t *>(frame->data[0])[(sample * channels) + channel] = static_cast<int16_t>(value * INT16_MAX);
+        }
+    }
+}
+
+
+bool cGenerator::Encode(AVCodecContext *codecCtx, const int streamIndex, AVFrame *frame) {
+    if (!codecCtx) return false;
+    if (avcodec_send_frame(codecCtx, frame) < 0) {
+        esyslog("cGenerator::Encode(): stream %d: avcodec_send_frame() failed", streamIndex);
+        return false;
+    }
+    AVPacket *avpkt = av_packet_alloc();
+    if (!avpkt) return false;
+    bool ok = true;
+    while (ok) {
+        int rc = avcodec_receive_packet(codecCtx, avpkt);
+        if ((rc == AVERROR(EAGAIN)) || (rc == AVERROR_EOF)) break;
+        if (rc < 0) {
+            esyslog("cGenerator::Encode(): stream %d: avcodec_receive_packet() failed", streamIndex);
+            ok = false;
+            break;
+        }
+        avpkt->stream_index = streamIndex;
+        av_packet_rescale_ts(avpkt, codecCtx->time_base, avctxOut->streams[streamIndex]->time_base);
+        // write without interleave buffer, index needs file offset of each video packet
+        if (streamIndex == videoStream) {
+            // mpegts muxer buffers audio PES, write them out first, otherwise the offset points to audio packets
+            // offset of key packets includes PAT/PMT in front of them, same as VDR
+            if (av_write_frame(avctxOut, nullptr) < 0) {
+                esyslog("cGenerator::Encode(): stream %d: flush muxer failed", streamIndex);
+                ok = false;
+                av_packet_unref(avpkt);
+                break;
+            }
+            WriteIndex(avio_tell(avctxOut->pb), (avpkt->flags & AV_PKT_FLAG_KEY) != 0);
+        }
+        if (av_write_frame(avctxOut, avpkt) < 0) {
+            esyslog("cGenerator::Encode(): stream %d: av_write_frame() failed", streamIndex);
+            ok = false;
+        }
+        av_packet_unref(avpkt);
+    }
+    av_packet_free(&avpkt);
+    return ok;
+}
+
+
+void cGenerator::WriteIndex(const int64_t offset, const bool independent) {
+    if (!indexFile) return;
+    // VDR tIndexTs: offset 40 bit, reserved 7 bit, independent 1 bit, file number 16 bit
+    uint64_t entry = (static_cast<uint64_t>(offset) & 0xFFFFFFFFFFULL) | (independent ? (1ULL << 47) : 0) | (1ULL << 48);
+    uint8_t buffer[8];
+    for (int i = 0; i < 8; i++) buffer[i] = (entry >> (8 * i)) & 0xFF;
+    if (fwrite(buffer, sizeof(buffer), 1, indexFile) != 1) esyslog("cGenerator::WriteIndex(): write failed");
+}
+
+
+bool cGenerator::WriteInfo() const {
+    // recording start from directory name, same as VDR, otherwise recording ends now
+    int totalLength = 0;
+    for (const sGeneratorSegment &segment : segments) totalLength += segment.length;
+    time_t recordingStart = time(nullptr) - totalLength;
+    const char *timeString = strrchr(recDir, '/');
+    timeString = timeString ? timeString + 1 : recDir;
+    struct tm tm_r;
+    struct tm t = *localtime_r(&recordingStart, &tm_r);
+    if (sscanf(timeString, "%4d-%02d-%02d.%02d%*c%02d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min) == 5) {
+        t.tm_year -= 1900;
+        t.tm_mon--;
+        t.tm_sec   = 0;
+        t.tm_isdst = -1;
+        recordingStart = mktime(&t);
+    }
+
+    // event from first broadcast start to last broadcast stop
+    int eventStart  = 0;
+    int eventLength = totalLength;
+    if (marks.size() >= 2) {
+        eventStart  = marks.front().position / frameRate;
+        eventLength = (marks.back().position + 1) / frameRate - eventStart;
+    }
+
+    char *fileName = nullptr;
+    if (asprintf(&fileName, "%s/info", recDir) == -1) return false;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    FILE *info = fopen(fileName, "w");
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+    if (!info) {
+        esyslog("cGenerator::WriteInfo(): failed to write info file");
+        return false;
+    }
+    fprintf(info, "C S19.2E-1-1-1 %s\n", channelName);
+    fprintf(info, "E 1 %ld %d 4E 00\n", static_cast<long>(recordingStart + eventStart), eventLength);
+    fprintf(info, "T synthetic recording\n");
+    fprintf(info, "F %d %d %d p 16:9\n", frameRate, width, height);
+    switch (codecID) {
+    case AV_CODEC_ID_MPEG2VIDEO:
+        fprintf(info, "X 1 03 deu 16:9\n");
+        break;
+    case AV_CODEC_ID_H264:
+        fprintf(info, "X 5 0B deu HD 16:9\n");
+        break;
+    default:
+        fprintf(info, "X 9 00 deu UHD 16:9\n");
+        break;
+    }
+    if (audio & GENERATOR_AUDIO_MP2) fprintf(info, "X 2 03 deu stereo\n");
+    if (audio & GENERATOR_AUDIO_AC3) fprintf(info, "X 2 05 deu Dolby Digital %s\n", (segments.front().ac3Channels == 6) ? "5.1" : "2.0");
+    fprintf(info, "P 50\n");
+    fprintf(info, "L 99\n");
+    fclose(info);
+    return true;
+}
+
+
+bool cGenerator::WriteMarks() const {
+    char *fileName = nullptr;
+    if (asprintf(&fileName, "%s/marks.truth", recDir) == -1) return false;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    FILE *marksFile = fopen(fileName, "w");
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+    if (!marksFile) {
+        esyslog("cGenerator::WriteMarks(): failed to write ground truth marks");
+        return false;
+    }
+    for (const sGeneratorMark &mark : marks) {
+        int seconds = mark.position / frameRate;
+        fprintf(marksFile, "%d:%02d:%02d.%02d (%6d)%s generated %s\n", seconds / 3600, (seconds % 3600) / 60, seconds % 60, (mark.position % frameRate) + 1, mark.position, (mark.type == MT_START) ? "*" : " ", (mark.type == MT_START) ? "start" : "stop");
+    }
+    fclose(marksFile);
+    return true;
+}
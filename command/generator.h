@@ -0,0 +1,306 @@
+/*
+ * generator.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __generator_h_
+#define __generator_h_
+
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include "global.h"
+#include "debug.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/channel_layout.h>
+}
+
+
+// content type of a segment of synthetic recording
+enum {
+    GENERATOR_BROADCAST = 0,
+    GENERATOR_AD        = 1,
+    GENERATOR_BLACK     = 2
+};
+
+// border of a segment of synthetic recording
+enum {
+    GENERATOR_BORDER_NONE = 0,
+    GENERATOR_BORDER_H    = 1,   // letterbox, horizontal borders top and bottom
+    GENERATOR_BORDER_V    = 2    // pillarbox, vertical borders left and right
+};
+
+// audio streams of synthetic recording
+#define GENERATOR_AUDIO_AC3 0x01
+#define GENERATOR_AUDIO_MP2 0x02
+
+
+/**
+ * segment of synthetic recording
+ */
+typedef struct sGeneratorSegment {
+    int type        = GENERATOR_BROADCAST;    //!< content type
+    //!<
+    int length      = 0;                      //!< length in seconds
+    //!<
+    int seed        = 0;                      //!< seed of picture content, segments with same seed have same content
+    //!<
+    int border      = GENERATOR_BORDER_NONE;  //!< border of picture
+    //!<
+    bool logo       = true;                   //!< true if logo is visible
+    //!<
+    int ac3Channels = 6;                      //!< channels of AC3 stream, 2 or 6
+    //!<
+    bool silence    = false;                  //!< true if all audio streams are silent
+    //!<
+} sGeneratorSegment;
+
+
+/**
+ * mark of broadcast start or stop in synthetic recording
+ */
+typedef struct sGeneratorMark {
+    int type     = MT_UNDEFINED;   //!< MT_START or MT_STOP
+    //!<
+    int position = -1;             //!< frame number
+    //!<
+} sGeneratorMark;
+
+
+/**
+ * generate a VDR recording with scripted content and known marks <br>
+ * script file with one keyword per line, # starts a comment:
+ * - video \<mpeg2|h264|hevc\> \<width\>x\<height\> \<frame rate\>
+ * - channel \<channel name\>
+ * - logo \<TOP_LEFT|TOP_RIGHT|BOTTOM_LEFT|BOTTOM_RIGHT\> [\<width\>x\<height\>]
+ * - audio [ac3] [mp2]
+ * - \<broadcast|ad|black\> \<seconds\> [seed=\<n\>] [border=\<none|hborder|vborder\>] [logo=\<yes|no\>] [ac3=\<2.0|5.1\>] [silence=\<yes|no\>]
+ */
+class cGenerator {
+public:
+
+    /**
+     * constructor for synthetic recording generator
+     * @param recDirParam recording directory
+     */
+    explicit cGenerator(const char *recDirParam);
+
+    ~cGenerator();
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cGenerator(const cGenerator &origin) {
+        recDir      = origin.recDir;
+        codecID     = origin.codecID;
+        width       = origin.width;
+        height      = origin.height;
+        frameRate   = origin.frameRate;
+        logoCorner  = origin.logoCorner;
+        logoWidth   = origin.logoWidth;
+        logoHeight  = origin.logoHeight;
+        audio       = origin.audio;
+        segments    = origin.segments;
+        marks       = origin.marks;
+        memcpy(channelName, origin.channelName, sizeof(channelName));
+        avctxOut    = nullptr;
+        videoCtx    = nullptr;
+        ac3Ctx      = nullptr;
+        mp2Ctx      = nullptr;
+        videoFrame  = nullptr;
+        ac3Frame    = nullptr;
+        mp2Frame    = nullptr;
+        indexFile   = nullptr;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cGenerator &operator =(const cGenerator *origin) {
+        recDir      = origin->recDir;
+        codecID     = origin->codecID;
+        width       = origin->width;
+        height      = origin->height;
+        frameRate   = origin->frameRate;
+        logoCorner  = origin->logoCorner;
+        logoWidth   = origin->logoWidth;
+        logoHeight  = origin->logoHeight;
+        audio       = origin->audio;
+        segments    = origin->segments;
+        marks       = origin->marks;
+        memcpy(channelName, origin->channelName, sizeof(channelName));
+        avctxOut    = nullptr;
+        videoCtx    = nullptr;
+        ac3Ctx      = nullptr;
+        mp2Ctx      = nullptr;
+        videoFrame  = nullptr;
+        ac3Frame    = nullptr;
+        mp2Frame    = nullptr;
+        indexFile   = nullptr;
+        return *this;
+    };
+
+    /**
+     * read script of synthetic recording
+     * @param scriptFile script file name
+     * @return true if script is valid, false otherwise
+     */
+    bool ReadScript(const char *scriptFile);
+
+    /**
+     * write 00001.ts, index, info and ground truth marks file to recording directory
+     * @return true if successful, false otherwise
+     */
+    bool Generate();
+
+    /**
+     * get ground truth marks of generated recording
+     * @return vector of start and stop marks
+     */
+    const std::vector<sGeneratorMark> *GetMarks() const {
+        return &marks;
+    };
+
+    /**
+     * get frame rate of generated recording
+     * @return frames per second
+     */
+    int GetFrameRate() const {
+        return frameRate;
+    };
+
+private:
+    /**
+     * parse one segment line of script
+     * @param line segment line
+     * @return true if valid, false otherwise
+     */
+    bool ParseSegment(const char *line);
+
+    /**
+     * calculate ground truth marks from segments
+     */
+    void CalculateMarks();
+
+    /**
+     * open mpeg ts output and all encoders
+     * @return true if successful, false otherwise
+     */
+    bool Open();
+
+    /**
+     * close encoders and mpeg ts output
+     */
+    void Close();
+
+    /**
+     * open AC3 encoder with channel count, called again on each change of channels
+     * @param channels channel count, 2 or 6
+     * @return true if successful, false otherwise
+     */
+    bool OpenAC3(const int channels);
+
+    /**
+     * draw video picture of frame
+     * @param segment      current segment
+     * @param segmentFrame frame number in segment
+     */
+    void DrawPicture(const sGeneratorSegment *segment, const int segmentFrame);
+
+    /**
+     * fill audio frame with test tone or silence
+     * @param frame       audio frame
+     * @param sampleStart number of first sample in stream
+     * @param silence     true for silence
+     */
+    void FillAudio(AVFrame *frame, const int64_t sampleStart, const bool silence);
+
+    /**
+     * send frame to encoder and write all available packets
+     * @param codecCtx    encoder context
+     * @param streamIndex output stream index
+     * @param frame       frame to encode, nullptr to flush encoder
+     * @return true if successful, false otherwise
+     */
+    bool Encode(AVCodecContext *codecCtx, const int streamIndex, AVFrame *frame);
+
+    /**
+     * write VDR index entry of video packet
+     * @param offset      file offset of packet
+     * @param independent true if packet is a key packet
+     */
+    void WriteIndex(const int64_t offset, const bool independent);
+
+    /**
+     * write VDR info file
+     * @return true if successful, false otherwise
+     */
+    bool WriteInfo() const;
+
+    /**
+     * write ground truth marks in VDR marks file format to file marks.truth
+     * @return true if successful, false otherwise
+     */
+    bool WriteMarks() const;
+
+    const char *recDir                      = nullptr;               //!< recording directory
+    //!<
+    AVCodecID codecID                       = AV_CODEC_ID_H264;      //!< video codec
+    //!<
+    int width                               = 1280;                  //!< video width
+    //!<
+    int height                              = 720;                   //!< video height
+    //!<
+    int frameRate                           = 25;                    //!< frames per second
+    //!<
+    char channelName[64]                    = "Synthetic";           //!< channel name in info file
+    //!<
+    int logoCorner                          = TOP_RIGHT;             //!< logo corner
+    //!<
+    int logoWidth                           = 0;                     //!< logo width, 0 for default size from video width
+    //!<
+    int logoHeight                          = 0;                     //!< logo height, 0 for default size from video height
+    //!<
+    int audio                               = GENERATOR_AUDIO_AC3;   //!< audio streams
+    //!<
+    std::vector<sGeneratorSegment> segments;                         //!< segments of recording
+    //!<
+    std::vector<sGeneratorMark> marks;                               //!< ground truth marks
+    //!<
+    AVFormatContext *avctxOut               = nullptr;               //!< mpeg ts output
+    //!<
+    AVCodecContext *videoCtx                = nullptr;               //!< video encoder
+    //!<
+    AVCodecContext *ac3Ctx                  = nullptr;               //!< AC3 encoder
+    //!<
+    AVCodecContext *mp2Ctx                  = nullptr;               //!< MP2 encoder
+    //!<
+    AVFrame *videoFrame                     = nullptr;               //!< video picture
+    //!<
+    AVFrame *ac3Frame                       = nullptr;               //!< AC3 audio frame
+    //!<
+    AVFrame *mp2Frame                       = nullptr;               //!< MP2 audio frame
+    //!<
+    int videoStream                         = -1;                    //!< output stream index of video
+    //!<
+    int ac3Stream                           = -1;                    //!< output stream index of AC3
+    //!<
+    int mp2Stream                           = -1;                    //!< output stream index of MP2
+    //!<
+    int ac3OpenChannels                     = 0;                     //!< channels of open AC3 encoder
+    //!<
+    int64_t ac3Samples                      = 0;                     //!< samples sent to AC3 encoder
+    //!<
+    int64_t mp2Samples                      = 0;                     //!< samples sent to MP2 encoder
+    //!<
+    FILE *indexFile                         = nullptr;               //!< VDR index file
+    //!<
+};
+#endif
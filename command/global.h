@@ -274,10 +274,67 @@ typedef struct sAudioAC3Channels {
 } sAudioAC3Channels;
 
 
+/**
+ * audio level of a decoded MP2 frame
+ */
+typedef struct sAudioLevel {
+    int normVolume = -1;     //!< average absolute sample value of all channels, -1 if invalid
+    //!<
+    int rms        = -1;     //!< root mean square of sample values of all channels, -1 if invalid
+    //!<
+    int peak       = -1;     //!< max absolute sample value of all channels, -1 if invalid
+    //!<
+    bool complete  = false;  //!< true if all samples are scanned, false if scan stopped early at non silence, rms and peak are then only from scanned samples
+    //!<
+    int64_t pts    = -1;     //!< PTS of audio frame
+    //!<
+} sAudioLevel;
+
+
+/**
+ * state of video and audio detectors, used to compare detection of segments at segment border
+ */
+typedef struct sDetectorState {
+    int logo                 = 0;       //!< logo detection status
+    //!<
+    int scene                = 0;       //!< scene change detection status
+    //!<
+    int blackScreen          = 0;       //!< black screen detection status
+    //!<
+    int lowerBorder          = 0;       //!< lower border detection status
+    //!<
+    int hBorder              = 0;       //!< horizontal border detection status
+    //!<
+    int vBorder              = 0;       //!< vertical border detection status
+    //!<
+    sAspectRatio aspectRatio = {};      //!< video aspect ratio of last frame
+    //!<
+    int64_t silenceStartPTS  = -1;      //!< audio PTS of start of current silence, -1 if none
+    //!<
+    int64_t silenceStopPTS   = -1;      //!< audio PTS of end of last silence without marks, -1 if none
+    //!<
+    bool reducedPlanes       = false;   //!< true if logo detection is reduced to plane 0
+    //!<
+
+    /**
+     *  operator ==
+     */
+    bool operator == (const sDetectorState& other) const {
+        return (logo == other.logo) && (scene == other.scene) && (blackScreen == other.blackScreen) && (lowerBorder == other.lowerBorder) &&
+               (hBorder == other.hBorder) && (vBorder == other.vBorder) && (aspectRatio == other.aspectRatio) &&
+               (silenceStartPTS == other.silenceStartPTS) && (silenceStopPTS == other.silenceStopPTS) && (reducedPlanes == other.reducedPlanes);
+    }
+} sDetectorState;
+
+
 /**
  * corner area after sobel transformation
  */
 typedef struct sAreaT {
+    uchar *buffer                = nullptr;              //!< one 64 byte aligned memory block with all planes of sobel, logo, result and inverse
+    //!<
+    size_t bufferSize            = 0;                    //!< size of memory block
+    //!<
     uchar **sobel                = nullptr;              //!< monochrome picture from edge after sobel transformation, memory will be allocated after we know video resolution
     //!<
     uchar **logo                 = nullptr;              //!< monochrome mask of logo, memory will be allocated after we know video resolution
@@ -17,6 +17,32 @@ cIndex::cIndex(const bool fullDecodeParam) {
 }
 
 
+cIndex::cIndex(const cIndex &origin) {
+    fullDecode   = origin.fullDecode;
+    start_time   = origin.start_time;
+    time_base    = origin.time_base;
+    rollover     = origin.rollover;
+    indexVector  = origin.indexVector;
+    pSliceVector = origin.pSliceVector;
+    ptsRing.reserve(MAX_PTSRING + 2);
+    ptsRing      = origin.ptsRing;
+#ifdef DEBUG_MEM
+    int size = indexVector.size();
+    for (int i = 0 ; i < size; i++) {
+        ALLOC(sizeof(sIndexElement), "indexVector");
+    }
+    size = ptsRing.size();
+    for (int i = 0 ; i < size; i++) {
+        ALLOC(sizeof(sPTS_RingbufferElement), "ptsRing");
+    }
+    size = pSliceVector.size();
+    for (int i = 0 ; i < size; i++) {
+        ALLOC(sizeof(int64_t), "pSliceVector");
+    }
+#endif
+}
+
+
 cIndex::~cIndex() {
 #ifdef DEBUG_MEM
     int size = indexVector.size();
@@ -51,7 +77,7 @@ int64_t cIndex::GetStartPTS() const {
 
 
 // add a new entry to the list of frame timestamps
-void cIndex::Add(const int fileNumber, const int packetNumber, const int64_t pts) {
+void cIndex::Add(const int fileNumber, const int packetNumber, const int64_t pts, const int64_t pos) {
     if (indexVector.empty() || (packetNumber > indexVector.back().packetNumber)) { // only add new packets to index
         if (!indexVector.empty() && !rollover) {
             if ((indexVector.back().pts > 0x200000000) && (pts < 0x200000000)) {  // PTS/DTS rollover
@@ -63,6 +89,7 @@ void cIndex::Add(const int fileNumber, const int packetNumber, const int64_t pts
         newIndex.fileNumber         = fileNumber;
         newIndex.packetNumber       = packetNumber;
         newIndex.pts                = pts;
+        newIndex.pos                = pos;
         newIndex.rollover           = rollover;
 
         if (indexVector.size() == indexVector.capacity()) {
@@ -204,6 +231,15 @@ sIndexElement *cIndex::GetLastPacket() {
 }
 
 
+sIndexElement *cIndex::GetKeyPacket(const int packetNumber) {
+    if (indexVector.empty()) return nullptr;
+    // index is sorted by packet number
+    std::vector<sIndexElement>::iterator found = std::lower_bound(indexVector.begin(), indexVector.end(), packetNumber, [](const sIndexElement &value, const int number) ->bool { return value.packetNumber < number; });
+    if ((found != indexVector.end()) && (found->packetNumber == packetNumber)) return &(*found);
+    return nullptr;
+}
+
+
 // get key packet before given packet
 // if packet is a key packet, key packet before will be returned
 // return: key packet number, -1 if index is not initialized
@@ -31,6 +31,8 @@ typedef struct sIndexElement {
     //!<
     int64_t pts       = -1;             //!< pts of i-frame
     //!<
+    int64_t pos       = -1;             //!< byte position of packet in recording (all ts files as one stream), -1 if unknown
+    //!<
     bool rollover     = false;          //!< true for packets after PTS/DTS rollover
     //!<
     bool isPTSinSlice = true;           //!< false if H.264 packet and any PTS from P/B frame after has before slice start, only stop cut if true
@@ -50,13 +52,20 @@ public:
     explicit cIndex(const bool fullDecodeParam);
     ~cIndex();
 
+    /**
+     * copy constructor, gives a decoder in another thread its own copy of the index
+     * @param origin index to copy
+     */
+    cIndex(const cIndex &origin);
+
     /**
      * add new frame to index
      * @param fileNumber         number of ts file
      * @param packetNumber       number of packet
      * @param pts                frame PTS
+     * @param pos                byte position of packet in recording, -1 if unknown
      */
-    void Add(const int fileNumber, const int packetNumber, const int64_t pts);
+    void Add(const int fileNumber, const int packetNumber, const int64_t pts, const int64_t pos = -1);
 
     /**
      * get key packet number before PTS
@@ -82,6 +91,13 @@ public:
      */
     sIndexElement *GetLastPacket();
 
+    /**
+     * get index element of key packet
+     * @param packetNumber number of key packet
+     * @return pointer to index element, nullptr if packet is no key packet in index
+     */
+    sIndexElement *GetKeyPacket(const int packetNumber);
+
     /**
      * get packet number after packet
      * @param packetNumber number of packet
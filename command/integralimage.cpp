@@ -0,0 +1,105 @@
+/*
+ * integralimage.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <algorithm>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "integralimage.h"
+
+
+cIntegralImage::cIntegralImage() {
+}
+
+
+cIntegralImage::~cIntegralImage() {
+}
+
+
+bool cIntegralImage::Init(const uchar *plane, const int widthParam, const int heightParam) {
+    if (!plane) return false;
+    if ((widthParam <= 0) || (heightParam <= 0)) return false;
+    width  = widthParam;
+    height = heightParam;
+    sum.assign((width + 1) * (height + 1), 0);  // first line and column stay zero
+
+    const int stride = width + 1;
+    for (int line = 0; line < height; line++) {
+        const uchar *pixel = plane + (line * width);
+        int *above         = &sum[line * stride];
+        int *current       = &sum[(line + 1) * stride];
+        int lineSum        = 0;
+        for (int column = 0; column < width; column++) {
+            if (pixel[column] == 0) lineSum++;
+            current[column + 1] = above[column + 1] + lineSum;
+        }
+    }
+    return true;
+}
+
+
+int cIntegralImage::Count(int xStart, int yStart, int xEnd, int yEnd) const {
+    xStart = std::max(xStart, 0);
+    yStart = std::max(yStart, 0);
+    xEnd   = std::min(xEnd, width - 1);
+    yEnd   = std::min(yEnd, height - 1);
+    if ((xStart > xEnd) || (yStart > yEnd)) return 0;
+
+    const int stride = width + 1;
+    return sum[(yEnd + 1) * stride + xEnd + 1] - sum[yStart * stride + xEnd + 1] - sum[(yEnd + 1) * stride + xStart] + sum[yStart * stride + xStart];
+}
+
+
+// count of a growing range is monotonic, binary search for first range with more than minCount black pixel
+int cIntegralImage::FirstLine(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount) const {
+    int low  = yStart;
+    int high = yEnd + 1;
+    while (low < high) {
+        int middle = low + ((high - low) / 2);
+        if (Count(xStart, yStart, xEnd, middle) > minCount) high = middle;
+        else low = middle + 1;
+    }
+    return low;
+}
+
+
+int cIntegralImage::LastLine(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount) const {
+    int low  = yStart - 1;
+    int high = yEnd;
+    while (low < high) {
+        int middle = high - ((high - low) / 2);
+        if (Count(xStart, middle, xEnd, yEnd) > minCount) low = middle;
+        else high = middle - 1;
+    }
+    return low;
+}
+
+
+int cIntegralImage::FirstColumn(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount) const {
+    int low  = xStart;
+    int high = xEnd + 1;
+    while (low < high) {
+        int middle = low + ((high - low) / 2);
+        if (Count(xStart, yStart, middle, yEnd) > minCount) high = middle;
+        else low = middle + 1;
+    }
+    return low;
+}
+
+
+int cIntegralImage::LastColumn(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount) const {
+    int low  = xStart - 1;
+    int high = xEnd;
+    while (low < high) {
+        int middle = high - ((high - low) / 2);
+        if (Count(middle, yStart, xEnd, yEnd) > minCount) low = middle;
+        else high = middle - 1;
+    }
+    return low;
+}
@@ -0,0 +1,121 @@
+/*
+ * integralimage.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __integralimage_h_
+#define __integralimage_h_
+
+#include <vector>
+
+#include "global.h"
+#include "debug.h"
+
+
+/**
+ * summed-area table of black pixel (value 0) in a sobel transformed or logo plane <br>
+ * count of black pixel of any rectangle in constant time, search of first or last line or column with black pixel in logarithmic time
+ */
+class cIntegralImage {
+public:
+
+    cIntegralImage();
+
+    ~cIntegralImage();
+
+    /**
+     * build summed-area table from plane, has to be called again after each change of plane or plane size
+     * @param plane  plane data, width * height pixel without padding
+     * @param width  plane width
+     * @param height plane height
+     * @return true if successful, false otherwise
+     */
+    bool Init(const uchar *plane, const int width, const int height);
+
+    /**
+     * count black pixel in rectangle, coordinates are inclusive and clipped to plane
+     * @param xStart first column
+     * @param yStart first line
+     * @param xEnd   last column
+     * @param yEnd   last line
+     * @return count of black pixel, 0 for empty rectangle
+     */
+    int Count(int xStart, int yStart, int xEnd, int yEnd) const;
+
+    /**
+     * count black pixel in line
+     * @param line   line
+     * @param xStart first column
+     * @param xEnd   last column
+     * @return count of black pixel
+     */
+    int CountLine(const int line, const int xStart, const int xEnd) const {
+        return Count(xStart, line, xEnd, line);
+    }
+
+    /**
+     * count black pixel in column
+     * @param column column
+     * @param yStart first line
+     * @param yEnd   last line
+     * @return count of black pixel
+     */
+    int CountColumn(const int column, const int yStart, const int yEnd) const {
+        return Count(column, yStart, column, yEnd);
+    }
+
+    /**
+     * first line from yStart with more than minCount black pixel from yStart up to this line in column range
+     * @param xStart   first column
+     * @param yStart   first line
+     * @param xEnd     last column
+     * @param yEnd     last line
+     * @param minCount black pixel of lines yStart up to result have to be more than this count
+     * @return first line, yEnd + 1 if not found
+     */
+    int FirstLine(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount = 0) const;
+
+    /**
+     * last line up to yEnd with more than minCount black pixel from this line up to yEnd in column range
+     * @param xStart   first column
+     * @param yStart   first line
+     * @param xEnd     last column
+     * @param yEnd     last line
+     * @param minCount black pixel of lines result up to yEnd have to be more than this count
+     * @return last line, yStart - 1 if not found
+     */
+    int LastLine(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount = 0) const;
+
+    /**
+     * first column from xStart with more than minCount black pixel from xStart up to this column in line range
+     * @param xStart   first column
+     * @param yStart   first line
+     * @param xEnd     last column
+     * @param yEnd     last line
+     * @param minCount black pixel of columns xStart up to result have to be more than this count
+     * @return first column, xEnd + 1 if not found
+     */
+    int FirstColumn(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount = 0) const;
+
+    /**
+     * last column up to xEnd with more than minCount black pixel from this column up to xEnd in line range
+     * @param xStart   first column
+     * @param yStart   first line
+     * @param xEnd     last column
+     * @param yEnd     last line
+     * @param minCount black pixel of columns result up to xEnd have to be more than this count
+     * @return last column, xStart - 1 if not found
+     */
+    int LastColumn(const int xStart, const int yStart, const int xEnd, const int yEnd, const int minCount = 0) const;
+
+private:
+    int width  = 0;         //!< plane width
+    //!<
+    int height = 0;         //!< plane height
+    //!<
+    std::vector<int> sum;   //!< summed-area table, (width + 1) * (height + 1) with zero first line and column
+    //!<
+};
+#endif
@@ -16,6 +16,10 @@
 
 #include <sys/time.h>
 
+#include "integralimage.h"
+#include "memorybudget.h"
+#include "trace.h"
+
 // based on this idee to find the logo in a recording:
 // 1. take 1000 iframes
 // 2. compare each corner of the iframes with all other iframes of the same corner
@@ -81,6 +85,7 @@ cExtractLogo::~cExtractLogo() {
             }
             delete[] actLogo->sobel;
             FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area.logoSize.height * area.logoSize.width, "actLogoInfo.sobel");
+            cMemoryBudget::Release(LogoInfoSize());
         }
         logoInfoVector[corner].clear();
     }
@@ -1118,17 +1123,13 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
 #endif
 
 // resize plane 0
+        // summed-area table of plane 0, has to be rebuild after each CutOut()
+        cIntegralImage integral;
+        if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;
         if (bestLogoCorner <= TOP_RIGHT) {  // top corners, calculate new height and cut from below
             int whiteLines = 0;
             for (int line = logoSizeFinal->height - 1; line > 0; line--) {
-                int blackPixel = 0;
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {
-                        blackPixel++;
-                        if (blackPixel > acceptFalsePixelH) break;
-                    }
-                }
-                if (blackPixel < acceptFalsePixelH) {  // accept false pixel
+                if (integral.CountLine(line, 0, logoSizeFinal->width - 1) < acceptFalsePixelH) {  // accept false pixel
                     whiteLines++;
                 }
                 else break;
@@ -1148,6 +1149,7 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     free(fileName);
                 }
 #endif
+                if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;
             }
 
 // search for text under logo
@@ -1159,16 +1161,8 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             int minWhiteLines = 2;
             if (decoder->GetVideoWidth() > 720) minWhiteLines = 4;
             // search for logo top line (first black pixel in line)
-            int logoTopLine = -1;
-            for (int line = 0; line < logoSizeFinal->height; line++) {
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {  // black pixel
-                        logoTopLine = line;
-                        break;
-                    }
-                }
-                if (logoTopLine >= 0) break;
-            }
+            int logoTopLine = integral.FirstLine(0, 0, logoSizeFinal->width - 1, logoSizeFinal->height - 1);
+            if (logoTopLine >= logoSizeFinal->height) logoTopLine = -1;
             if (logoTopLine <= 10) {
                 dsyslog("cExtractLogo::Resize(): no more white part above logo, logo is invalid");
                 return false;
@@ -1176,14 +1170,10 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             // search for logo buttom line (first line without black pixel)
             int logoButtomLine = -1;
             for (int line = logoTopLine; line < logoSizeFinal->height; line++) {
-                logoButtomLine = line - 1;
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) { // black pixel
-                        logoButtomLine = -1;
-                        break;
-                    }
+                if (integral.CountLine(line, 0, logoSizeFinal->width - 1) == 0) {  // no black pixel
+                    logoButtomLine = line - 1;
+                    break;
                 }
-                if (logoButtomLine >= 0) break;
             }
             if (logoButtomLine < 0) logoButtomLine = logoSizeFinal->width - 1;  // logo end at buttom
 #ifdef DEBUG_LOGO_RESIZE
@@ -1194,14 +1184,7 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             int topWhiteLine     = -1;
             int bottomWhiteLine  = -1;
             for (int line = logoSizeFinal->height - 1; line > logoButtomLine; line--) {  // check bottom half of the picture
-                int countBlackPixel = 0;
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {
-                        countBlackPixel++;
-                        if (countBlackPixel > MAX_FALSE_PIXEL) break;   // no white line
-                    }
-                }
-                if (countBlackPixel <= MAX_FALSE_PIXEL) {
+                if (integral.CountLine(line, 0, logoSizeFinal->width - 1) <= MAX_FALSE_PIXEL) {
                     if (bottomWhiteLine == -1) bottomWhiteLine = line;
                     topWhiteLine = line;
                 }
@@ -1221,21 +1204,10 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             if ((logoHeight >= 10) &&                                            // false pixel in top area found, not logo
                     (countWhite <= 22) && (textHeight < logoSizeFinal->height)) {    // too much white is not possible for text under logo, changed from 11 to 22
                 // get width of text
-                int leftColumn  = -1;
-                int rightColumn = -1;
                 int line = logoSizeFinal->height - (textHeight / 2) - 1;   // check in half of text
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {
-                        leftColumn = column;
-                        break;
-                    }
-                }
-                for (int column = logoSizeFinal->width - 1; column >= 0; column--) {
-                    if (bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {
-                        rightColumn = column;
-                        break;
-                    }
-                }
+                int leftColumn  = integral.FirstColumn(0, line, logoSizeFinal->width - 1, line);
+                if (leftColumn >= logoSizeFinal->width) leftColumn = -1;
+                int rightColumn = integral.LastColumn(0, line, logoSizeFinal->width - 1, line);
                 int textWidth       = rightColumn - leftColumn + 1;
                 int textWidthQuote  = 1000 * textWidth / decoder->GetVideoWidth();
                 int textHeightQuote = 1000 * textHeight / decoder->GetVideoHeight();
@@ -1281,14 +1253,7 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
         else { // bottom corners, calculate new height and cut from above
             int whiteLines = 0;
             for (int line = 0; line < logoSizeFinal->height; line++) {
-                int blackPixel = 0;
-                for (int column = 0; column < logoSizeFinal->width; column++) {
-                    if ( bestLogoInfo->sobel[0][line * (logoSizeFinal->width) + column] == 0) {
-                        blackPixel++;
-                        if (blackPixel > acceptFalsePixelH) break;
-                    }
-                }
-                if (blackPixel <= acceptFalsePixelH) {  // accept false pixel
+                if (integral.CountLine(line, 0, logoSizeFinal->width - 1) <= acceptFalsePixelH) {  // accept false pixel
                     whiteLines++;
                 }
                 else break;
@@ -1313,6 +1278,7 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     cutStep++;
                 }
 #endif
+                if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;
             }
 
 // search for text above logo
@@ -1325,16 +1291,9 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             int minWhiteLines;
             if (decoder->GetVideoWidth() == 720) minWhiteLines = 2;
             else minWhiteLines = 4;
-            for (int line = 0; line < logoSizeFinal->height; line++) {
-                int countBlackPixel = 0;
-                for (int column = logoSizeFinal->width - 1; column > 0; column--) {
-                    if (bestLogoInfo->sobel[0][line * logoSizeFinal->width + column] == 0) {
-                        countBlackPixel++;
-                        if (column < leftBlackPixel) leftBlackPixel = column;
-                        if (column > rightBlackPixel) rightBlackPixel = column;
-                    }
-                }
-                if (countBlackPixel <= 1) {  // accept 1 false pixel
+            int line;
+            for (line = 0; line < logoSizeFinal->height; line++) {
+                if (integral.CountLine(line, 1, logoSizeFinal->width - 1) <= 1) {  // accept 1 false pixel
                     countWhite++;
                 }
                 else {
@@ -1346,6 +1305,12 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     cutLine = line;
                 }
             }
+            // first and last column with black pixel of all checked lines
+            int lastLine = std::min(line, logoSizeFinal->height - 1);
+            int blackColumn = integral.FirstColumn(1, 0, logoSizeFinal->width - 1, lastLine);
+            if (blackColumn < logoSizeFinal->width) leftBlackPixel = blackColumn;
+            blackColumn = integral.LastColumn(1, 0, logoSizeFinal->width - 1, lastLine);
+            if (blackColumn >= 1) rightBlackPixel = blackColumn;
             int quoteAfterCut = 100 * (logoSizeFinal->height - cutLine) / logoSizeFinal->height; // we may not cut off too much, this could not be text under logo, this is something on top of the logo e.g. RTL2
             if ((topBlackLineOfLogo > cutLine) && (quoteAfterCut > 52)) {  // changed from 48 to 52
                 if ((cutLine >= LOGO_MIN_LETTERING_H) && (cutLine < LOGO_MAX_LETTERING_H)) {
@@ -1370,16 +1335,10 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
         }
 
         if ((bestLogoCorner == TOP_RIGHT) || (bestLogoCorner == BOTTOM_RIGHT)) {  // right corners, cut from left
+            if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;  // plane changed by cut of top or bottom corner
             int whiteColumns = 0;
             for (int column = 0; column < logoSizeFinal->width - 1; column++) {
-                int blackPixel = 0;
-                for (int line = 0; line < logoSizeFinal->height - 1; line++) {
-                    if (bestLogoInfo->sobel[0][line * logoSizeFinal->width + column] == 0) {
-                        blackPixel++;
-                        if (blackPixel > acceptFalsePixelV) break;
-                    }
-                }
-                if (blackPixel <= acceptFalsePixelV ) {  // accept false pixel
+                if (integral.CountColumn(column, 0, logoSizeFinal->height - 2) <= acceptFalsePixelV) {  // accept false pixel
                     whiteColumns++;
                 }
                 else break;
@@ -1400,28 +1359,16 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     cutStep++;
                 }
 #endif
+                if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;
             }
 
 // check text left of logo, search for at least 2 white columns to cut logos with text addon (e.g. "Neue Folge")
             int countWhite = 0;
             int cutColumn = 0;
             int lastBlackColumn = 0;
-            int topBlackPixel =  INT_MAX;
-            int topBlackPixelBefore = INT_MAX;
-            int bottomBlackPixelBefore = 0;
-            int bottomBlackPixel = 0;
-            for (int column = 0; column < logoSizeFinal->width; column++) {
-                bool isAllWhite = true;
-                topBlackPixel = topBlackPixelBefore;
-                bottomBlackPixel = bottomBlackPixelBefore;
-                for (int line = 0; line < logoSizeFinal->height; line++) {
-                    if (bestLogoInfo->sobel[0][line * logoSizeFinal->width + column] == 0) {
-                        isAllWhite = false;
-                        if (line < topBlackPixelBefore) topBlackPixelBefore = line;
-                        if (line > bottomBlackPixelBefore) bottomBlackPixelBefore = line;
-                    }
-                }
-                if (isAllWhite) {
+            int column;
+            for (column = 0; column < logoSizeFinal->width; column++) {
+                if (integral.CountColumn(column, 0, logoSizeFinal->height - 1) == 0) {
                     countWhite++;
                 }
                 else {
@@ -1433,6 +1380,11 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     cutColumn = column;
                 }
             }
+            // first and last line with black pixel of all columns before last checked column
+            int lastColumn       = std::min(column, logoSizeFinal->width - 1);
+            int topBlackPixel    = integral.FirstLine(0, 0, lastColumn - 1, logoSizeFinal->height - 1);
+            if (topBlackPixel >= logoSizeFinal->height) topBlackPixel = INT_MAX;
+            int bottomBlackPixel = std::max(integral.LastLine(0, 0, lastColumn - 1, logoSizeFinal->height - 1), 0);
             if (lastBlackColumn > cutColumn) {
                 if ((bottomBlackPixel - topBlackPixel) <= 13) {
                     dsyslog("cExtractLogo::Resize(): repeat %d, left logo: found text before logo, cut at column %d, pixel of text: top %d bottom %d, text height %d is valid", repeat, cutColumn, topBlackPixel, bottomBlackPixel, bottomBlackPixel - topBlackPixel);
@@ -1456,16 +1408,10 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
             }
         }
         else { // left corners, cut from right
+            if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;  // plane changed by cut of top or bottom corner
             int whiteColumns = 0;
             for (int column = logoSizeFinal->width - 1; column > 0; column--) {
-                int blackPixel = 0;
-                for (int line = 0; line < logoSizeFinal->height; line++) {
-                    if (bestLogoInfo->sobel[0][line * logoSizeFinal->width + column] == 0) {
-                        blackPixel++;
-                        if (blackPixel > acceptFalsePixelV) break;
-                    }
-                }
-                if (blackPixel <= acceptFalsePixelV ) {  // accept false pixel
+                if (integral.CountColumn(column, 0, logoSizeFinal->height - 1) <= acceptFalsePixelV) {  // accept false pixel
                     whiteColumns++;
                 }
                 else break;
@@ -1486,28 +1432,16 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                     cutStep++;
                 }
 #endif
+                if (!integral.Init(bestLogoInfo->sobel[0], logoSizeFinal->width, logoSizeFinal->height)) return false;
             }
             // search text right of logo (e.g. "Neue Folge", "Live")
             if (!CheckLogoSize(logoSizeFinal, bestLogoCorner)) {
                 dsyslog("cExtractLogo::Resize(): repeat %d, left logo: search for text right of logo", repeat);
                 int countWhite = 0;
                 int cutColumn = 0;
-                int topBlackPixel =  INT_MAX;
-                int topBlackPixelBefore = INT_MAX;
-                int bottomBlackPixelBefore = 0;
-                int bottomBlackPixel = 0;
-                for (int column = logoSizeFinal->width - 1; column > 0; column--) {
-                    bool isAllWhite = true;
-                    topBlackPixel = topBlackPixelBefore;
-                    bottomBlackPixel = bottomBlackPixelBefore;
-                    for (int line = 0; line < logoSizeFinal->height; line++) {
-                        if (bestLogoInfo->sobel[0][line * logoSizeFinal->width + column] == 0) {
-                            isAllWhite = false;
-                            if (line < topBlackPixelBefore) topBlackPixelBefore = line;
-                            if (line > bottomBlackPixelBefore) bottomBlackPixelBefore = line;
-                        }
-                    }
-                    if (isAllWhite) {
+                int column;
+                for (column = logoSizeFinal->width - 1; column > 0; column--) {
+                    if (integral.CountColumn(column, 0, logoSizeFinal->height - 1) == 0) {
                         countWhite++;
                     }
                     else {
@@ -1518,6 +1452,11 @@ bool cExtractLogo::Resize(sLogoInfo *bestLogoInfo, sLogoSize *logoSizeFinal, con
                         cutColumn = column;  // cutColumn is last left white column searched from right
                     }
                 }
+                // first and last line with black pixel of all columns after last checked column
+                int firstColumn      = std::max(column, 1) + 1;
+                int topBlackPixel    = integral.FirstLine(firstColumn, 0, logoSizeFinal->width - 1, logoSizeFinal->height - 1);
+                if (topBlackPixel >= logoSizeFinal->height) topBlackPixel = INT_MAX;
+                int bottomBlackPixel = std::max(integral.LastLine(firstColumn, 0, logoSizeFinal->width - 1, logoSizeFinal->height - 1), 0);
                 // check position and width of logo and text
                 int logoStart   = 0;
                 int logoEnd     = cutColumn - 1;
@@ -1692,6 +1631,7 @@ int cExtractLogo::Compare(sLogoInfo *actLogoInfo, const int logoHeight, const in
     if (logoWidth <= 0)    return 0;
     if (corner < 0)        return 0;
     if (corner >= CORNERS) return 0;
+    cTraceSpan trace("ExtractLogoCompare", "logo");
 
     int hits = 0;
 
@@ -1842,6 +1782,7 @@ int cExtractLogo::DeleteFrames(const int from, const int to) {
                 }
                 delete[] actLogo->sobel;
                 FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area.logoSize.width * area.logoSize.height, "actLogoInfo.sobel");
+                cMemoryBudget::Release(LogoInfoSize());
 
                 // delete vector element
                 FREE(sizeof(*actLogo), "logoInfoVector");
@@ -2204,6 +2145,7 @@ int cExtractLogo::SearchLogo(int startPacket, const bool force) {
         }
     }
 
+    bool budgetReached = false;
     while (decoder->DecodeNextFrame(false)) {  // no audio decode
         if (abortNow) return LOGO_SEARCH_ERROR;
 
@@ -2317,11 +2259,16 @@ int cExtractLogo::SearchLogo(int startPacket, const bool force) {
             actLogoInfo.sobel = new uchar*[PLANES];
             for (int plane = 0; plane < PLANES; plane++) {
                 actLogoInfo.sobel[plane] = new uchar[logoPixel];
-                memcpy(actLogoInfo.sobel[plane], area.sobel[plane], sizeof(uchar) * logoPixel);
+                memcpy(actLogoInfo.sobel[plane], area.sobel[plane], sizeof(uchar) * cSobel::GetPlanePixel(area.logoSize, plane));
             }
             ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * logoPixel, "actLogoInfo.sobel");
 
-            if (CheckValid(&actLogoInfo, corner)) {
+            // keep candidate only in memory budget, free it like a not valid candidate otherwise
+            if (!budgetReached && !cMemoryBudget::Reserve(LogoInfoSize(), "logo search")) {
+                dsyslog("cExtractLogo::SearchLogo(): frame (%d): memory budget reached with %d valid frames, stop reading frames", packetNumber, frameCountValid);
+                budgetReached = true;
+            }
+            if (!budgetReached && CheckValid(&actLogoInfo, corner)) {
                 RemovePixelDefects(&actLogoInfo, corner);
                 actLogoInfo.hits = Compare(&actLogoInfo, area.logoSize.height, area.logoSize.width, corner);
 
@@ -2330,11 +2277,13 @@ int cExtractLogo::SearchLogo(int startPacket, const bool force) {
                 }
                 catch(std::bad_alloc &e) {
                     dsyslog("cExtractLogo::SearchLogo(): out of memory in pushback vector at frame %d", packetNumber);
+                    cMemoryBudget::Release(LogoInfoSize());
                     break;
                 }
                 ALLOC((sizeof(sLogoInfo)), "logoInfoVector");
             }
-            else {  // corner sobel transformed picture not valid
+            else {  // corner sobel transformed picture not valid or out of memory budget
+                if (!budgetReached) cMemoryBudget::Release(LogoInfoSize());
                 // free memory of sobel planes
                 for (int plane = 0; plane < PLANES; plane++) {
                     delete[] actLogoInfo.sobel[plane];
@@ -2355,7 +2304,7 @@ int cExtractLogo::SearchLogo(int startPacket, const bool force) {
                 frameCountValid -= DeleteFrames(firstBorder, packetNumber);
             }
         }
-        if ((frameCountValid >= MIN_VALID_FRAMES) || (packetsRead >= MAX_READ_PACKETS)) {
+        if ((frameCountValid >= MIN_VALID_FRAMES) || (packetsRead >= MAX_READ_PACKETS) || budgetReached) {
             break; // finish read frames and find best match
         }
         // skip some packets to prevent to get logo from ad scene or wrong coloured logo from background
@@ -2377,6 +2326,10 @@ int cExtractLogo::SearchLogo(int startPacket, const bool force) {
         dsyslog("cExtractLogo::SearchLogo(): %d valid frames of %d packets read, got enough frames at packet (%d), start analyze", frameCountValid, packetsRead, decoder->GetPacketNumber());
         doSearch = true;
     }
+    else if (budgetReached && (frameCountValid > 390)) {
+        dsyslog("cExtractLogo::SearchLogo(): memory budget reached after (%d) packets with (%d) valid packets, try anyway", packetsRead, frameCountValid);
+        doSearch = true;
+    }
     else if ((packetsRead < MAX_READ_PACKETS) && ((packetsRead > MAX_READ_PACKETS / 2) || (frameCountValid > 390))) {
         // reached end of recording (or part without border) before we got 1000 valid frames out of MAXREADFRAMES decoded
         // but we got at least 390 valid frames out of MAXREADFRAMES / 2 decoded, we can work with that
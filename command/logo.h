@@ -227,6 +227,14 @@ private:
      */
     int DeleteFrames(const int from, const int to);
 
+    /**
+     * memory of one stored logo candidate, reserved in memory budget
+     * @return bytes of logo info and its sobel planes
+     */
+    int64_t LogoInfoSize() const {
+        return sizeof(sLogoInfo) + (static_cast<int64_t>(PLANES) * area.logoSize.width * area.logoSize.height);
+    }
+
     /**
      * wait for more frames if markad runs during recording
      * @param decoder   pointer to decoder
@@ -29,6 +29,9 @@
 #include <limits.h>
 #include <errno.h>
 #include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <algorithm>
 #else
 #include "win32/mingw64.h"
 #endif
@@ -37,6 +40,9 @@
 #include "debug.h"
 #include "audio.h"
 #include "test.h"
+#include "generator.h"
+#include "memorybudget.h"
+#include "trace.h"
 
 
 bool SYSLOG                    = false;
@@ -1609,6 +1615,8 @@ cMark *cMarkAdStandalone::Check_ASPECTSTOP() {
 void cMarkAdStandalone::CheckStop() {
     LogSeparator(true);
     dsyslog("cMarkAdStandalone::CheckStop(): start check stop (%d)", decoder->GetPacketNumber());
+    // main pass ends here, marks of final selection and post processing are not from restarted detectors
+    resumePacket = -1;
 
     char *indexToHMSF = marks.IndexToHMSF(stopA, AV_NOPTS_VALUE, false);
     if (indexToHMSF) {
@@ -1840,8 +1848,10 @@ void cMarkAdStandalone::CheckStop() {
     else esyslog("could not find a end mark");
 
     // cleanup detection failures (e.g. very long dark scenes), keep start end end mark, they can be from different type
-    if (criteria->GetMarkTypeState(MT_HBORDERCHANGE) == CRITERIA_UNAVAILABLE) marks.DelFromTo(marks.First()->position + 1, end->position - 1, MT_HBORDERCHANGE, 0xF0);
-    if (criteria->GetMarkTypeState(MT_VBORDERCHANGE) == CRITERIA_UNAVAILABLE) marks.DelFromTo(marks.First()->position + 1, end->position - 1, MT_VBORDERCHANGE, 0xF0);
+    if (end && marks.First()) {
+        if (criteria->GetMarkTypeState(MT_HBORDERCHANGE) == CRITERIA_UNAVAILABLE) marks.DelFromTo(marks.First()->position + 1, end->position - 1, MT_HBORDERCHANGE, 0xF0);
+        if (criteria->GetMarkTypeState(MT_VBORDERCHANGE) == CRITERIA_UNAVAILABLE) marks.DelFromTo(marks.First()->position + 1, end->position - 1, MT_VBORDERCHANGE, 0xF0);
+    }
 
     DebugMarks();     //  only for debugging
     dsyslog("cMarkAdStandalone::CheckStop(): end check stop");
@@ -1884,6 +1894,7 @@ bool cMarkAdStandalone::MoveLastStopAfterClosingCredits(cMark *stopMark) {
         if (!detectLogoStopStart) {  // init in RemoveLogoChangeMarks(), but maybe not used
             detectLogoStopStart = new cDetectLogoStopStart(decoder, index, criteria, evaluateLogoStopStartPair, video->GetLogoCorner());
             ALLOC(sizeof(*detectLogoStopStart), "detectLogoStopStart");
+            detectLogoStopStart->SetCompareStream(compareStream);
         }
         // check current read position of decoder
         if (stopMark->position < decoder->GetPacketNumber()) decoder->Restart();
@@ -1957,6 +1968,7 @@ void cMarkAdStandalone::RemoveLogoChangeMarks(const bool checkStart) {
     if (!detectLogoStopStart) {
         detectLogoStopStart = new cDetectLogoStopStart(decoder_local, index, criteria, evaluateLogoStopStartPair, video->GetLogoCorner());
         ALLOC(sizeof(*detectLogoStopStart), "detectLogoStopStart");
+        detectLogoStopStart->SetCompareStream(compareStream);
     }
 
     if (!evaluateLogoStopStartPair) {
@@ -4256,6 +4268,29 @@ void cMarkAdStandalone::AddMarkVPS(const int offset, const int type) {
 }
 
 
+void cMarkAdStandalone::AddDetectorMark(sMarkAdMark *mark) {
+    if (!mark) return;
+    // after resume from checkpoint, detectors start again and report the current state of the broadcast
+    // drop marks before resume position and the first mark of each type if it repeats the state restored from checkpoint
+    if (resumePacket >= 0) {
+        if (mark->position < resumePacket) {
+            dsyslog("cMarkAdStandalone::AddDetectorMark(): mark (%d) type 0x%X before resume position (%d), ignore", mark->position, mark->type, resumePacket);
+            return;
+        }
+        int typeBit = 1 << ((mark->type & 0xF0) >> 4);
+        if (!(resumeMarkTypes & typeBit)) {
+            resumeMarkTypes |= typeBit;
+            const cMark *lastMark = marks.GetPrev(INT_MAX, mark->type & 0xF0, 0xF0);
+            if (lastMark && (lastMark->type == mark->type)) {
+                dsyslog("cMarkAdStandalone::AddDetectorMark(): mark (%d) type 0x%X repeats state from checkpoint mark (%d), ignore", mark->position, mark->type, lastMark->position);
+                return;
+            }
+        }
+    }
+    AddMark(mark);
+}
+
+
 void cMarkAdStandalone::AddMark(sMarkAdMark *mark) {
     if (!mark) return;
     if (mark->type <= MT_UNDEFINED) {
@@ -4630,29 +4665,28 @@ void cMarkAdStandalone::CheckIndexGrowing()
                     return;
                 }
             }
-            unsigned int sleeptime = WAITTIME;
-            time_t sleepstart = time(nullptr);
-            double slepttime = 0;
-            while ((unsigned int)slepttime < sleeptime) {
-                while (sleeptime > 0) {
-                    if (!macontext.Info.isRunningRecording) {
-                        dsyslog("cMarkAdStandalone::CheckIndexGrowing(): running recording detected");
-                        macontext.Info.isRunningRecording = true;
-                    }
-                    unsigned int ret = sleep(sleeptime); // now we sleep and hopefully the index will grow
-                    if ((errno) && (ret)) {
-                        if (abortNow) return;
-                        esyslog("got errno %i while waiting for new data", errno);
-                        if (errno != EINTR) return;
-                    }
-                    sleeptime = ret;
-                }
-                slepttime = difftime(time(nullptr), sleepstart);
-                if (slepttime < WAITTIME) {
-                    esyslog("what's wrong with your system? we just slept %.0fs", slepttime);
-                }
+            if (!macontext.Info.isRunningRecording) {
+                dsyslog("cMarkAdStandalone::CheckIndexGrowing(): running recording detected");
+                macontext.Info.isRunningRecording = true;
             }
+            // wait until index has grown or WAITTIME is over
+            // inotify also wakes us on any other change in recording directory (e.g. our own marks, log or checkpoint file),
+            // count this wait only as progress if index file size has really grown
+            time_t sleepstart = time(nullptr);
+            bool grown = false;
+            while (!grown) {
+                int remaining = WAITTIME - static_cast<int> (difftime(time(nullptr), sleepstart));
+                if (remaining <= 0) break;
+                bool changed = WaitForRecordingChange(remaining);  // now we wait and hopefully the index will grow
+                if (abortNow) return;
+                if (!changed) break;  // timeout
+                struct stat statbufNew;
+                if (stat(indexFile, &statbufNew) == -1) return;
+                grown = (statbufNew.st_size > statbuf.st_size);
+            }
+            double slepttime = difftime(time(nullptr), sleepstart);
             waittime += static_cast<int> (slepttime);
+            if (grown) continue;  // index has grown, check again if we have enough new frames
             sleepcnt++;
             if (sleepcnt >= 2) {
                 esyslog("no new data after %is, skipping wait!", waittime);
@@ -4673,6 +4707,195 @@ void cMarkAdStandalone::CheckIndexGrowing()
 }
 
 
+bool cMarkAdStandalone::WaitForRecordingChange(const unsigned int timeout) {
+#ifdef POSIX
+    // use inotify on recording directory, we wake up as soon as VDR writes new data to index or ts file
+    if (!inotifyFailed && (inotifyFd < 0)) {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if ((inotifyFd >= 0) && (inotify_add_watch(inotifyFd, macontext.Config->recDir, IN_MODIFY | IN_CREATE | IN_MOVED_TO) < 0)) {
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+        if (inotifyFd < 0) {
+            esyslog("cMarkAdStandalone::WaitForRecordingChange(): inotify on recording directory failed, fallback to polling: %s", strerror(errno));
+            inotifyFailed = true;
+        }
+        else dsyslog("cMarkAdStandalone::WaitForRecordingChange(): wait with inotify for changes of recording directory");
+    }
+    if (inotifyFd >= 0) {
+        struct pollfd pollFd = {};
+        pollFd.fd     = inotifyFd;
+        pollFd.events = POLLIN;
+        int ret = poll(&pollFd, 1, timeout * 1000);
+        if (ret < 0) {
+            if (abortNow) return false;
+            esyslog("got errno %i while waiting for new data", errno);
+            return false;
+        }
+        if (ret == 0) return false;  // timeout, no change of recording
+        // drain event queue, we only need the information that something has changed
+        char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        while (read(inotifyFd, buffer, sizeof(buffer)) > 0) {};
+        return true;
+    }
+#endif
+    // fallback to polling, sleep full timeout
+    unsigned int sleeptime = timeout;
+    while (sleeptime > 0) {
+        unsigned int ret = sleep(sleeptime);
+        if ((errno) && (ret)) {
+            if (abortNow) return false;
+            esyslog("got errno %i while waiting for new data", errno);
+            if (errno != EINTR) return false;
+        }
+        sleeptime = ret;
+    }
+    return false;
+}
+
+
+#define CHECKPOINT_VERSION  1     // version of checkpoint file format
+#define CHECKPOINT_INTERVAL 300   // write checkpoint every 5 min of the recording
+
+
+void cMarkAdStandalone::SaveCheckpoint() {
+    if (!decoder) return;
+    int packetNumber = decoder->GetPacketNumber();
+    checkpointPacket = packetNumber + CHECKPOINT_INTERVAL * decoder->GetVideoFrameRate();
+    // only write checkpoint between CheckStart() and CheckStop(), before CheckStart() it is cheaper to start from the beginning
+    if (!doneCheckStart || doneCheckStop) return;
+
+    char *fileName    = nullptr;
+    char *fileNameTmp = nullptr;
+    if (asprintf(&fileName, "%s/markad.checkpoint", directory) == -1) return;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    if (asprintf(&fileNameTmp, "%s.tmp", fileName) == -1) {
+        FREE(strlen(fileName) + 1, "fileName");
+        free(fileName);
+        return;
+    }
+    ALLOC(strlen(fileNameTmp) + 1, "fileNameTmp");
+
+    FILE *file = fopen(fileNameTmp, "w");
+    if (file) {
+        fprintf(file, "markad checkpoint %d\n", CHECKPOINT_VERSION);
+        fprintf(file, "config %d\n", macontext.Config->fullDecode);
+        fprintf(file, "packet %d %" PRId64 "\n", packetNumber, decoder->GetPacketPTS());
+        fprintf(file, "state %d %d %d %d %d %d %d %d %d %d %d\n", startA, stopA, packetCheckStart, packetCheckStop, packetEndPart, doneCheckStart, iStopinBroadCast, inBroadCast, restartLogoDetectionDone, macontext.Info.AspectRatio.num, macontext.Info.AspectRatio.den);
+        criteria->WriteState(file);
+        marks.WriteState(file, "marks");
+        sceneMarks.WriteState(file, "scene");
+        silenceMarks.WriteState(file, "silence");
+        blackMarks.WriteState(file, "black");
+        bool ok = (fflush(file) == 0);
+        ok = (fsync(fileno(file)) == 0) && ok;
+        fclose(file);
+        // replace checkpoint atomic, we can be killed at any time
+        if (ok && (rename(fileNameTmp, fileName) == 0)) dsyslog("cMarkAdStandalone::SaveCheckpoint(): packet (%d): checkpoint written", packetNumber);
+        else {
+            esyslog("cMarkAdStandalone::SaveCheckpoint(): write checkpoint file %s failed", fileName);
+            unlink(fileNameTmp);
+        }
+    }
+    else esyslog("cMarkAdStandalone::SaveCheckpoint(): can not create checkpoint file %s", fileNameTmp);
+
+    FREE(strlen(fileNameTmp) + 1, "fileNameTmp");
+    free(fileNameTmp);
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+}
+
+
+bool cMarkAdStandalone::LoadCheckpoint() {
+    if (!decoder) return false;
+    char *fileName = nullptr;
+    if (asprintf(&fileName, "%s/markad.checkpoint", directory) == -1) return false;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    FILE *file = fopen(fileName, "r");
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+    if (!file) return false;
+
+    // first pass: check file version and seek to checkpoint position
+    char *line        = nullptr;
+    size_t length     = 0;
+    int version       = -1;
+    int fullDecode    = -1;
+    int packetNumber  = -1;
+    int64_t packetPTS = -1;
+    while (getline(&line, &length, file) != -1) {
+        if (sscanf(line, "markad checkpoint %d", &version) == 1) continue;
+        if (sscanf(line, "config %d", &fullDecode) == 1) continue;
+        if (sscanf(line, "packet %d %" SCNd64, &packetNumber, &packetPTS) == 2) break;
+    }
+    if ((version != CHECKPOINT_VERSION) || (fullDecode != macontext.Config->fullDecode) || (packetNumber < 0)) {
+        isyslog("checkpoint file is not valid for this run, ignore it");
+        free(line);
+        fclose(file);
+        return false;
+    }
+    isyslog("resume mark detection from checkpoint at packet (%d)", packetNumber);
+    // seek without decoding, this rebuilds the index up to checkpoint position
+    if (!decoder->SeekToPacket(packetNumber) || (decoder->GetPacketNumber() != packetNumber) || (decoder->GetPacketPTS() != packetPTS)) {
+        esyslog("checkpoint packet (%d) PTS %" PRId64 " does not match recording, PTS %" PRId64 ", restart mark detection from the beginning", packetNumber, packetPTS, decoder->GetPacketPTS());
+        free(line);
+        fclose(file);
+        decoder->Restart();
+        return false;
+    }
+
+    // second pass: restore state
+    rewind(file);
+    while (getline(&line, &length, file) != -1) {
+        char *newLine = strchr(line, '\n');
+        if (newLine) *newLine = 0;
+        if (strncmp(line, "state ", 6) == 0) {
+            int state[11] = {0};
+            if (sscanf(line, "state %d %d %d %d %d %d %d %d %d %d %d", &state[0], &state[1], &state[2], &state[3], &state[4], &state[5], &state[6], &state[7], &state[8], &state[9], &state[10]) == 11) {
+                startA                         = state[0];
+                stopA                          = state[1];
+                packetCheckStart               = state[2];
+                packetCheckStop                = state[3];
+                packetEndPart                  = state[4];
+                doneCheckStart                 = state[5];
+                iStopinBroadCast               = state[6];
+                inBroadCast                    = state[7];
+                restartLogoDetectionDone       = state[8];
+                macontext.Info.AspectRatio.num = state[9];
+                macontext.Info.AspectRatio.den = state[10];
+                video->SetAspectRatioBroadcast(macontext.Info.AspectRatio);
+            }
+            else esyslog("cMarkAdStandalone::LoadCheckpoint(): invalid line <%s>", line);
+        }
+        else if (strncmp(line, "criteria ", 9) == 0) criteria->ReadState(line);
+        else if (strncmp(line, "mark marks ",   11) == 0) marks.ReadState(line + 11);
+        else if (strncmp(line, "mark scene ",   11) == 0) sceneMarks.ReadState(line + 11);
+        else if (strncmp(line, "mark silence ", 13) == 0) silenceMarks.ReadState(line + 13);
+        else if (strncmp(line, "mark black ",   11) == 0) blackMarks.ReadState(line + 11);
+    }
+    free(line);
+    fclose(file);
+
+    resumePacket    = packetNumber;
+    resumeMarkTypes = 0;
+    dsyslog("cMarkAdStandalone::LoadCheckpoint(): packet (%d): resumed, restored marks:", packetNumber);
+    DebugMarks();
+    criteria->ListMarkTypeState();
+    criteria->ListDetection();
+    return true;
+}
+
+
+void cMarkAdStandalone::DeleteCheckpoint() {
+    char *fileName = nullptr;
+    if (asprintf(&fileName, "%s/markad.checkpoint", directory) == -1) return;
+    ALLOC(strlen(fileName) + 1, "fileName");
+    if ((unlink(fileName) == 0)) dsyslog("cMarkAdStandalone::DeleteCheckpoint(): checkpoint file deleted");
+    FREE(strlen(fileName) + 1, "fileName");
+    free(fileName);
+}
+
+
 #ifdef DEBUG_MARK_FRAMES
 void cMarkAdStandalone::DebugMarkFrames() {
     if (!decoder) return;
@@ -4785,6 +5008,14 @@ void cMarkAdStandalone::MarkadCut() {
     cEncoder *encoder = new cEncoder(decoder, index, macontext.Config->recDir, cutMode, macontext.Config->bestEncode, macontext.Config->ac3ReEncode);
     ALLOC(sizeof(*encoder), "encoder");
 
+    // encoder needs full quality pictures
+    decoder->SetFastDecode(false);
+
+#ifndef DEBUG_CUT
+    // key packet cut only copies packets, we need no decoder codec, demux only and seek with byte position from index
+    if (cutMode == CUT_MODE_KEY) decoder->SetDemuxOnly(true);
+#endif
+
     int passMin = 0;
     int passMax = 0;
     if (macontext.Config->fullEncode) {  // to full endcode we need 2 pass full encoding
@@ -4850,6 +5081,7 @@ void cMarkAdStandalone::MarkadCut() {
     FREE(sizeof(*encoder), "encoder");
     delete encoder;  // encoder must be valid here because it is used above
     encoder = nullptr;
+    decoder->SetDemuxOnly(false);
     elapsedTime.cut = EndSection("cut");
 }
 
@@ -4881,6 +5113,7 @@ void cMarkAdStandalone::LogoMarkOptimization() {
     if (!detectLogoStopStart) {        // init in RemoveLogoChangeMarks(), but maybe not used
         detectLogoStopStart = new cDetectLogoStopStart(decoder, index, criteria, evaluateLogoStopStartPair, video->GetLogoCorner());
         ALLOC(sizeof(*detectLogoStopStart), "detectLogoStopStart");
+        detectLogoStopStart->SetCompareStream(compareStream);
     }
 
     decoder->Restart();
@@ -4890,6 +5123,12 @@ void cMarkAdStandalone::LogoMarkOptimization() {
     dsyslog("cMarkAdStandalone::LogoMarkOptimization(): check for advertising in frame with logo after logo start and before logo stop mark and check for introduction logo");
     cMark *markLogo = marks.GetFirst();
     while (markLogo) {
+        // mark at a known separator of this channel was already verified by a former recording, no need to search again
+        if (fingerprintIndex && ((markLogo->type == MT_LOGOSTART) || (markLogo->type == MT_LOGOSTOP)) && fingerprintIndex->IsKnownSeparator(markLogo->position, markLogo->type)) {
+            dsyslog("cMarkAdStandalone::LogoMarkOptimization(): mark (%d) at known separator, skip optimization", markLogo->position);
+            markLogo = markLogo->Next();
+            continue;
+        }
         if (markLogo->type == MT_LOGOSTART) {
             const char *indexToHMSFStartMark = marks.GetTime(markLogo);
             sMarkPos introductionStart = {-1};
@@ -6187,6 +6426,13 @@ void cMarkAdStandalone::SceneChangeOptimization() {
 }
 
 
+void cMarkAdStandalone::LearnFingerprint() {
+    if (abortNow)          return;
+    if (!fingerprintIndex) return;
+    fingerprintIndex->Learn(&marks);
+}
+
+
 void cMarkAdStandalone::ProcessOverlap() {
     if (abortNow)      return;
     if (duplicate)     return;
@@ -6268,18 +6514,28 @@ bool cMarkAdStandalone::ProcessFrame() {
                 sMarkAdMarks *vmarks = video->Process();
                 if (vmarks) {
                     for (int i = 0; i < vmarks->Count; i++) {
-                        AddMark(&vmarks->Number[i]);
+                        AddDetectorMark(&vmarks->Number[i]);
                     }
                 }
             }
             else decoder->DropFrame();
         }
 
+        // signature of each second for fingerprint index
+        if (fingerprintIndex && (!macontext.Config->forcedFullDecode || decoder->IsVideoIFrame())) fingerprintIndex->Process();
+
+        // compare results of all corners for special logo detection, post processing needs no additional decoding of this range
+        if (compareStream) compareStream->ProcessStream(decoder->GetVideoPicture());
+
         // check start
-        if (!doneCheckStart && inBroadCast && (packetNumber > packetCheckStart)) CheckStart();
+        if (!doneCheckStart && inBroadCast && (packetNumber > packetCheckStart)) {
+            ProcessAudioLevels();
+            CheckStart();
+        }
 
         // check stop
         if (!doneCheckStop && (packetNumber > packetCheckStop)) {
+            ProcessAudioLevels();
             if (!doneCheckStart) {
                 dsyslog("cMarkAdStandalone::ProcessFrame(): assumed end reached but still no CheckStart() called, do it now");
                 CheckStart();
@@ -6290,13 +6546,11 @@ bool cMarkAdStandalone::ProcessFrame() {
     }
 
     // detect audio channel based marks
-    if ((!macontext.Config->fullDecode ||                     // if we decode only i-frames, we will have no audio frames
-            decoder->IsAudioPacket() ||
-            !criteria->GetDetectionState(MT_SOUNDCHANGE)) &&  // without silence detection, we do not decode audio and will get no audio frames
-            criteria->GetDetectionState(MT_AUDIO)) {
+    // audio is decoded in audio decode thread, we get no audio frames here, check for new audio levels on each frame
+    if (criteria->GetDetectionState(MT_AUDIO)) {
         sMarkAdMarks *amarks = audio->Detect();               // detect channel change and silence
         if (amarks) {
-            for (int i = 0; i < amarks->Count; i++) AddMark(&amarks->Number[i]);
+            for (int i = 0; i < amarks->Count; i++) AddDetectorMark(&amarks->Number[i]);
         }
     }
 
@@ -6316,6 +6570,166 @@ bool cMarkAdStandalone::ProcessFrame() {
 }
 
 
+void cMarkAdStandalone::ProcessAudioLevels() {
+    decoder->WaitForAudioLevels();
+    if (criteria->GetDetectionState(MT_AUDIO)) {
+        sMarkAdMarks *amarks = audio->Detect();
+        if (amarks) {
+            for (int i = 0; i < amarks->Count; i++) AddDetectorMark(&amarks->Number[i]);
+        }
+    }
+}
+
+
+void cMarkAdStandalone::StartSegments() {
+    segmentsStarted = true;   // check only once after CheckStart()
+    if (abortNow) return;
+    if (macontext.Config->before || macontext.Info.isRunningRecording || (length == 0) || (startTime == 0) || (time(nullptr) < (startTime + length))) {
+        dsyslog("cMarkAdStandalone::StartSegments(): recording is not finished, detect serial");
+        return;
+    }
+    if (macontext.Config->hwaccel[0] != 0) {
+        dsyslog("cMarkAdStandalone::StartSegments(): hardware decoder sessions are limited, detect serial");
+        return;
+    }
+    int frameRate = decoder->GetVideoFrameRate();
+    if (frameRate <= 0) return;
+
+    // segments from current packet to start of end part, end part is always detected serial with restarted detection
+    int startPacket = decoder->GetPacketNumber();
+    int endPacket   = packetEndPart;
+    int count       = std::min(macontext.Config->segments, SEGMENT_MAX);
+    long int cpus   = sysconf(_SC_NPROCESSORS_ONLN);
+    int decoderThreads = std::max(decoder->GetThreads(), 1);
+    count = std::min(count, static_cast<int>(cpus / decoderThreads));
+    count = std::min(count, (endPacket - startPacket) / (SEGMENT_MIN_LENGTH * frameRate));
+    if (count < 2) {
+        dsyslog("cMarkAdStandalone::StartSegments(): packet (%d) to (%d): range too short or not enough CPUs (%ld) for segmented detection, detect serial", startPacket, endPacket, cpus);
+        return;
+    }
+    segments = new cSegments(decoder, macontext.Info.ChannelName, macontext.Config->autoLogo, macontext.Config->logoCacheDirectory, macontext.Info.AspectRatio, macontext.Config->fastDecode, macontext.Config->forcedFullDecode, macontext.Config->forceInterlaced);
+    ALLOC(sizeof(*segments), "segments");
+    sDetectorState state;
+    video->GetState(&state);
+    if (segments->Start(startPacket, endPacket, count, criteria, state.reducedPlanes) == 0) {
+        FREE(sizeof(*segments), "segments");
+        delete segments;
+        segments = nullptr;
+    }
+}
+
+
+bool cMarkAdStandalone::ProcessSegmentStart() {
+    int packetNumber = decoder->GetPacketNumber();
+
+    // get all audio levels up to this packet, worker did the same at segment border
+    ProcessAudioLevels();
+    sDetectorState state;
+    video->GetState(&state);
+    audio->GetState(&state);
+
+    // get all following valid segments, detector state at end of a segment is start of next segment
+    std::vector<const sSegmentJob *> chain;
+    const sDetectorState *chainState = &state;
+    while (segments->GetNextSegmentStart() < INT_MAX) {
+        const sSegmentJob *job = segments->GetNextSegment(chainState, criteria);
+        if (!job) break;   // main thread has to detect this segment
+        chain.push_back(job);
+        chainState = &job->endState;
+    }
+    if (chain.empty()) {
+        dsyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): segment not valid, continue serial detection", packetNumber);
+        return true;
+    }
+    int nextPacket = chain.back()->endPacket;
+
+    // warm up new detectors before next packet to detect, same as worker at segment start
+    // detectors of main thread keep state of current packet in case we have to detect the segments serial
+    cVideo *videoWarmup = new cVideo(decoder, index, criteria, macontext.Config->recDir, macontext.Config->autoLogo, macontext.Config->logoCacheDirectory);
+    ALLOC(sizeof(*videoWarmup), "video");
+    videoWarmup->SetAspectRatioBroadcast(macontext.Info.AspectRatio);
+    if (state.reducedPlanes) videoWarmup->ReducePlanes();   // same logo planes as detectors of main thread
+    cAudio *audioWarmup = new cAudio(decoder, index, criteria);
+    ALLOC(sizeof(*audioWarmup), "audio");
+
+    int warmupPacket = nextPacket - (SEGMENT_WARMUP * decoder->GetVideoFrameRate());
+    dsyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): continue detection at packet (%d), warmup from packet (%d)", packetNumber, nextPacket, warmupPacket);
+    bool valid = false;
+    if ((warmupPacket <= packetNumber) || decoder->SeekToPacket(warmupPacket)) {
+        while (decoder->DecodeNextFrame(criteria->GetDetectionState(MT_SOUNDCHANGE))) {
+            if (abortNow) break;
+            if (decoder->IsVideoFrame()) {
+                if (decoder->GetPacketNumber() >= nextPacket) {
+                    valid = true;
+                    break;
+                }
+                if (criteria->GetDetectionState(MT_VIDEO)) {
+                    if (!macontext.Config->forcedFullDecode || decoder->IsVideoIFrame()) videoWarmup->Process();   // marks of warmup are from valid segment
+                    else decoder->DropFrame();
+                }
+            }
+            if (criteria->GetDetectionState(MT_AUDIO)) audioWarmup->Detect();
+        }
+    }
+    else esyslog("cMarkAdStandalone::ProcessSegmentStart(): seek to packet (%d) failed", warmupPacket);
+    if (valid) {
+        decoder->WaitForAudioLevels();
+        if (criteria->GetDetectionState(MT_AUDIO)) audioWarmup->Detect();
+        sDetectorState warmupState;
+        videoWarmup->GetState(&warmupState);
+        audioWarmup->GetState(&warmupState);
+        if (!(warmupState == *chainState)) {
+            dsyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): detector state after warmup differs from end of last valid segment, detect segments serial", decoder->GetPacketNumber());
+            valid = false;
+        }
+    }
+
+    // take marks of valid segments, warmed up detectors continue detection
+    if (valid) {
+        for (const sSegmentJob *job : chain) {
+            dsyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): take %zu marks from segment (%d) to (%d)", packetNumber, job->marks.size(), job->startPacket, job->endPacket);
+            for (sMarkAdMark mark : job->marks) AddDetectorMark(&mark);
+        }
+        if (compareStream) compareStream->BreakStream();   // frames of valid segments are not compared
+        FREE(sizeof(*video), "video");
+        delete video;
+        video = videoWarmup;
+        FREE(sizeof(*audio), "audio");
+        delete audio;
+        audio = audioWarmup;
+        return true;
+    }
+    FREE(sizeof(*videoWarmup), "video");
+    delete videoWarmup;
+    FREE(sizeof(*audioWarmup), "audio");
+    delete audioWarmup;
+    if (abortNow) return false;
+
+    // detect segments serial with detectors of main thread, restart decoder and decode again up to current packet
+    // recording is complete and index has byte positions up to current packet, seek direct to key packet
+    int keyPacket = index->GetKeyPacketNumberBefore(packetNumber);
+    decoder->SetByteSeek(true);
+    bool seekOK = (keyPacket >= 0) && decoder->Restart() && decoder->SeekToPacket(keyPacket);
+    decoder->SetByteSeek(false);
+    if (!seekOK) {
+        esyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): seek back to key packet (%d) failed", packetNumber, keyPacket);
+        return false;
+    }
+    while (decoder->DecodeNextFrame(criteria->GetDetectionState(MT_SOUNDCHANGE))) {
+        if (abortNow) return false;
+        if (decoder->IsVideoFrame() && (decoder->GetPacketNumber() >= packetNumber)) {
+            // audio levels up to this packet are already processed, drop them
+            decoder->WaitForAudioLevels();
+            sAudioLevel audioLevel;
+            while (decoder->GetNextAudioLevel(&audioLevel)) {}
+            dsyslog("cMarkAdStandalone::ProcessSegmentStart(): packet (%d): continue serial detection", decoder->GetPacketNumber());
+            return true;
+        }
+    }
+    return false;
+}
+
+
 void cMarkAdStandalone::Recording() {
     if (abortNow) return;
 
@@ -6344,10 +6758,24 @@ void cMarkAdStandalone::Recording() {
     }
     video->SetAspectRatioBroadcast(macontext.Info.AspectRatio);
 
+    // load index of known separators of this channel
+    if (macontext.Config->fingerprint && macontext.Info.ChannelName) {
+        fingerprintIndex = new cFingerprintIndex(decoder, macontext.Config->logoCacheDirectory, macontext.Info.ChannelName);
+        ALLOC(sizeof(*fingerprintIndex), "fingerprintIndex");
+    }
+
     // create object to analyse audio picture
     audio = new cAudio(decoder, index, criteria);
     ALLOC(sizeof(*audio), "audio");
 
+    // compare corners of each analysed picture for special logo detection of this channel
+    // not with forced full decoding, main detection pass analyses only i-frames but Detect() uses all frames
+    if (!macontext.Config->forcedFullDecode && (criteria->IsInfoLogoChannel() || criteria->IsLogoChangeChannel() || criteria->IsClosingCreditsChannel()
+            || criteria->IsAdInFrameWithLogoChannel() || criteria->IsIntroductionLogoChannel())) {
+        compareStream = new cDetectLogoStopStart(decoder, index, criteria, nullptr, -1);
+        ALLOC(sizeof(*compareStream), "compareStream");
+    }
+
     // video type
     if (decoder->GetVideoType() == 0) {
         dsyslog("cMarkAdStandalone::Recording(): video type not set");
@@ -6369,17 +6797,40 @@ void cMarkAdStandalone::Recording() {
     // calculate assumed start and end position
     CalculateCheckPositions(macontext.Info.tStart * decoder->GetVideoFrameRate());
 
+    // resume from checkpoint of a former run
+    if (macontext.Config->checkpoint) {
+        LoadCheckpoint();
+        checkpointPacket = decoder->GetPacketNumber() + CHECKPOINT_INTERVAL * decoder->GetVideoFrameRate();
+    }
+
     CheckIndexGrowing();   // check if we have a running recording and have to wait to get new frames
 
     while (decoder->DecodeNextFrame(criteria->GetDetectionState(MT_SOUNDCHANGE))) {  // only decode audio if we detect silence, channel change detection needs no decoding
         if (abortNow) return;
 
+        // start of next segment detected by worker thread
+        if (segments && decoder->IsVideoFrame() && (decoder->GetPacketNumber() >= segments->GetNextSegmentStart())) {
+            if (!ProcessSegmentStart()) {
+                if (abortNow) return;
+                break;
+            }
+        }
         if (!ProcessFrame()) {   // no error, false if stopA reached
             if (abortNow) return;  // false from abort request
             break;
         }
+        if (!segmentsStarted && doneCheckStart && (macontext.Config->segments > 1)) StartSegments();
+        if (macontext.Config->checkpoint && decoder->IsVideoPacket() && (decoder->GetPacketNumber() >= checkpointPacket)) SaveCheckpoint();
         CheckIndexGrowing();  // check if we have a running recording and have to wait to get new frame
     }
+    if (segments) {
+        FREE(sizeof(*segments), "segments");
+        delete segments;   // wait for worker threads
+        segments = nullptr;
+    }
+
+    // get audio levels of last audio packets from audio decode thread
+    if (!doneCheckStop) ProcessAudioLevels();
 
     // we reached end of recording without CheckStart() or CheckStop() called
     if (!doneCheckStop && (decoder->GetPacketNumber() <= stopA)) {
@@ -6399,6 +6850,7 @@ void cMarkAdStandalone::Recording() {
     CheckMarks();
 
     if (!abortNow) marks.Save(directory, macontext.Info.isRunningRecording, macontext.Config->pts, false);
+    if (!abortNow && macontext.Config->checkpoint) DeleteCheckpoint();  // mark detection is complete, we need no resume
     elapsedTime.markDetection = EndSection("mark detection");
 }
 
@@ -6490,7 +6942,10 @@ bool cMarkAdStandalone::CheckLogo(const int frameRate) {
         strcpy( macontext.Config->logoCacheDirectory, "/tmp");
         dsyslog("cMarkAdStandalone::CheckLogo(): using logo directory %s", macontext.Config->logoCacheDirectory);
         dir = opendir(macontext.Config->logoCacheDirectory);
-        if (!dir) exit(1);
+        if (!dir) {
+            cTrace::Close();
+            exit(1);
+        }
     }
 
     struct dirent *dirent = nullptr;
@@ -6984,6 +7439,7 @@ cMarkAdStandalone::cMarkAdStandalone(const char *directoryParam, sMarkAdConfig *
         if (ver != LIBAVCODEC_VERSION_INT) {
             esyslog("markad build with libavcodec header version %s, but runs with libavcodec lib version %s", AV_STRINGIFY(LIBAVCODEC_VERSION), libver);
             esyslog("libav header and library mismatch, fix your system");
+            cTrace::Close();
             exit(EXIT_FAILURE);
         }
         if (ver < LIBAVCODEC_VERSION_VALID) isyslog("your libavcodec is deprecated, please update");
@@ -6998,6 +7454,7 @@ cMarkAdStandalone::cMarkAdStandalone(const char *directoryParam, sMarkAdConfig *
     char *tmpDir = strdup(directory);
     if (!tmpDir) {
         esyslog("cMarkAdStandalone::cMarkAdStandalone(): memory allocation for tmpDir failed");
+        cTrace::Close();
         exit(EXIT_FAILURE);
     }
 #ifdef DEBUG_MEM
@@ -7063,6 +7520,7 @@ cMarkAdStandalone::cMarkAdStandalone(const char *directoryParam, sMarkAdConfig *
     ALLOC(sizeof(*decoderTest), "decoderTest");
     if (!decoderTest->DecodeNextFrame(false)) {  // decode one video frame to get video info
         esyslog("cMarkAdStandalone::cMarkAdStandalone(): decode of first video packet failed");
+        cTrace::Close();
         exit(EXIT_FAILURE);
     }
     int frameRate = decoderTest->GetVideoFrameRate();   // store frameRate for logo extraction and start mark if markad runs during recording
@@ -7153,27 +7611,46 @@ cMarkAdStandalone::cMarkAdStandalone(const char *directoryParam, sMarkAdConfig *
     // create decoder object
     decoder = new cDecoder(macontext.Config->recDir, macontext.Config->threads, macontext.Config->fullDecode, macontext.Config->hwaccel, macontext.Config->forceHW, macontext.Config->forceInterlaced, index);
     ALLOC(sizeof(*decoder), "decoder");
+    decoder->SetDropCache(macontext.Config->dropCache);
+    decoder->SetFastDecode(macontext.Config->fastDecode);
 }
 
 
 cMarkAdStandalone::~cMarkAdStandalone() {
     dsyslog("cMarkAdStandalone::~cMarkAdStandalone(): delete object");
-    if (!abortNow) marks.Save(directory, macontext.Info.isRunningRecording, macontext.Config->pts, true);
+    if (!abortNow && !macontext.Config->searchLogo) marks.Save(directory, macontext.Info.isRunningRecording, macontext.Config->pts, true);
 
     // cleanup all objects
     if (detectLogoStopStart) {
         FREE(sizeof(*detectLogoStopStart), "detectLogoStopStart");
         delete detectLogoStopStart;
     }
+    if (compareStream) {
+        FREE(sizeof(*compareStream), "compareStream");
+        delete compareStream;
+    }
     if (indexFile) {
         FREE(strlen(indexFile) + 1, "indexFile");
         free(indexFile);
     }
+#ifdef POSIX
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
     if (video) {
         FREE(sizeof(*video), "video");
         delete video;
         video = nullptr;
     }
+    if (segments) {
+        FREE(sizeof(*segments), "segments");
+        delete segments;
+        segments = nullptr;
+    }
+    if (fingerprintIndex) {
+        FREE(sizeof(*fingerprintIndex), "fingerprintIndex");
+        delete fingerprintIndex;
+        fingerprintIndex = nullptr;
+    }
     if (audio) {
         FREE(sizeof(*audio), "audio");
         delete audio;
@@ -7246,6 +7723,10 @@ cMarkAdStandalone::~cMarkAdStandalone() {
         dsyslog("global statistics: --------------------------------------------------------------------------");
         int decodeTime_s = round(decodeTime_ms / 1000);
         dsyslog("decoding:                    time %5ds -> %d:%02d:%02dh", decodeTime_s, decodeTime_s / 3600, (decodeTime_s % 3600) / 60,  decodeTime_s % 60);
+        if (cMemoryBudget::GetLimit() > 0) dsyslog("memory budget:               peak %5" PRId64 "MB of %" PRId64 "MB", cMemoryBudget::GetPeak() / 1024 / 1024, cMemoryBudget::GetLimit() / 1024 / 1024);
+        else dsyslog("accounted memory:            peak %5" PRId64 "MB", cMemoryBudget::GetPeak() / 1024 / 1024);
+        long int peakRSS = cMemoryBudget::GetPeakRSS();
+        if (peakRSS >= 0) isyslog("resident memory (RSS):       peak %5ldMB", peakRSS / 1024);
 
         gettimeofday(&endAll, nullptr);
         sec              = endAll.tv_sec  - startAll.tv_sec;
@@ -7372,6 +7853,41 @@ int usage(int svdrpport) {
            "                                                 e.g.: vdpau, cuda, vaapi, vulkan, ...\n"
            "                --perftest>\n"
            "                  run decoder performance test and compare software and hardware decoder\n"
+           "                --dropcache\n"
+           "                  drop already processed parts of the recording from page cache\n"
+           "                  keeps page cache of the system intact, but later passes have to read from disk again\n"
+           "                --checkpoint\n"
+           "                  write state of mark detection every 5 minutes to the recording directory\n"
+           "                  if markad was stopped, the next run resumes mark detection from this checkpoint\n"
+           "                --statusfd=<fd>\n"
+           "                  report pid to inherited file descriptor <fd> and keep it open until markad exits\n"
+           "                  used by the VDR plugin to get notified of markad completion\n"
+           "                --fastdecode\n"
+           "                  use analysis decode profile for mark detection, skip loop filter and IDCT of non key frames\n"
+           "                  faster decoding with lower picture quality, video cut still uses full quality\n"
+           "                --fastdecodetest\n"
+           "                  detect marks with analysis and with full quality decode profile and log differences\n"
+           "                  marks file contains the result of full quality decode profile\n"
+           "                --fingerprint\n"
+           "                  use and update per channel index of known separators in logo cache directory\n"
+           "                  skip mark optimization for marks at separators verified in at least 3 former recordings\n"
+           "                --segments=<n>\n"
+           "                  split mark detection of finished recordings into <n> segments (max 8) detected in parallel threads\n"
+           "                  marks of a segment are only used if detector states at segment border are the same as in serial detection\n"
+           "                --searchlogo\n"
+           "                  only search logo and store it in recording directory, no mark detection and no change of marks file\n"
+           "                  used by the VDR plugin to prepare logos for channels of upcoming timers\n"
+           "                --generate=<script>\n"
+           "                  generate synthetic recording from <script> into recording directory, detect marks and compare with ground truth\n"
+           "                  recording directory is created if it does not exist\n"
+           "                --max-memory=<MB>\n"
+           "                  limit memory of logo search candidates, logo compare results and overlap histograms to <MB>\n"
+           "                  if the limit is reached, these subsystems keep less data instead of growing\n"
+           "                --trace=<file>\n"
+           "                  write timestamped spans of decoder, detectors, logo compare, overlap and encoder per thread\n"
+           "                  to <file> in Chrome trace JSON format, view with chrome://tracing or Perfetto\n"
+           "                --tracerate=<n>\n"
+           "                  trace only spans of every <n>-th video packet of each thread (default 1)\n"
            "\ncmd: one of\n"
            "-                            dummy-parameter if called directly\n"
            "nice                         runs markad directly and with nice(19)\n"
@@ -7438,6 +7954,136 @@ void freedir(void) {
 }
 
 
+// detect marks and optimize mark positions
+// learn is false if the recording is detected again afterwards, separators of a recording are learned only once
+void DetectMarks(cMarkAdStandalone *cmasta, const bool learn) {
+    // detect marks
+    if (!abortNow) cmasta->Recording();
+
+    // logo mark optimization
+    if (!abortNow) cmasta->LogoMarkOptimization();      // logo mark optimization
+
+    // overlap detection
+    if (!abortNow) cmasta->ProcessOverlap();            // overlap and closing credits detection
+
+    // minor mark position optimization
+    if (!abortNow) cmasta->BlackScreenOptimization();   // mark optimization with black scene
+    if (!abortNow) cmasta->SilenceOptimization();       // mark optimization with mute scene
+    if (!abortNow) cmasta->LowerBorderOptimization();   // mark optimization with lower border
+    if (!abortNow) cmasta->SceneChangeOptimization();   // final optimization with scene changes (if we habe nothing else, try this as last resort)
+
+    // learn separators of final marks for next recordings of this channel
+    if (learn && !abortNow) cmasta->LearnFingerprint();
+}
+
+
+// detect marks with analysis decode profile and with full quality decode profile and compare results
+// first pass uses cmasta created with analysis decode profile, returns object of second pass, nullptr on abort
+cMarkAdStandalone *FastDecodeTest(cMarkAdStandalone *cmasta, sMarkAdConfig *config) {
+    // pass 1: analysis decode profile, learn separators only from final marks of pass 2
+    struct timeval startPass = {};
+    struct timeval endPass   = {};
+    gettimeofday(&startPass, nullptr);
+    DetectMarks(cmasta, false);
+    gettimeofday(&endPass, nullptr);
+    long int timeFast = (endPass.tv_sec - startPass.tv_sec) * 1000 + (endPass.tv_usec - startPass.tv_usec) / 1000;
+
+    // keep marks of pass 1, cmasta will be deleted
+    cMarks marksFast;
+    for (cMark *mark = cmasta->GetMarks()->GetFirst(); mark; mark = mark->Next()) {
+        marksFast.Add(mark->type, mark->oldType, mark->newType, mark->position, mark->pts, mark->comment, mark->inBroadCast);
+    }
+    FREE(sizeof(*cmasta), "cmasta");
+    delete cmasta;
+    if (abortNow) return nullptr;
+
+    // pass 2: full quality decode profile, marks file gets result of this pass
+    config->fastDecode = false;
+    cmasta = new cMarkAdStandalone(config->recDir, config);
+    ALLOC(sizeof(*cmasta), "cmasta");
+    gettimeofday(&startPass, nullptr);
+    DetectMarks(cmasta, true);
+    gettimeofday(&endPass, nullptr);
+    long int timeFull = (endPass.tv_sec - startPass.tv_sec) * 1000 + (endPass.tv_usec - startPass.tv_usec) / 1000;
+    if (abortNow) return cmasta;
+
+    // compare marks of both passes
+    cTools::LogSeparator(true);
+    dsyslog("compare marks of full quality decode profile with analysis decode profile:");
+    int diffCount = 0;
+    cMark *markFull = cmasta->GetMarks()->GetFirst();
+    cMark *markFast = marksFast.GetFirst();
+    while (markFull || markFast) {
+        if (markFull && markFast && (markFull->type == markFast->type)) {
+            int diff = markFast->position - markFull->position;
+            if (diff != 0) diffCount++;
+            dsyslog("mark type 0x%X: full (%6d), fast (%6d), difference %5d frames", markFull->type, markFull->position, markFast->position, diff);
+            markFull = markFull->Next();
+            markFast = markFast->Next();
+        }
+        else if (markFull && (!markFast || (markFull->position <= markFast->position))) {
+            dsyslog("mark type 0x%X: full (%6d), missing with analysis decode profile", markFull->type, markFull->position);
+            diffCount++;
+            markFull = markFull->Next();
+        }
+        else {
+            dsyslog("mark type 0x%X: fast (%6d), missing with full quality decode profile", markFast->type, markFast->position);
+            diffCount++;
+            markFast = markFast->Next();
+        }
+    }
+    isyslog("analysis decode profile: %d marks differ, detection time full quality %lds, analysis %lds", diffCount, timeFull / 1000, timeFast / 1000);
+    cTools::LogSeparator(true);
+    return cmasta;
+}
+
+
+// detect marks of synthetic recording and compare with ground truth marks of generator
+void GeneratorTest(cMarkAdStandalone *cmasta, const cGenerator *generator) {
+    struct timeval startDetect = {};
+    struct timeval endDetect   = {};
+    gettimeofday(&startDetect, nullptr);
+    DetectMarks(cmasta, true);
+    gettimeofday(&endDetect, nullptr);
+    long int timeDetect = (endDetect.tv_sec - startDetect.tv_sec) * 1000 + (endDetect.tv_usec - startDetect.tv_usec) / 1000;
+    if (abortNow) return;
+
+    // each ground truth mark matches nearest unused detected mark of same direction in max distance
+    const std::vector<sGeneratorMark> *truthMarks = generator->GetMarks();
+    const int maxDiff = 30 * generator->GetFrameRate();
+    std::vector<cMark *> used;
+    cTools::LogSeparator(true);
+    dsyslog("compare detected marks with ground truth marks of synthetic recording:");
+    int found   = 0;
+    int sumDiff = 0;
+    for (const sGeneratorMark &truthMark : *truthMarks) {
+        cMark *nearest = nullptr;
+        for (cMark *mark = cmasta->GetMarks()->GetFirst(); mark; mark = mark->Next()) {
+            if ((mark->type & 0x0F) != truthMark.type) continue;
+            if (std::find(used.begin(), used.end(), mark) != used.end()) continue;
+            if (abs(mark->position - truthMark.position) > maxDiff) continue;
+            if (!nearest || (abs(mark->position - truthMark.position) < abs(nearest->position - truthMark.position))) nearest = mark;
+        }
+        if (nearest) {
+            int diff = nearest->position - truthMark.position;
+            dsyslog("mark type 0x%X: ground truth (%6d), detected (%6d) type 0x%X, difference %5d frames", truthMark.type, truthMark.position, nearest->position, nearest->type, diff);
+            used.push_back(nearest);
+            sumDiff += abs(diff);
+            found++;
+        }
+        else dsyslog("mark type 0x%X: ground truth (%6d), not detected", truthMark.type, truthMark.position);
+    }
+    int falseMarks = 0;
+    for (cMark *mark = cmasta->GetMarks()->GetFirst(); mark; mark = mark->Next()) {
+        if (std::find(used.begin(), used.end(), mark) != used.end()) continue;
+        dsyslog("mark type 0x%X: detected (%6d), not in ground truth", mark->type, mark->position);
+        falseMarks++;
+    }
+    isyslog("synthetic recording: %d of %zu marks detected, %d false marks, sum of differences %d frames, detection time %lds", found, truthMarks->size(), falseMarks, sumDiff, timeDetect / 1000);
+    cTools::LogSeparator(true);
+}
+
+
 int main(int argc, char *argv[]) {
     bool bAfter         = false;
     bool bEdited        = false;
@@ -7447,6 +8093,7 @@ int main(int argc, char *argv[]) {
     int niceLevel       = 19;
     int ioprio_class    = 3;
     int ioprio          = 7;
+    int statusFd        = -1;
     const char *tok     = nullptr;
     char *str           = nullptr;
     int ntok            = 0;
@@ -7510,6 +8157,18 @@ int main(int argc, char *argv[]) {
             {"pts",          0, 0, 15},     // undocumented, only for development use
             {"hwaccel",      1, 0, 16},
             {"perftest",     0, 0, 17},     // undocumented, only for development use
+            {"dropcache",    0, 0, 18},
+            {"checkpoint",   0, 0, 19},
+            {"statusfd",     1, 0, 20},
+            {"fastdecode",   0, 0, 21},
+            {"fastdecodetest", 0, 0, 22},
+            {"fingerprint",  0, 0, 23},
+            {"segments",     1, 0, 24},
+            {"searchlogo",   0, 0, 25},
+            {"generate",     1, 0, 26},
+            {"max-memory",   1, 0, 27},
+            {"trace",        1, 0, 28},
+            {"tracerate",    1, 0, 29},
 
             {0, 0, 0, 0}
         };
@@ -7741,6 +8400,68 @@ int main(int argc, char *argv[]) {
         case 17: // --perftest
             config.perftest = true;
             break;
+        case 18: // --dropcache
+            config.dropCache = true;
+            break;
+        case 19: // --checkpoint
+            config.checkpoint = true;
+            break;
+        case 20: // --statusfd
+            statusFd = atoi(optarg);
+            if (statusFd <= STDERR_FILENO) {
+                fprintf(stderr, "markad: invalid statusfd value: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 21: // --fastdecode
+            config.fastDecode = true;
+            break;
+        case 22: // --fastdecodetest
+            config.fastDecodeTest = true;
+            config.fastDecode     = true;   // first pass with analysis decode profile
+            break;
+        case 23: // --fingerprint
+            config.fingerprint = true;
+            break;
+        case 24: // --segments
+            config.segments = atoi(optarg);
+            if (config.segments < 1) {
+                fprintf(stderr, "markad: invalid segments value: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 25: // --searchlogo
+            config.searchLogo = true;
+            break;
+        case 26: // --generate
+            if ((strlen(optarg) + 1) > sizeof(config.generateScript)) {
+                fprintf(stderr, "markad: generator script file name too long: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            strncpy(config.generateScript, optarg, sizeof(config.generateScript) - 1);
+            break;
+        case 27: // --max-memory
+            config.maxMemory = atoi(optarg);
+            if (config.maxMemory < 1) {
+                fprintf(stderr, "markad: invalid max-memory value: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            cMemoryBudget::SetLimit(static_cast<int64_t>(config.maxMemory) * 1024 * 1024);
+            break;
+        case 28: // --trace
+            if ((strlen(optarg) + 1) > sizeof(config.traceFile)) {
+                fprintf(stderr, "markad: trace file name too long: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            strncpy(config.traceFile, optarg, sizeof(config.traceFile) - 1);
+            break;
+        case 29: // --tracerate
+            config.traceRate = atoi(optarg);
+            if (config.traceRate < 1) {
+                fprintf(stderr, "markad: invalid tracerate value: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
         default:
             printf ("markad: invalid option -%c\n", option);
         }
@@ -7771,6 +8492,11 @@ int main(int argc, char *argv[]) {
             }
             else {
                 if (strstr(argv[optind], ".rec") != nullptr ) {
+                    // synthetic recording is generated into a new recording directory
+                    if (config.generateScript[0] && (access(argv[optind], F_OK) == -1) && (mkdir(argv[optind], 0755) == -1)) {
+                        fprintf(stderr, "markad: failed to create recording directory: %s\n", argv[optind]);
+                        return EXIT_FAILURE;
+                    }
                     recDir = realpath(argv[optind], nullptr);
                     if (!recDir) {
                         fprintf(stderr, "markad: invalid recording directory: %s\n", argv[optind]);
@@ -7788,6 +8514,11 @@ int main(int argc, char *argv[]) {
         strncpy(config.logFile, "markad.log", sizeof(config.logFile));
         config.logFile[sizeof("markad.log") - 1] = 0;
     }
+    // logo search runs on an existing recording, keep its log file and do not leave a pid file
+    if (config.searchLogo) {
+        LOG2REC      = false;
+        config.noPid = true;
+    }
 
     if (bEdited) return EXIT_SUCCESS; // do nothing if called from vdr before/after the video is cutted
     if ((bAfter) && (config.online > 0)) { // online not valid together with after
@@ -7866,8 +8597,19 @@ int main(int argc, char *argv[]) {
         (void)umask((mode_t)0022);
 
         int MaxPossibleFileDescriptors = getdtablesize();
-        for (int i = STDERR_FILENO + 1; i < MaxPossibleFileDescriptors; i++)
-            close(i); //close all dup'ed filedescriptors
+        for (int i = STDERR_FILENO + 1; i < MaxPossibleFileDescriptors; i++) {
+            if (i != statusFd) close(i); //close all dup'ed filedescriptors, keep status pipe to caller
+        }
+
+#ifdef POSIX
+        // report pid of the forked process to the caller, the caller gets EOF on status pipe if we exit
+        if (statusFd >= 0) {
+            if (dprintf(statusFd, "pid %d\n", static_cast<int> (getpid())) < 0) {
+                fprintf(stderr, "markad: failed to write to statusfd %d\n", statusFd);
+                statusFd = -1;
+            }
+        }
+#endif /* ifdef POSIX */
 
         // should we renice ?
         if (bNice) {
@@ -7921,9 +8663,36 @@ int main(int argc, char *argv[]) {
         signal(SIGCONT, signal_handler);
 #endif /* ifdef POSIX */
 
+        // trace of pipeline spans
+        if (config.traceFile[0] && !cTrace::Open(config.traceFile, config.traceRate)) {
+            fprintf(stderr, "markad: failed to open trace file %s\n", config.traceFile);
+            return EXIT_FAILURE;
+        }
+
+        // generate synthetic recording before cMarkAdStandalone reads info and index
+        cGenerator *generator = nullptr;
+        if (config.generateScript[0]) {
+            generator = new cGenerator(recDir);
+            ALLOC(sizeof(*generator), "generator");
+            if (!generator->ReadScript(config.generateScript) || !generator->Generate()) {
+                fprintf(stderr, "markad: failed to generate recording from script %s\n", config.generateScript);
+                FREE(sizeof(*generator), "generator");
+                delete generator;
+                cTrace::Close();
+                return EXIT_FAILURE;
+            }
+        }
+
         // init cMarkAdStandalone here, we need now log to recording
         cMarkAdStandalone *cmasta = new cMarkAdStandalone(recDir, &config);
-        if (!cmasta) return EXIT_FAILURE;
+        if (!cmasta) {
+            if (generator) {
+                FREE(sizeof(*generator), "generator");
+                delete generator;
+            }
+            cTrace::Close();
+            return EXIT_FAILURE;
+        }
         ALLOC(sizeof(*cmasta), "cmasta");
 
         dsyslog("parameter --loglevel is set to %i", SysLogLevel);
@@ -7970,6 +8739,17 @@ int main(int argc, char *argv[]) {
         }
         if (config.hwaccel[0] != 0) dsyslog("parameter --hwaccel=%s is set", config.hwaccel);
         else dsyslog("use software decoder/encoder");
+        if (config.dropCache) dsyslog("parameter --dropcache is set");
+        if (config.checkpoint) dsyslog("parameter --checkpoint is set");
+        if (statusFd >= 0) dsyslog("parameter --statusfd is set to %d", statusFd);
+        if (config.fastDecode) dsyslog("parameter --fastdecode is set");
+        if (config.fastDecodeTest) dsyslog("parameter --fastdecodetest is set");
+        if (config.fingerprint) dsyslog("parameter --fingerprint is set");
+        if (config.segments > 1) dsyslog("parameter --segments is set to %d", config.segments);
+        if (config.searchLogo) dsyslog("parameter --searchlogo is set");
+        if (config.generateScript[0]) dsyslog("parameter --generate is set to %s", config.generateScript);
+        if (config.maxMemory > 0) dsyslog("parameter --max-memory is set to %dMB", config.maxMemory);
+        if (config.traceFile[0]) dsyslog("parameter --trace is set to %s, sample every %d. video packet", config.traceFile, config.traceRate);
 
         if (config.logoExtraction == -1) {
             // performance test
@@ -7978,22 +8758,21 @@ int main(int argc, char *argv[]) {
                 test->Perf();
                 delete test;
             }
+            // validation of analysis decode profile
+            else if (!abortNow && config.fastDecodeTest) {
+                cmasta = FastDecodeTest(cmasta, &config);
+            }
+            // detect marks of synthetic recording and compare with ground truth
+            else if (!abortNow && generator) {
+                GeneratorTest(cmasta, generator);
+            }
+            // logo search is done in constructor
+            else if (config.searchLogo) {
+                isyslog("logo search done, skip mark detection");
+            }
             else {
-
-                // detect marks
-                if (!abortNow) cmasta->Recording();
-
-                // logo mark optimization
-                if (!abortNow) cmasta->LogoMarkOptimization();      // logo mark optimization
-
-                // overlap detection
-                if (!abortNow) cmasta->ProcessOverlap();            // overlap and closing credits detection
-
-                // minor mark position optimization
-                if (!abortNow) cmasta->BlackScreenOptimization();   // mark optimization with black scene
-                if (!abortNow) cmasta->SilenceOptimization();       // mark optimization with mute scene
-                if (!abortNow) cmasta->LowerBorderOptimization();   // mark optimization with lower border
-                if (!abortNow) cmasta->SceneChangeOptimization();   // final optimization with scene changes (if we habe nothing else, try this as last resort)
+                // detect and optimize marks
+                DetectMarks(cmasta, true);
 
                 // video cut
                 if (!abortNow) if (config.MarkadCut) cmasta->MarkadCut();
@@ -8005,9 +8784,16 @@ int main(int argc, char *argv[]) {
 
             }
         }
-        FREE(sizeof(*cmasta), "cmasta");
-        delete cmasta;
-        cmasta = nullptr;
+        if (cmasta) {
+            FREE(sizeof(*cmasta), "cmasta");
+            delete cmasta;
+            cmasta = nullptr;
+        }
+        if (generator) {
+            FREE(sizeof(*generator), "generator");
+            delete generator;
+        }
+        cTrace::Close();
 
 #ifdef DEBUG_MEM
         memList();
@@ -25,6 +25,8 @@
 #include "decoder.h"
 #include "evaluate.h"
 #include "video.h"
+#include "fingerprint.h"
+#include "segment.h"
 
 /* forward declarations */
 class cOSDMessage;
@@ -113,6 +115,28 @@ typedef struct sMarkAdConfig {
     //!
     bool perftest                  = false;    //!< <b>true:</b>  run decoder performance test before detect marks<br>
     //!< <b>false:</b> otherwise
+    bool dropCache                 = false;    //!< <b>true:</b>  drop consumed pages of recording from page cache<br>
+    //!< <b>false:</b> otherwise
+    bool checkpoint                = false;    //!< <b>true:</b>  write checkpoint of mark detection and resume from it<br>
+    //!< <b>false:</b> otherwise
+    bool fastDecode                = false;    //!< <b>true:</b>  use analysis decode profile for mark detection<br>
+    //!< <b>false:</b> decode with full quality
+    bool fastDecodeTest            = false;    //!< <b>true:</b>  detect marks with analysis and full quality decode profile and compare results<br>
+    //!< <b>false:</b> otherwise
+    bool fingerprint               = false;    //!< <b>true:</b>  use and update per channel index of known separators in logo cache directory<br>
+    //!< <b>false:</b> otherwise
+    int segments                   = 0;        //!< count of segments of finished recordings detected in parallel threads, 0 or 1 to detect serial
+    //!<
+    bool searchLogo                = false;    //!< <b>true:</b>  only search and extract logo to recording directory, no mark detection<br>
+    //!< <b>false:</b> otherwise
+    char generateScript[1024]      = {};       //!< script of synthetic recording to generate into recording directory before mark detection, empty if not set
+    //!<
+    int maxMemory                  = 0;        //!< memory budget in MB of the big buffers of mark detection, 0 for no limit
+    //!<
+    char traceFile[1024]           = {};       //!< Chrome trace JSON file of pipeline spans, empty if not set
+    //!<
+    int traceRate                  = 1;        //!< record spans of every n-th video packet of each thread
+    //!<
 } sMarkAdConfig;
 
 
@@ -192,12 +216,21 @@ public:
         vps                       = nullptr;
         checkAudio                = origin.checkAudio;
         detectLogoStopStart       = origin.detectLogoStopStart;
+        compareStream             = nullptr;
         doneCheckStop             = origin.doneCheckStop;
         doneCheckStart            = origin.doneCheckStart;
         packetEndPart             = origin.packetEndPart;
         packetCheckStop           = origin.packetCheckStop;
         extractLogo               = nullptr;
         sleepcnt                  = origin.sleepcnt;
+        inotifyFd                 = -1;
+        inotifyFailed             = origin.inotifyFailed;
+        checkpointPacket          = origin.checkpointPacket;
+        resumePacket              = origin.resumePacket;
+        resumeMarkTypes           = origin.resumeMarkTypes;
+        fingerprintIndex          = nullptr;
+        segments                  = nullptr;
+        segmentsStarted           = origin.segmentsStarted;
     };
 
     /**
@@ -224,6 +257,14 @@ public:
         inBroadCast               = origin->inBroadCast;
         indexFile                 = origin->indexFile;
         sleepcnt                  = origin->sleepcnt;
+        inotifyFd                 = -1;
+        inotifyFailed             = origin->inotifyFailed;
+        checkpointPacket          = origin->checkpointPacket;
+        resumePacket              = origin->resumePacket;
+        resumeMarkTypes           = origin->resumeMarkTypes;
+        fingerprintIndex          = nullptr;
+        segments                  = nullptr;
+        segmentsStarted           = origin->segmentsStarted;
         macontext                 = origin->macontext;
         length                    = origin->length;
         evaluateLogoStopStartPair = origin->evaluateLogoStopStartPair;
@@ -232,6 +273,7 @@ public:
         startTime                 = origin->startTime;
         iStopinBroadCast          = origin->iStopinBroadCast;
         detectLogoStopStart       = origin->detectLogoStopStart;
+        compareStream             = nullptr;
         doneCheckStop             = origin->doneCheckStop;
         doneCheckStart            = origin->doneCheckStart;
         packetCheckStop           = origin->packetCheckStop;
@@ -278,6 +320,19 @@ public:
      */
     void SceneChangeOptimization();
 
+    /**
+     * learn separators of final marks for fingerprint index of channel
+     */
+    void LearnFingerprint();
+
+    /**
+     * get detected marks
+     * @return pointer to marks object
+     */
+    cMarks *GetMarks() {
+        return &marks;
+    };
+
     /**
      * cut recording based on detected marks
      */
@@ -447,6 +502,13 @@ private:
      */
     void AddMark(sMarkAdMark *mark);
 
+    /**
+     * add a mark from video or audio detectors of the main pass to marks object
+     * after resume from checkpoint, marks before resume position and repeated states of restored marks are dropped
+     * @param mark to add to object
+     */
+    void AddDetectorMark(sMarkAdMark *mark);
+
     /**
      * add or replace marks by VPS events if we have not found stronger marks than black screen marks
      * @param offset  recording start offset of the VPS event
@@ -460,6 +522,31 @@ private:
      */
     void CheckIndexGrowing();
 
+    /**
+     * wait for changes of running recording <br>
+     * use inotify on recording directory, fallback to sleep if inotify is not available
+     * @param timeout max time to wait in s
+     * @return true if recording has changed, false after timeout or without change detection
+     */
+    bool WaitForRecordingChange(const unsigned int timeout);
+
+    /**
+     * write state of mark detection to checkpoint file in recording directory
+     */
+    void SaveCheckpoint();
+
+    /**
+     * resume mark detection from checkpoint file in recording directory <br>
+     * restore marks, criteria and mark detection state and seek decoder to checkpoint position
+     * @return true if resumed from checkpoint, false otherwise
+     */
+    bool LoadCheckpoint();
+
+    /**
+     * delete checkpoint file from recording directory
+     */
+    void DeleteCheckpoint();
+
     /**
      * check if 00001.ts exists in recording directory
      * @return true if 00001.ts exists in recording directory, false otherwise
@@ -503,6 +590,25 @@ private:
      */
     bool ProcessFrame();
 
+    /**
+     * wait for audio decode thread to decode all audio packets read so far and detect audio marks from these levels <br>
+     * audio levels lag behind video packets, call before decisions that need all marks up to current packet
+     */
+    void ProcessAudioLevels();
+
+    /**
+     * start detection of following segments in worker threads, only for finished recordings
+     */
+    void StartSegments();
+
+    /**
+     * process start of next segment, take marks of all following valid segments and seek behind them <br>
+     * new detectors are warmed up before first packet after valid segments and replace detectors of main thread if their state is the same as at end of last valid segment,
+     * otherwise the segments are detected serial from current packet, current packet is first packet to process after return
+     * @return true if successful, false on end of recording or abort
+     */
+    bool ProcessSegmentStart();
+
     /**
      * create markad.pid file
      */
@@ -573,6 +679,16 @@ private:
     //!<
     int sleepcnt                     = 0;        //!< count of sleeps to wait for new frames when decode during recording
     //!<
+    int inotifyFd                    = -1;       //!< inotify file descriptor to wait for changes of running recording
+    //!<
+    bool inotifyFailed               = false;    //!< true if inotify is not usable, fallback to polling
+    //!<
+    int checkpointPacket             = -1;       //!< packet number of next checkpoint
+    //!<
+    int resumePacket                 = -1;       //!< packet number we resumed from checkpoint, -1 if not resumed
+    //!<
+    int resumeMarkTypes              = 0;        //!< bitmask of mark types already checked after resume
+    //!<
     cMarks marks                     = {};       //!< objects with all strong marks
     //!<
     cMarks sceneMarks                = {};       //!< objects with all scene change marks
@@ -587,6 +703,14 @@ private:
     //!<
     cDetectLogoStopStart *detectLogoStopStart             = nullptr;  //!< pointer to class cDetectLogoStopStart
     //!<
+    cDetectLogoStopStart *compareStream                   = nullptr;  //!< pointer to class cDetectLogoStopStart, compare results of main detection pass for special logo detection
+    //!<
+    cFingerprintIndex *fingerprintIndex                   = nullptr;  //!< pointer to class cFingerprintIndex, per channel index of known separators
+    //!<
+    cSegments *segments                                   = nullptr;  //!< pointer to class cSegments, parallel detection of segments
+    //!<
+    bool segmentsStarted                                  = false;    //!< true if segmented detection was checked
+    //!<
 
     /**
      * elapsed time of section
@@ -14,6 +14,8 @@
 #include <string.h>
 #include <stdint.h>
 #include <fcntl.h>
+#include <new>
+#include <algorithm>
 #include "global.h"
 #ifdef WINDOWS
 #include "win32/mingw64.h"
@@ -88,12 +90,57 @@ char *cMark::GetTime() {
 cMarks::cMarks() {
     strcpy(filename, "marks");
     first = last = nullptr;
-    count = 0;
 }
 
 
 cMarks::~cMarks() {
     DelAll();
+    for (std::vector<char *>::iterator chunk = poolChunks.begin(); chunk != poolChunks.end(); ++chunk) {
+        FREE(MARKS_POOL_CHUNK * sizeof(cMark), "markPool");
+        free(*chunk);
+    }
+}
+
+
+// marks are allocated in chunks, sceneMarks and blackMarks can have thousands of entries with full decode
+//
+cMark *cMarks::NewMark(const int type, const int oldType, const int newType, const int position, const int64_t framePTS, const char *comment, const bool inBroadCast) {
+    if (poolFree.empty()) {
+        char *chunk = static_cast<char *>(malloc(MARKS_POOL_CHUNK * sizeof(cMark)));
+        if (!chunk) {
+            esyslog("cMarks::NewMark(): out of memory");
+            return nullptr;
+        }
+        ALLOC(MARKS_POOL_CHUNK * sizeof(cMark), "markPool");
+        poolChunks.push_back(chunk);
+        for (int i = MARKS_POOL_CHUNK - 1; i >= 0; i--) poolFree.push_back(chunk + (i * sizeof(cMark)));
+    }
+    void *memory = poolFree.back();
+    poolFree.pop_back();
+    return new (memory) cMark(type, oldType, newType, position, framePTS, comment, inBroadCast);
+}
+
+
+void cMarks::DeleteMark(cMark *mark) {
+    if (!mark) return;
+    mark->~cMark();
+    poolFree.push_back(mark);
+}
+
+
+int cMarks::LowerBound(const int position) const {
+    std::vector<cMark *>::const_iterator pos = std::lower_bound(sorted.begin(), sorted.end(), position, [](const cMark *mark, const int value) {
+        return mark->position < value;
+    });
+    return pos - sorted.begin();
+}
+
+
+int cMarks::UpperBound(const int position) const {
+    std::vector<cMark *>::const_iterator pos = std::upper_bound(sorted.begin(), sorted.end(), position, [](const int value, const cMark *mark) {
+        return value < mark->position;
+    });
+    return pos - sorted.begin();
 }
 
 
@@ -136,32 +183,21 @@ void cMarks::Debug() {           // write all marks to log file
 
 
 int cMarks::Count(const int type, const int mask) const {
-    if (!first) return 0;
-    if (type == 0xFF) return count;
+    if (type == 0xFF) return sorted.size();
 
     int ret = 0;
-    cMark *mark = first;
-    while (mark) {
-        if ((mark->type & mask) == type) ret++;
-        mark = mark->Next();
+    for (std::vector<cMark *>::const_iterator mark = sorted.begin(); mark != sorted.end(); ++mark) {
+        if (((*mark)->type & mask) == type) ret++;
     }
     return ret;
 }
 
 
 void cMarks::Del(const int position) {
-    if (!first) return; // no elements yet
-
-    cMark *next, *mark = first;
-    while (mark) {
-        next = mark->Next();
-        if (mark->position == position) {
-            dsyslog("cMarks::Del(): delete mark (%d)", position);
-            Del(mark);
-            return;
-        }
-        mark = next;
-    }
+    cMark *mark = Get(position);
+    if (!mark) return;
+    dsyslog("cMarks::Del(): delete mark (%d)", position);
+    Del(mark);
 }
 
 
@@ -179,7 +215,8 @@ void cMarks::DelType(const int type, const int mask) {
 
 
 void cMarks::DelWeakFromTo(const int from, const int to, const short int type) {
-    cMark *mark = first;
+    int start = UpperBound(from);
+    cMark *mark = (start < static_cast<int>(sorted.size())) ? sorted[start] : nullptr;
     while (mark) {
         if (mark->position >= to) return;
         if ((mark->position > from) && (mark->type < (type & 0xF0))) {
@@ -196,7 +233,8 @@ void cMarks::DelWeakFromTo(const int from, const int to, const short int type) {
 // include <from> and <to>
 //
 void cMarks::DelFromTo(const int from, const int to, const int type, const int mask) {
-    cMark *mark = first;
+    int start = LowerBound(from);
+    cMark *mark = (start < static_cast<int>(sorted.size())) ? sorted[start] : nullptr;
     while (mark) {
         if (mark->position > to) return;
         if ((mark->position >= from) && ((type == MT_ALL) || ((mark->type & mask) == type))) {
@@ -216,23 +254,14 @@ void cMarks::DelFromTo(const int from, const int to, const int type, const int m
 void cMarks::DelTill(const int position, const bool fromStart) {
     cMark *next, *mark = first;
     if (!fromStart) {
-        while (mark) {
-            if (mark->position > position) break;
-            mark = mark->Next();
-        }
+        int start = UpperBound(position);
+        mark = (start < static_cast<int>(sorted.size())) ? sorted[start] : nullptr;
     }
     while (mark) {
+        if (fromStart && (mark->position >= position)) break;
         next = mark->Next();
-        if (fromStart) {
-            if (mark->position < position) {
-                dsyslog("cMarks::DelTill(): delete mark (%d)", mark->position);
-                Del(mark);
-            }
-        }
-        else {
-            dsyslog("cMarks::DelTill(): delete mark (%d)", mark->position);
-            Del(mark);
-        }
+        dsyslog("cMarks::DelTill(): delete mark (%d)", mark->position);
+        Del(mark);
         mark = next;
     }
 }
@@ -241,11 +270,8 @@ void cMarks::DelTill(const int position, const bool fromStart) {
 // delete all marks after position to last mark
 //
 void cMarks::DelAfterFromToEnd(const int position) {
-    cMark *mark = first;
-    while (mark) {  // find first mark after position
-        if (mark->position > position) break;
-        mark = mark->Next();
-    }
+    int start = UpperBound(position);  // find first mark after position
+    cMark *mark = (start < static_cast<int>(sorted.size())) ? sorted[start] : nullptr;
     while (mark) {
         cMark * next = mark->Next();
         Del(mark);
@@ -255,12 +281,8 @@ void cMarks::DelAfterFromToEnd(const int position) {
 
 
 void cMarks::DelAll() {
-    cMark *next, *mark = first;
-    while (mark) {
-        next = mark->Next();
-        Del(mark);
-        mark=next;
-    }
+    for (std::vector<cMark *>::iterator mark = sorted.begin(); mark != sorted.end(); ++mark) DeleteMark(*mark);
+    sorted.clear();
     first = nullptr;
     last = nullptr;
 }
@@ -312,31 +334,18 @@ void cMarks::DelInvalidSequence() {
 void cMarks::Del(cMark *mark) {
     if (!mark) return;
 
-    if (first == mark) {
-        // we are the first mark
-        first = mark->Next();
-        if (first) {
-            first->SetPrev(nullptr);
-        }
-        else {
-            last = nullptr;
-        }
-    }
-    else {
-        if (mark->Next() && (mark->Prev())) {
-            // there is a next and prev object
-            mark->Prev()->SetNext(mark->Next());
-            mark->Next()->SetPrev(mark->Prev());
-        }
-        else {
-            // we are the last
-            mark->Prev()->SetNext(nullptr);
-            last=mark->Prev();
-        }
+    int pos = LowerBound(mark->position);
+    if ((pos >= static_cast<int>(sorted.size())) || (sorted[pos] != mark)) {
+        esyslog("cMarks::Del(): mark (%d) not found", mark->position);
+        return;
     }
-    FREE(sizeof(*mark), "mark");
-    delete mark;
-    count--;
+    sorted.erase(sorted.begin() + pos);
+
+    if (mark->Prev()) mark->Prev()->SetNext(mark->Next());
+    else first = mark->Next();   // we are the first mark
+    if (mark->Next()) mark->Next()->SetPrev(mark->Prev());
+    else last = mark->Prev();    // we are the last mark
+    DeleteMark(mark);
 }
 
 
@@ -346,14 +355,9 @@ cMark *cMarks::First() {
 
 
 cMark *cMarks::Get(const int position) {
-    if (!first) return nullptr; // no elements yet
-
-    cMark *mark = first;
-    while (mark) {
-        if (position == mark->position) break;
-        mark = mark->Next();
-    }
-    return mark;
+    int pos = LowerBound(position);
+    if ((pos < static_cast<int>(sorted.size())) && (sorted[pos]->position == position)) return sorted[pos];
+    return nullptr;
 }
 
 
@@ -391,43 +395,19 @@ cMark *cMarks::GetAround(const int frames, const int position, const int type, c
 
 
 cMark *cMarks::GetPrev(const int position, const int type, const int mask) {
-    if (!first) return nullptr; // no elements yet
-
-    // first advance
-    cMark *mark = first;
-    while (mark) {
-        if (mark->position >= position) break;
-        mark = mark->Next();
-    }
-    if (type == 0xFF) {
-        if (mark) return mark->Prev();
-        return last;
-    }
-    else {
-        if (!mark) mark = last;
-        else mark = mark->Prev();
-        while (mark) {
-            if ((mark->type & mask) == type) break;
-            mark = mark->Prev();
-        }
-        return mark;
+    // last mark before position, then search backward for type
+    for (int pos = LowerBound(position) - 1; pos >= 0; pos--) {
+        if ((type == 0xFF) || ((sorted[pos]->type & mask) == type)) return sorted[pos];
     }
+    return nullptr;
 }
 
 
 cMark *cMarks::GetNext(const int position, const int type, const int mask) {
-    if (!first) return nullptr; // no elements yet
-    cMark *mark = first;
-    while (mark) {
-        if (type == 0xFF) {
-            if (mark->position > position) break;
-        }
-        else {
-            if ((mark->position > position) && ((mark->type & mask) == type)) break;
-        }
-        mark = mark->Next();
+    // first mark after position, then search forward for type
+    for (int pos = UpperBound(position); pos < static_cast<int>(sorted.size()); pos++) {
+        if ((type == 0xFF) || ((sorted[pos]->type & mask) == type)) return sorted[pos];
     }
-    if (mark) return mark;
     return nullptr;
 }
 
@@ -478,68 +458,20 @@ cMark *cMarks::Add(const int type, const int oldType, const int newType, int pos
         return dupMark;
     }
 
-    cMark *newMark = new cMark(type, oldType, newType, position, framePTS, comment, inBroadCast);
+    cMark *newMark = NewMark(type, oldType, newType, position, framePTS, comment, inBroadCast);
     if (!newMark) return nullptr;
-    ALLOC(sizeof(*newMark), "mark");
 
-    if (!first) {
-        //first element
-        first = last = newMark;
-        count++;
-        return newMark;
-    }
-    else {
-        cMark *mark = first;
-        while (mark) {
-            if (!mark->Next()) {
-                if (position > mark->position) {
-                    // add as last element
-                    newMark->Set(mark, nullptr);
-                    mark->SetNext(newMark);
-                    last = newMark;
-                    break;
-                }
-                else {
-                    // add before
-                    if (!mark->Prev()) {
-                        // add as first element
-                        newMark->Set(nullptr, mark);
-                        mark->SetPrev(newMark);
-                        first = newMark;
-                        break;
-                    }
-                    else {
-                        newMark->Set(mark->Prev(), mark);
-                        mark->SetPrev(newMark);
-                        break;
-                    }
-                }
-            }
-            else {
-                if ((position > mark->position) && (position < mark->Next()->position)) {
-                    // add between two marks
-                    newMark->Set(mark, mark->Next());
-                    mark->SetNext(newMark);
-                    newMark->Next()->SetPrev(newMark);
-                    break;
-                }
-                else {
-                    if ((position < mark->position) && (mark == first)) {
-                        // add as first mark
-                        first = newMark;
-                        mark->SetPrev(newMark);
-                        newMark->SetNext(mark);
-                        break;
-                    }
-                }
-            }
-            mark = mark->Next();
-        }
-        if (!mark) return nullptr;
-        count++;
-        return newMark;
-    }
-    return nullptr;
+    // insert into position sorted array, there is no mark at this position, and link with neighbour marks
+    int pos = LowerBound(position);
+    cMark *prevMark = (pos > 0) ? sorted[pos - 1] : nullptr;
+    cMark *nextMark = (pos < static_cast<int>(sorted.size())) ? sorted[pos] : nullptr;
+    sorted.insert(sorted.begin() + pos, newMark);
+    newMark->Set(prevMark, nextMark);
+    if (prevMark) prevMark->SetNext(newMark);
+    else first = newMark;
+    if (nextMark) nextMark->SetPrev(newMark);
+    else last = newMark;
+    return newMark;
 }
 
 
@@ -830,6 +762,34 @@ char *cMarks::GetTime(cMark *mark) {
 }
 
 
+void cMarks::WriteState(FILE *file, const char *listName) {
+    if (!file)     return;
+    if (!listName) return;
+    for (cMark *mark = first; mark; mark = mark->Next()) {
+        fprintf(file, "mark %s %d %d %d %d %" PRId64 " %d %s\n", listName, mark->type, mark->oldType, mark->newType, mark->position, mark->pts, mark->inBroadCast, (mark->comment) ? mark->comment : "");
+    }
+}
+
+
+bool cMarks::ReadState(const char *line) {
+    if (!line) return false;
+    int type          = MT_UNDEFINED;
+    int oldType       = MT_UNDEFINED;
+    int newType       = MT_UNDEFINED;
+    int position      = -1;
+    int64_t pts       = -1;
+    int inBroadCast   = 0;
+    int commentOffset = 0;
+    if (sscanf(line, "%d %d %d %d %" SCNd64 " %d %n", &type, &oldType, &newType, &position, &pts, &inBroadCast, &commentOffset) < 6) {
+        esyslog("cMarks::ReadState(): invalid line <%s>", line);
+        return false;
+    }
+    const char *comment = (commentOffset > 0) ? line + commentOffset : "";
+    Add(type, oldType, newType, position, pts, (comment[0] != 0) ? comment : nullptr, inBroadCast);
+    return true;
+}
+
+
 bool cMarks::Backup(const char *directory) {
     char *fpath = nullptr;
     if (asprintf(&fpath, "%s/%s", directory, filename) == -1) return false;
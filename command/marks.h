@@ -8,13 +8,18 @@
 #ifndef __marks_h_
 #define __marks_h_
 
+#include <stdio.h>
 #include <string.h>
+#include <vector>
 #include "global.h"
 #include "tools.h"
 #include "decoder.h"
 #include "index.h"
 
 
+#define MARKS_POOL_CHUNK 256   // count of marks allocated at once by mark pool
+
+
 /**
  * class for a single mark
  */
@@ -357,6 +362,20 @@ public:
      */
     bool Backup(const char *directory);
 
+    /**
+     * write all marks to checkpoint file
+     * @param file     checkpoint file
+     * @param listName name of the mark list, used to assign marks to list during restore
+     */
+    void WriteState(FILE *file, const char *listName);
+
+    /**
+     * add mark from checkpoint file line
+     * @param line line from checkpoint file, written by WriteState(), without list name
+     * @return true if successful, false otherwise
+     */
+    bool ReadState(const char *line);
+
 
     /**
      * calculates the difference in seconds between two timestamps
@@ -392,6 +411,49 @@ public:
     static char *TypeToText(const int type);
 
 private:
+    /**
+     * copy marks object (not used)
+     */
+    cMarks(const cMarks &origin);
+
+    /**
+     * = operator for marks object (not used)
+     */
+    cMarks &operator=(const cMarks &origin);
+
+    /**
+     * get index of first mark in position sorted array with position greater or equal
+     * @param position frame position
+     * @return index in position sorted array, count of marks if there is no such mark
+     */
+    int LowerBound(const int position) const;
+
+    /**
+     * get index of first mark in position sorted array with position greater
+     * @param position frame position
+     * @return index in position sorted array, count of marks if there is no such mark
+     */
+    int UpperBound(const int position) const;
+
+    /**
+     * construct new mark in memory from mark pool
+     * @param type         mark type
+     * @param oldType      original mark type before move
+     * @param newType      new mark type after move
+     * @param position     mark position
+     * @param framePTS     PTS of decoded frame
+     * @param comment      mark comment
+     * @param inBroadCast  true if mark is in broacast, false if mark is in advertising
+     * @return pointer to new mark, nullptr on error
+     */
+    cMark *NewMark(const int type, const int oldType, const int newType, const int position, const int64_t framePTS, const char *comment, const bool inBroadCast);
+
+    /**
+     * destruct mark and give memory back to mark pool
+     * @param mark mark to destruct
+     */
+    void DeleteMark(cMark *mark);
+
 
     cIndex *index        = nullptr;  //!< recording index
     //!<
@@ -403,7 +465,11 @@ private:
     //!<
     cMark *last          = nullptr;  //!< pointer to last mark
     //!<
-    int count            = 0;        //!< number of current marks
+    std::vector<cMark *> sorted;     //!< all marks sorted by position, used for binary search
+    //!<
+    std::vector<char *> poolChunks;  //!< memory chunks of mark pool, each chunk holds MARKS_POOL_CHUNK marks
+    //!<
+    std::vector<void *> poolFree;    //!< unused mark memory from mark pool
     //!<
 };
 #endif
@@ -0,0 +1,65 @@
+/*
+ * memorybudget.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <sys/resource.h>
+#include <inttypes.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "memorybudget.h"
+
+
+std::atomic<int64_t> cMemoryBudget::limit(0);
+std::atomic<int64_t> cMemoryBudget::used(0);
+std::atomic<int64_t> cMemoryBudget::peak(0);
+std::atomic<bool> cMemoryBudget::reached(false);
+
+
+void cMemoryBudget::SetLimit(const int64_t bytes) {
+    limit = (bytes > 0) ? bytes : 0;
+}
+
+
+bool cMemoryBudget::Reserve(const int64_t bytes, const char *user) {
+    if (bytes <= 0) return true;
+    int64_t current = used.load();
+    int64_t next    = 0;
+    do {  // reservations from parallel segment threads
+        next = current + bytes;
+        if ((limit > 0) && (next > limit)) {
+            if (!reached.exchange(true)) isyslog("memory budget of %" PRId64 "MB reached by %s, reduce memory usage", limit.load() / 1024 / 1024, user ? user : "unknown");
+            return false;
+        }
+    } while (!used.compare_exchange_weak(current, next));
+
+    int64_t currentPeak = peak.load();
+    while ((next > currentPeak) && !peak.compare_exchange_weak(currentPeak, next)) {}
+    return true;
+}
+
+
+void cMemoryBudget::Release(const int64_t bytes) {
+    if (bytes <= 0) return;
+    used -= bytes;
+}
+
+
+bool cMemoryBudget::IsTight() {
+    if (limit <= 0) return false;
+    return (used > (limit / 4 * 3));
+}
+
+
+long int cMemoryBudget::GetPeakRSS() {
+#ifdef POSIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;  // Linux reports KB
+#endif
+    return -1;
+}
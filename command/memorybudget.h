@@ -0,0 +1,83 @@
+/*
+ * memorybudget.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __memorybudget_h_
+#define __memorybudget_h_
+
+#include <atomic>
+
+#include "global.h"
+#include "debug.h"
+
+
+/**
+ * process wide accountant of the big buffers of mark detection <br>
+ * subsystems reserve memory before they grow and shrink their work if the budget of --max-memory is reached,
+ * without a budget all reservations succeed and are only counted for statistics
+ */
+class cMemoryBudget {
+public:
+
+    /**
+     * set budget, has to be called before any reservation
+     * @param bytes max bytes of all reservations, 0 for no limit
+     */
+    static void SetLimit(const int64_t bytes);
+
+    /**
+     * get budget
+     * @return max bytes of all reservations, 0 for no limit
+     */
+    static int64_t GetLimit() {
+        return limit;
+    }
+
+    /**
+     * reserve memory before allocation
+     * @param bytes size of allocation
+     * @param user  name of subsystem, logged if budget is reached the first time
+     * @return true if reserved, false if budget would be exceeded, in this case nothing is reserved
+     */
+    static bool Reserve(const int64_t bytes, const char *user);
+
+    /**
+     * release reserved memory after free
+     * @param bytes size of allocation
+     */
+    static void Release(const int64_t bytes);
+
+    /**
+     * check if most of the budget is used, subsystems with optional buffers should reduce them
+     * @return true if more than 3/4 of budget is reserved, false otherwise or without budget
+     */
+    static bool IsTight();
+
+    /**
+     * get peak of reserved memory
+     * @return max bytes reserved at the same time
+     */
+    static int64_t GetPeak() {
+        return peak;
+    }
+
+    /**
+     * get peak resident set size of process
+     * @return peak RSS in KB, -1 if not available
+     */
+    static long int GetPeakRSS();
+
+private:
+    static std::atomic<int64_t> limit;      //!< budget in bytes, 0 for no limit
+    //!<
+    static std::atomic<int64_t> used;       //!< reserved bytes
+    //!<
+    static std::atomic<int64_t> peak;       //!< max reserved bytes
+    //!<
+    static std::atomic<bool> reached;       //!< true if a reservation was refused
+    //!<
+};
+#endif
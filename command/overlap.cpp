@@ -7,6 +7,8 @@
 
 #include "overlap.h"
 #include "debug.h"
+#include "memorybudget.h"
+#include "trace.h"
 
 // global variable
 extern bool abortNow;
@@ -14,8 +16,8 @@ extern bool abortNow;
 
 // --------------------------------------------------------------------------------------------------------------------------------
 cOverlap::cOverlap(cDecoder *decoderParam, cIndex *indexParam) {
-    decoder   = decoderParam;
-    index     = indexParam;
+    decoder = decoderParam;
+    index   = indexParam;
 }
 
 
@@ -35,128 +37,191 @@ bool cOverlap::DetectOverlap(cMarks *marksParam) {
         return false;
     }
 
-    if (!decoder->Restart()) return false;
-
-    bool save = false;
-    cMark *p1 = nullptr;
-    cMark *p2 = nullptr;
+    if (!decoder->Restart()) return false;   // main decoder is not used for detection, but following steps expect decoder at start
+    int frameRate = decoder->GetVideoFrameRate();
+    if (frameRate <= 0) {
+        esyslog("cOverlap::DetectOverlap(): invalid video frame rate %d", frameRate);
+        return false;
+    }
 
-    // start around first ad (2. and 3. mark)
-    p1 = marks->GetFirst();
+    // collect stop/start pairs around each ad (2. and 3. mark, 4. and 5. mark, ...)
+    jobs.clear();
+    nextJob = 0;
+    cMark *p1 = marks->GetFirst();
     if (!p1) return false;
     p1 = p1->Next();
+    cMark *p2 = nullptr;
     if (p1) p2 = p1->Next();
-
     while ((p1) && (p2)) {
-        if (abortNow) return false;
-        if (decoder) {
-            LogSeparator(false);
-            dsyslog("cOverlap::DetectOverlap(): check overlap before stop mark (%d) and after start mark (%d)", p1->position, p2->position);
-
-            // init overlap detection around ad
-            cOverlapAroundAd *overlapAroundAd = new cOverlapAroundAd(decoder);
-            ALLOC(sizeof(*overlapAroundAd), "overlapAroundAd");
-
-            // detect overlap before stop and after start
-            if (!ProcessMarksOverlap(overlapAroundAd, &p1, &p2)) {
-                if (p1 && p2) dsyslog("cOverlap::DetectOverlap(): no overlap found before stop mark (%d) and after start (%d)", p1->position, p2->position);
-                else esyslog("cOverlap::DetectOverlap(): marks invalid after ProcessMarksOverlap()");
-            }
-            else save = true;
-
-            // free overlap detection object
-            FREE(sizeof(*overlapAroundAd), "overlapAroundAd");
-            delete overlapAroundAd;
-        }
-        if (!p1 || !p2) break;  // failed move will return nullptr pointer
+        sOverlapJob job;
+        job.stopPosition  = p1->position;
+        job.startPosition = p2->position;
+        job.frameRate     = frameRate;
+        jobs.push_back(job);
         p1 = p2->Next();
-        if (p1) {
-            p2 = p1->Next();
+        if (p1) p2 = p1->Next();
+        else p2 = nullptr;
+    }
+    if (jobs.empty()) return false;
+
+    // ads are independent, detect overlaps in parallel, each thread uses its own decoder
+    long int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int decoderThreads = decoder->GetThreads();
+    if (decoderThreads < 1) decoderThreads = 1;
+    int threadCount = cpus / decoderThreads;
+    if (threadCount > OVERLAP_MAX_THREADS) threadCount = OVERLAP_MAX_THREADS;
+    if (threadCount > static_cast<int>(jobs.size())) threadCount = jobs.size();
+    char *hwaccel = decoder->GetHWaccelName();
+    bool useMainDecoder = false;
+    if (hwaccel && (hwaccel[0] != 0)) {   // hardware decoder sessions are limited, do not open a second one
+        threadCount    = 1;
+        useMainDecoder = true;
+    }
+    if (threadCount < 1) threadCount = 1;
+    dsyslog("cOverlap::DetectOverlap(): %zu ads to check with %d thread(s), %ld CPUs, %d decoder threads", jobs.size(), threadCount, cpus, decoderThreads);
+
+    pthread_t workerThread[OVERLAP_MAX_THREADS] = {};
+    int running = 0;
+    for (int i = 1; i < threadCount; i++) {   // main thread is first worker
+        if (pthread_create(&workerThread[running], nullptr, WorkerThread, this) != 0) {
+            esyslog("cOverlap::DetectOverlap(): failed to create worker thread %d", i);
+            break;
+        }
+        running++;
+    }
+    Worker(useMainDecoder);
+    for (int i = 0; i < running; i++) pthread_join(workerThread[i], nullptr);
+    if (abortNow) return false;
+    if (useMainDecoder && !decoder->Restart()) return false;   // following steps expect decoder at start
+
+    // merge results in order of ads
+    bool save = false;
+    for (std::vector<sOverlapJob>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+        LogSeparator(false);
+        cMark *stopMark  = marks->Get(job->stopPosition);   // lookup by position, moved marks are new objects
+        cMark *startMark = marks->Get(job->startPosition);
+        if (!job->done) {
+            dsyslog("cOverlap::DetectOverlap(): overlap detection failed before stop mark (%d) and after start (%d)", job->stopPosition, job->startPosition);
+            continue;
         }
-        else {
-            p2 = nullptr;
+        if (!ProcessMarksOverlap(&(*job), &stopMark, &startMark)) {
+            if (stopMark && startMark) dsyslog("cOverlap::DetectOverlap(): no overlap found before stop mark (%d) and after start (%d)", job->stopPosition, job->startPosition);
+            else esyslog("cOverlap::DetectOverlap(): marks invalid after ProcessMarksOverlap()");
         }
+        else save = true;
     }
+    jobs.clear();
     return save;
 }
 
 
-bool cOverlap::ProcessMarksOverlap(cOverlapAroundAd *overlapAroundAd, cMark **mark1, cMark **mark2) {
-    if (!decoder)   return false;
-    if (!index)     return false;
-    if (!marks)     return false;
-    if (!mark1)     return false;
-    if (!(*mark1))  return false;
-    if (!mark2)     return false;
-    if (!(*mark2))  return false;
+void *cOverlap::WorkerThread(void *overlap) {
+    static_cast<cOverlap *>(overlap)->Worker(false);
+    return nullptr;
+}
 
-    sOverlapPos overlapPos;
-    overlapPos.similarBeforeStartPacketNumber = -1;
-    overlapPos.similarBeforeEndPacketNumber   = -1;
-    overlapPos.similarAfterStartPacketNumber  = -1;
-    overlapPos.similarAfterEndPacketNumber    = -1;
 
-    int frameRate = decoder->GetVideoFrameRate();
+void cOverlap::Worker(const bool useMainDecoder) {
+    cIndex   *indexWorker   = index;
+    cDecoder *decoderWorker = decoder;
+    if (!useMainDecoder) {
+        // own index copy, decoder adds PTS and slice infos of decoded frames
+        indexWorker = new cIndex(*index);
+        ALLOC(sizeof(*indexWorker), "indexWorker");
+        decoderWorker = new cDecoder(decoder->GetRecordingDir(), decoder->GetThreads(), decoder->GetFullDecode(), decoder->GetHWaccelName(), decoder->GetForceHWaccel(), decoder->GetForceInterlaced(), indexWorker);
+        ALLOC(sizeof(*decoderWorker), "decoderWorker");
+    }
+    decoderWorker->SetByteSeek(true);   // index is complete, jump direct to range before stop mark
+
+    while (!abortNow) {
+        // get next ad, each thread gets ads in ascending order, so decoder only seeks forward
+        pthread_mutex_lock(&mutex);
+        unsigned int jobIndex = nextJob++;
+        pthread_mutex_unlock(&mutex);
+        if (jobIndex >= jobs.size()) break;
+        jobs[jobIndex].done = DetectAroundAd(decoderWorker, indexWorker, &jobs[jobIndex]);
+    }
+
+    if (useMainDecoder) {
+        decoderWorker->SetByteSeek(false);
+        return;
+    }
+    FREE(sizeof(*decoderWorker), "decoderWorker");
+    delete decoderWorker;
+    FREE(sizeof(*indexWorker), "indexWorker");
+    delete indexWorker;
+}
+
+
+bool cOverlap::DetectAroundAd(cDecoder *decoderWorker, cIndex *indexWorker, sOverlapJob *job) {
+    if (!decoderWorker) return false;
+    if (!indexWorker)   return false;
+    if (!job)           return false;
+
+    dsyslog("cOverlap::DetectAroundAd(): check overlap before stop mark (%d) and after start mark (%d)", job->stopPosition, job->startPosition);
+    cOverlapAroundAd overlapAroundAd(decoderWorker);
+
+    int frameRate = job->frameRate;
 
 // max overlap found: 94200ms (TELE 5)
 #define OVERLAP_CHECK_BEFORE 100  // start before stop mark, changed from 90 to 100
 #define OVERLAP_CHECK_AFTER  100  // end after start mark,   changed from 90 to 100
 
     // calculate overlap check positions
-    int fRangeBegin = (*mark1)->position - (frameRate * OVERLAP_CHECK_BEFORE);
+    int fRangeBegin = job->stopPosition - (frameRate * OVERLAP_CHECK_BEFORE);
     if (fRangeBegin < 0) fRangeBegin = 0;                    // not before beginning of broadcast
-    fRangeBegin = index->GetKeyPacketNumberAfter(fRangeBegin);
+    fRangeBegin = indexWorker->GetKeyPacketNumberAfter(fRangeBegin);
     if (fRangeBegin < 0) {
-        esyslog("cOverlap::ProcessMarksOverlap(): GetKeyPacketNumberAfter() failed for frame (%d)", fRangeBegin);
+        esyslog("cOverlap::DetectAroundAd(): GetKeyPacketNumberAfter() failed for frame (%d)", fRangeBegin);
         return false;
     }
-    int fRangeEnd = (*mark2)->position + (frameRate * OVERLAP_CHECK_AFTER);
-    fRangeEnd = index->GetKeyPacketNumberBefore(fRangeEnd);
+    int fRangeEnd = job->startPosition + (frameRate * OVERLAP_CHECK_AFTER);
+    fRangeEnd = indexWorker->GetKeyPacketNumberBefore(fRangeEnd);
     if (fRangeEnd < 0) {
-        esyslog("cOverlap::ProcessMarksOverlap(): GetKeyPacketNumberBefore() failed for frame (%d)", fRangeEnd);
+        esyslog("cOverlap::DetectAroundAd(): GetKeyPacketNumberBefore() failed for frame (%d)", fRangeEnd);
         return false;
     }
 
     // check if search range is possible
-    if (decoder->GetPacketNumber() > fRangeBegin) {
-        dsyslog("cOverlap::ProcessMarksOverlap(): current framenumber (%d) greater then start frame (%d), set start to current frame", decoder->GetPacketNumber(), fRangeBegin);
-        fRangeBegin =  decoder->GetPacketNumber();
+    if (decoderWorker->GetPacketNumber() > fRangeBegin) {
+        dsyslog("cOverlap::DetectAroundAd(): current framenumber (%d) greater then start frame (%d), set start to current frame", decoderWorker->GetPacketNumber(), fRangeBegin);
+        fRangeBegin =  decoderWorker->GetPacketNumber();
     }
 
     // seek to start frame of overlap check
     char *indexToHMSF = marks->IndexToHMSF(fRangeBegin, AV_NOPTS_VALUE, false);
     if (indexToHMSF) {
         ALLOC(strlen(indexToHMSF)+1, "indexToHMSF");
-        dsyslog("cOverlap::ProcessMarksOverlap(): start check %ds before start mark (%d) from frame (%d) at %s", OVERLAP_CHECK_BEFORE, (*mark1)->position, fRangeBegin, indexToHMSF);
+        dsyslog("cOverlap::DetectAroundAd(): start check %ds before start mark (%d) from frame (%d) at %s", OVERLAP_CHECK_BEFORE, job->stopPosition, fRangeBegin, indexToHMSF);
         FREE(strlen(indexToHMSF)+1, "indexToHMSF");
         free(indexToHMSF);
     }
-    dsyslog("cOverlap::ProcessMarksOverlap(): preload from frame       (%5d) to (%5d)", fRangeBegin, (*mark1)->position);
-    dsyslog("cOverlap::ProcessMarksOverlap(): compare with frames from (%5d) to (%5d)", (*mark2)->position, fRangeEnd);
-    if (decoder->GetPacketNumber() > fRangeBegin) {
-        dsyslog("cOverlap::ProcessMarksOverlap(): current framenumber (%d) greater then start frame (%d), set start to current frame", decoder->GetPacketNumber(), fRangeBegin);
-        fRangeBegin =  decoder->GetPacketNumber();
+    dsyslog("cOverlap::DetectAroundAd(): preload from frame       (%5d) to (%5d)", fRangeBegin, job->stopPosition);
+    dsyslog("cOverlap::DetectAroundAd(): compare with frames from (%5d) to (%5d)", job->startPosition, fRangeEnd);
+    if (decoderWorker->GetPacketNumber() > fRangeBegin) {
+        dsyslog("cOverlap::DetectAroundAd(): current framenumber (%d) greater then start frame (%d), set start to current frame", decoderWorker->GetPacketNumber(), fRangeBegin);
+        fRangeBegin =  decoderWorker->GetPacketNumber();
     }
 
     // seek to start frame
-    if (!decoder->SeekToPacket(fRangeBegin)) {
+    if (!decoderWorker->SeekToPacket(fRangeBegin)) {
         esyslog("could not seek to frame (%i)", fRangeBegin);
         return false;
     }
 
     // get frame count of range before stop mark to check for overlap
     int frameCount;
-    if (decoder->GetFullDecode()) frameCount = (*mark1)->position - fRangeBegin + 1;
-    else frameCount = index->GetIFrameRangeCount(fRangeBegin, (*mark1)->position);
+    if (decoderWorker->GetFullDecode()) frameCount = job->stopPosition - fRangeBegin + 1;
+    else frameCount = indexWorker->GetIFrameRangeCount(fRangeBegin, job->stopPosition);
     if (frameCount < 0) {
-        dsyslog("cOverlap::ProcessMarksOverlap(): GetIFrameRangeCount failed at range (%d,%d))", fRangeBegin, (*mark1)->position);
+        dsyslog("cOverlap::DetectAroundAd(): GetIFrameRangeCount failed at range (%d,%d))", fRangeBegin, job->stopPosition);
         return false;
     }
-    dsyslog("cOverlap::ProcessMarksOverlap(): %d frames to preload between start of check (%d) and stop mark (%d)", frameCount, fRangeBegin, (*mark1)->position);
+    dsyslog("cOverlap::DetectAroundAd(): %d frames to preload between start of check (%d) and stop mark (%d)", frameCount, fRangeBegin, job->stopPosition);
 
 
     // preload frames before stop mark
-    while (decoder->DecodeNextFrame(false) && (decoder->GetPacketNumber() <= (*mark1)->position)) {  // no audio
+    while (decoderWorker->DecodeNextFrame(false) && (decoderWorker->GetPacketNumber() <= job->stopPosition)) {  // no audio
         if (abortNow) return false;
 
 #ifdef DEBUG_OVERLAP
@@ -164,43 +229,43 @@ bool cOverlap::ProcessMarksOverlap(cOverlapAroundAd *overlapAroundAd, cMark **ma
 #endif
 
 #ifdef DEBUG_OVERLAP_FRAME_RANGE
-        if ((decoder->GetPacketNumber() > (DEBUG_OVERLAP_FRAME_BEFORE - DEBUG_OVERLAP_FRAME_RANGE)) &&
-                (decoder->GetPacketNumber() < (DEBUG_OVERLAP_FRAME_BEFORE + DEBUG_OVERLAP_FRAME_RANGE))) SaveFrame(decoder->GetPacketNumber(), nullptr, nullptr);
+        if ((decoderWorker->GetPacketNumber() > (DEBUG_OVERLAP_FRAME_BEFORE - DEBUG_OVERLAP_FRAME_RANGE)) &&
+                (decoderWorker->GetPacketNumber() < (DEBUG_OVERLAP_FRAME_BEFORE + DEBUG_OVERLAP_FRAME_RANGE))) SaveFrame(decoderWorker->GetPacketNumber(), nullptr, nullptr);
 #endif
-        const sVideoPicture *picture = decoder->GetVideoPicture();
+        const sVideoPicture *picture = decoderWorker->GetVideoPicture();
         if (!picture) continue;
-        overlapAroundAd->Process(picture, frameCount, true, (decoder->GetVideoType() == MARKAD_PIDTYPE_VIDEO_H264));
+        overlapAroundAd.Process(picture, frameCount, true, (decoderWorker->GetVideoType() == MARKAD_PIDTYPE_VIDEO_H264));
     }
 
     // seek to iFrame before start mark
-    fRangeBegin = index->GetKeyPacketNumberBefore((*mark2)->position);
+    fRangeBegin = indexWorker->GetKeyPacketNumberBefore(job->startPosition);
     if (fRangeBegin <= 0) {
-        dsyslog("cOverlap::ProcessMarksOverlap(): GetKeyPacketNumberBefore failed for frame (%d)", fRangeBegin);
+        dsyslog("cOverlap::DetectAroundAd(): GetKeyPacketNumberBefore failed for frame (%d)", fRangeBegin);
         return false;
     }
-    if (fRangeBegin <  decoder->GetPacketNumber()) fRangeBegin = decoder->GetPacketNumber(); // on very short stop/start pairs we have no room to go before start mark
+    if (fRangeBegin <  decoderWorker->GetPacketNumber()) fRangeBegin = decoderWorker->GetPacketNumber(); // on very short stop/start pairs we have no room to go before start mark
     indexToHMSF = marks->IndexToHMSF(fRangeBegin, AV_NOPTS_VALUE, false);
     if (indexToHMSF) {
         ALLOC(strlen(indexToHMSF)+1, "indexToHMSF");
-        dsyslog("cOverlap::ProcessMarksOverlap(): seek forward to frame (%d) at %s before start mark (%d) and start overlap check", fRangeBegin, indexToHMSF, (*mark2)->position);
+        dsyslog("cOverlap::DetectAroundAd(): seek forward to frame (%d) at %s before start mark (%d) and start overlap check", fRangeBegin, indexToHMSF, job->startPosition);
         FREE(strlen(indexToHMSF)+1, "indexToHMSF");
         free(indexToHMSF);
     }
-    if (!decoder->SeekToPacket(fRangeBegin)) {
+    if (!decoderWorker->SeekToPacket(fRangeBegin)) {
         esyslog("could not seek to frame (%d)", fRangeBegin);
         return false;
     }
 
-    if (decoder->GetFullDecode()) frameCount = fRangeEnd - fRangeBegin + 1;
-    else frameCount = index->GetIFrameRangeCount(fRangeBegin, fRangeEnd) - 2;
+    if (decoderWorker->GetFullDecode()) frameCount = fRangeEnd - fRangeBegin + 1;
+    else frameCount = indexWorker->GetIFrameRangeCount(fRangeBegin, fRangeEnd) - 2;
     if (frameCount < 0) {
-        dsyslog("cOverlap::ProcessMarksOverlap(): GetIFrameRangeCount failed at range (%d,%d))", fRangeBegin, (*mark1)->position);
+        dsyslog("cOverlap::DetectAroundAd(): GetIFrameRangeCount failed at range (%d,%d))", fRangeBegin, job->stopPosition);
         return false;
     }
-    dsyslog("cOverlap::ProcessMarksOverlap(): %d frames to preload between start mark (%d) and  end of check (%d)", frameCount, (*mark2)->position, fRangeEnd);
+    dsyslog("cOverlap::DetectAroundAd(): %d frames to preload between start mark (%d) and  end of check (%d)", frameCount, job->startPosition, fRangeEnd);
 
     // process frames after start mark and detect overlap
-    while (decoder->DecodeNextFrame(false) && (decoder->GetPacketNumber() <= fRangeEnd)) {
+    while (decoderWorker->DecodeNextFrame(false) && (decoderWorker->GetPacketNumber() <= fRangeEnd)) {
         if (abortNow) return false;
 
 #ifdef DEBUG_OVERLAP
@@ -208,19 +273,34 @@ bool cOverlap::ProcessMarksOverlap(cOverlapAroundAd *overlapAroundAd, cMark **ma
 #endif
 
 #ifdef DEBUG_OVERLAP_FRAME_RANGE
-        if ((decoder->GetPacketNumber() > (DEBUG_OVERLAP_FRAME_AFTER - DEBUG_OVERLAP_FRAME_RANGE)) &&
-                (decoder->GetPacketNumber() < (DEBUG_OVERLAP_FRAME_AFTER + DEBUG_OVERLAP_FRAME_RANGE))) SaveFrame(decoder->GetPacketNumber(), nullptr, nullptr);
+        if ((decoderWorker->GetPacketNumber() > (DEBUG_OVERLAP_FRAME_AFTER - DEBUG_OVERLAP_FRAME_RANGE)) &&
+                (decoderWorker->GetPacketNumber() < (DEBUG_OVERLAP_FRAME_AFTER + DEBUG_OVERLAP_FRAME_RANGE))) SaveFrame(decoderWorker->GetPacketNumber(), nullptr, nullptr);
 #endif
 
-        const sVideoPicture *picture = decoder->GetVideoPicture();
+        const sVideoPicture *picture = decoderWorker->GetVideoPicture();
         if (!picture) continue;
-        overlapAroundAd->Process(picture, frameCount, false, (decoder->GetVideoType() == MARKAD_PIDTYPE_VIDEO_H264));
+        overlapAroundAd.Process(picture, frameCount, false, (decoderWorker->GetVideoType() == MARKAD_PIDTYPE_VIDEO_H264));
     }
 
-    dsyslog("cOverlapAroundAd::ProcessMarksOverlap(): start compare frames");
-    overlapAroundAd->Detect(&overlapPos);
+    dsyslog("cOverlap::DetectAroundAd(): stop mark (%d), start mark (%d): start compare frames", job->stopPosition, job->startPosition);
+    overlapAroundAd.Detect(&job->overlapPos);
+    return true;
+}
+
+
+bool cOverlap::ProcessMarksOverlap(sOverlapJob *job, cMark **mark1, cMark **mark2) {
+    if (!decoder)   return false;
+    if (!marks)     return false;
+    if (!job)       return false;
+    if (!mark1)     return false;
+    if (!(*mark1))  return false;
+    if (!mark2)     return false;
+    if (!(*mark2))  return false;
+
+    const sOverlapPos overlapPos = job->overlapPos;
+    int frameRate = decoder->GetVideoFrameRate();
 #ifdef DEBUG_OVERLAP
-    dsyslog("cOverlapAroundAd::ProcessMarksOverlap(): overlap from (%d) before stop mark and (%d) after start mark", overlapPos.similarBeforeEndPacketNumber, overlapPos.similarAfterEndPacketNumber);
+    dsyslog("cOverlap::ProcessMarksOverlap(): overlap from (%d) before stop mark and (%d) after start mark", overlapPos.similarBeforeEndPacketNumber, overlapPos.similarAfterEndPacketNumber);
 #endif
     if (overlapPos.similarAfterEndPacketNumber >= 0) {
         // found overlap
@@ -327,18 +407,21 @@ cOverlapAroundAd::~cOverlapAroundAd() {
 #endif
     if (histbuf[OV_BEFORE]) {
         FREE(sizeof(*histbuf[OV_BEFORE]), "histbuf");
+        cMemoryBudget::Release(sizeof(sHistBuffer) * (histframes[OV_BEFORE] + 1));
         delete[] histbuf[OV_BEFORE];
         histbuf[OV_BEFORE] = nullptr;
     }
 
     if (histbuf[OV_AFTER]) {
         FREE(sizeof(*histbuf[OV_AFTER]), "histbuf");
+        cMemoryBudget::Release(sizeof(sHistBuffer) * (histframes[OV_AFTER] + 1));
         delete[] histbuf[OV_AFTER];
         histbuf[OV_AFTER] = nullptr;
     }
 }
 
 void cOverlapAroundAd::Process(const sVideoPicture *picture, const int frameCount, const bool beforeAd, const bool h264) {
+    cTraceSpan trace("OverlapHistogram", "overlap");
 #ifdef DEBUG_OVERLAP
     dsyslog("cOverlapAroundAd::Process(): frameNumber %d, frameCount %d, beforeAd %d, isH264 %d",  picture->packetNumber, frameCount, beforeAd, h264);
 #endif
@@ -346,7 +429,7 @@ void cOverlapAroundAd::Process(const sVideoPicture *picture, const int frameCoun
     if ((lastFrameNumber > 0) && (similarMinLength == 0)) {
         // lower is harder, do not increase, we will get false positive
         if (decoder->GetVideoWidth() <= 720) similarCutOff = 49000;   // SD Video
-        else similarCutOff = 196000;                                  // HD Viedeo
+        else similarCutOff = 196000;                                  // HD Video
         similarMinLength = 4040;                                      // shortest valid length of an overlap with 4040ms found
     }
 
@@ -356,7 +439,12 @@ void cOverlapAroundAd::Process(const sVideoPicture *picture, const int frameCoun
 #endif
         // alloc memory for frames before stop mark
         if (!histbuf[OV_BEFORE]) {
+            if (histframes[OV_BEFORE] > 0) return;   // memory budget reached, no overlap detection around this ad
             histframes[OV_BEFORE] = frameCount;
+            if (!cMemoryBudget::Reserve(sizeof(sHistBuffer) * (frameCount + 1), "overlap detection")) {
+                dsyslog("cOverlapAroundAd::Process(): frame (%d): memory budget reached, skip histograms before stop mark", picture->packetNumber);
+                return;
+            }
             histbuf[OV_BEFORE] = new sHistBuffer[frameCount + 1];
             ALLOC(sizeof(*histbuf[OV_BEFORE]), "histbuf");
         }
@@ -377,12 +465,17 @@ void cOverlapAroundAd::Process(const sVideoPicture *picture, const int frameCoun
 #endif
         // alloc memory for frames after start mark
         if (!histbuf[OV_AFTER]) {
+            if (histframes[OV_AFTER] > 0) return;   // memory budget reached, no overlap detection around this ad
             histframes[OV_AFTER] = frameCount;
+            if (!cMemoryBudget::Reserve(sizeof(sHistBuffer) * (frameCount + 1), "overlap detection")) {
+                dsyslog("cOverlapAroundAd::Process(): frame (%d): memory budget reached, skip histograms after start mark", picture->packetNumber);
+                return;
+            }
             histbuf[OV_AFTER] = new sHistBuffer[frameCount + 1];
             ALLOC(sizeof(*histbuf[OV_AFTER]), "histbuf");
         }
 
-        // fill histogram for frames before after start mark
+        // fill histogram for frames after start mark
         if (histcnt[OV_AFTER] >= frameCount) {
             dsyslog("cOverlapAroundAd::Process(): got more frames after start mark than expected");
             return;
@@ -400,6 +493,7 @@ void cOverlapAroundAd::Process(const sVideoPicture *picture, const int frameCoun
 
 void cOverlapAroundAd::Detect(sOverlapPos *overlapPos) {
     if (!overlapPos) return;
+    if (!histbuf[OV_BEFORE] || !histbuf[OV_AFTER]) return;
 
     int startAfterMark             =  0;
     int simLength                  =  0;
@@ -8,6 +8,10 @@
 #ifndef __overlap_h_
 #define __overlap_h_
 
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+
 #include "tools.h"
 #include "marks.h"
 #include "decoder.h"
@@ -89,7 +93,7 @@ private:
     //!<
     sHistBuffer *histbuf[2]   = {nullptr};  //!< simple frame histogram with frame number
     //!<
-    int histcnt[2]            = {0};        //!< count of prcessed frame histograms
+    int histcnt[2]            = {0};        //!< count of processed frame histograms
     //!<
     int histframes[2]         = {0};        //!< frame number of histogram buffer content
     //!<
@@ -102,6 +106,26 @@ private:
 };
 
 
+#define OVERLAP_MAX_THREADS 8   // maximum count of parallel overlap detection threads
+
+
+/**
+ * overlap detection job of one ad
+ */
+typedef struct sOverlapJob {
+    int stopPosition         = -1;      //!< position of stop mark before ad
+    //!<
+    int startPosition        = -1;      //!< position of start mark after ad
+    //!<
+    int frameRate            = 0;       //!< video frame rate from main decoder, worker decoder has no file open before first seek
+    //!<
+    sOverlapPos overlapPos;             //!< detected overlap
+    //!<
+    bool done                = false;   //!< true if detection around ad was completed
+    //!<
+} sOverlapJob;
+
+
 /**
  * class to detect overlapping scenes and closing credits in recording
  */
@@ -117,25 +141,53 @@ public:
 
     /**
      * detect overlap
+     * ads are processed in parallel threads, each thread with its own decoder, results are merged in order of ads
      * @param marksParam      current marks
      */
     bool DetectOverlap(cMarks *marksParam);
 
     /**
-     * process overlap detection with stop/start pair
-     * @param[in]      overlapAroundAd detection object
-     * @param[in, out] mark1           stop mark before advertising, set to start position of detected overlap
-     * @param[in, out] mark2           start mark after advertising, set to end position of detected overlap
+     * move marks to detected overlap of stop/start pair
+     * @param[in]      job   overlap detection result of this ad
+     * @param[in, out] mark1 stop mark before advertising, set to start position of detected overlap
+     * @param[in, out] mark2 start mark after advertising, set to end position of detected overlap
      * @return true if overlap was detected, false otherwise
      */
-    bool ProcessMarksOverlap(cOverlapAroundAd *overlapAroundAd, cMark **mark1, cMark **mark2);
+    bool ProcessMarksOverlap(sOverlapJob *job, cMark **mark1, cMark **mark2);
 
 private:
+    /**
+     * overlap worker thread
+     * @param overlap pointer to cOverlap object
+     */
+    static void *WorkerThread(void *overlap);
+
+    /**
+     * process overlap jobs until all jobs are taken
+     * @param useMainDecoder true to use main decoder and index, false to use own decoder and index copy
+     */
+    void Worker(const bool useMainDecoder);
+
+    /**
+     * detect overlap around one ad
+     * @param[in]      decoderWorker decoder of this worker
+     * @param[in]      indexWorker   index of this worker
+     * @param[in, out] job           stop/start pair, set to detected overlap
+     * @return true if detection was completed, false otherwise
+     */
+    bool DetectAroundAd(cDecoder *decoderWorker, cIndex *indexWorker, sOverlapJob *job);
+
     cDecoder *decoder         = nullptr;   //!< decoder
     //!<
     cIndex   *index           = nullptr;   //!< recording index
     //!<
     cMarks   *marks           = nullptr;   //!< marks
     //!<
+    std::vector<sOverlapJob> jobs;         //!< overlap detection job of each ad
+    //!<
+    unsigned int nextJob      = 0;         //!< index of next job to process
+    //!<
+    pthread_mutex_t mutex     = PTHREAD_MUTEX_INITIALIZER;   //!< mutex for next job
+    //!<
 };
 #endif
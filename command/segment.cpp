@@ -0,0 +1,236 @@
+/*
+ * segment.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <algorithm>
+#include <inttypes.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "segment.h"
+#include "video.h"
+#include "audio.h"
+
+// global variable
+extern bool abortNow;
+
+
+cSegments::cSegments(cDecoder *decoderParam, const char *channelNameParam, const int autoLogoParam, const char *logoCacheDirParam, const sAspectRatio aspectRatioParam, const bool fastDecodeParam, const bool forcedFullDecodeParam, const bool forceInterlacedParam) {
+    decoder          = decoderParam;
+    channelName      = channelNameParam;
+    autoLogo         = autoLogoParam;
+    logoCacheDir     = logoCacheDirParam;
+    aspectRatio      = aspectRatioParam;
+    fastDecode       = fastDecodeParam;
+    forcedFullDecode = forcedFullDecodeParam;
+    forceInterlaced  = forceInterlacedParam;
+}
+
+
+cSegments::~cSegments() {
+    for (pthread_t thread : threads) pthread_join(thread, nullptr);
+    threads.clear();
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond);
+}
+
+
+int cSegments::Start(const int startPacket, const int endPacket, const int count, const cCriteria *criteriaParam, const bool reducedPlanesParam) {
+    if (!decoder)       return 0;
+    if (!criteriaParam) return 0;
+    if (count < 2)      return 0;
+    if (!jobs.empty())  return 0;  // already started
+    criteriaParam->GetState(criteriaState, sizeof(criteriaState));
+    reducedPlanes = reducedPlanesParam;
+
+    // first segment from startPacket is detected by main thread
+    int length = (endPacket - startPacket) / count;
+    for (int i = 1; i < count; i++) {
+        sSegmentJob job;
+        job.startPacket = startPacket + (i * length);
+        job.endPacket   = (i == (count - 1)) ? endPacket : (startPacket + ((i + 1) * length));
+        jobs.push_back(job);
+    }
+
+    // each worker thread takes next job, all jobs are in vector before first thread starts
+    for (unsigned int i = 0; i < jobs.size(); i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, WorkerThread, this) != 0) {
+            esyslog("cSegments::Start(): failed to create worker thread for segment (%d) to (%d)", jobs[i].startPacket, jobs[i].endPacket);
+            break;
+        }
+        threads.push_back(thread);
+    }
+    // segments without worker thread are finished, main thread has to detect them
+    pthread_mutex_lock(&mutex);
+    for (unsigned int i = threads.size(); i < jobs.size(); i++) jobs[i].finished = true;
+    pthread_mutex_unlock(&mutex);
+
+    dsyslog("cSegments::Start(): %d segments from packet (%d) to (%d), %zu worker threads started", count, startPacket, endPacket, threads.size());
+    return threads.size();
+}
+
+
+int cSegments::GetNextSegmentStart() const {
+    if (nextSegment >= jobs.size()) return INT_MAX;
+    return jobs[nextSegment].startPacket;
+}
+
+
+const sSegmentJob *cSegments::GetNextSegment(const sDetectorState *chainState, const cCriteria *criteriaParam) {
+    if (!chainState)                  return nullptr;
+    if (!criteriaParam)               return nullptr;
+    if (nextSegment >= jobs.size())   return nullptr;
+    sSegmentJob *job = &jobs[nextSegment++];
+
+    pthread_mutex_lock(&mutex);
+    while (!job->finished) pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+
+    if (!job->done) {
+        dsyslog("cSegments::GetNextSegment(): segment (%d) to (%d): detection not completed", job->startPacket, job->endPacket);
+        return nullptr;
+    }
+    // criteria of detection chain and segment have to be the same as criteria copied to worker
+    char state[CRITERIA_STATE_SIZE] = {0};
+    criteriaParam->GetState(state, sizeof(state));
+    if ((strcmp(state, criteriaState) != 0) || (strcmp(job->criteriaState, criteriaState) != 0)) {
+        dsyslog("cSegments::GetNextSegment(): segment (%d) to (%d): criteria changed", job->startPacket, job->endPacket);
+        return nullptr;
+    }
+    // detector state at segment start has to be the same as at end of detection chain
+    if (!(job->startState == *chainState)) {
+        dsyslog("cSegments::GetNextSegment(): segment (%d) to (%d): detector state at segment start differs", job->startPacket, job->endPacket);
+        dsyslog("cSegments::GetNextSegment(): chain:   logo %d, scene %d, black %d, lower border %d, hborder %d, vborder %d, aspect ratio %d:%d, silence %" PRId64 " %" PRId64 ", reduced planes %d", chainState->logo, chainState->scene, chainState->blackScreen, chainState->lowerBorder, chainState->hBorder, chainState->vBorder, chainState->aspectRatio.num, chainState->aspectRatio.den, chainState->silenceStartPTS, chainState->silenceStopPTS, chainState->reducedPlanes);
+        dsyslog("cSegments::GetNextSegment(): segment: logo %d, scene %d, black %d, lower border %d, hborder %d, vborder %d, aspect ratio %d:%d, silence %" PRId64 " %" PRId64 ", reduced planes %d", job->startState.logo, job->startState.scene, job->startState.blackScreen, job->startState.lowerBorder, job->startState.hBorder, job->startState.vBorder, job->startState.aspectRatio.num, job->startState.aspectRatio.den, job->startState.silenceStartPTS, job->startState.silenceStopPTS, job->startState.reducedPlanes);
+        return nullptr;
+    }
+    // aspect ratio and channel marks change criteria and detector state of main thread, detect this segment again
+    for (const sMarkAdMark &mark : job->marks) {
+        if (((mark.type & 0xF0) == MT_ASPECTCHANGE) || ((mark.type & 0xF0) == MT_CHANNELCHANGE)) {
+            dsyslog("cSegments::GetNextSegment(): segment (%d) to (%d): mark (%d) type 0x%X changes detection", job->startPacket, job->endPacket, mark.position, mark.type);
+            return nullptr;
+        }
+    }
+    dsyslog("cSegments::GetNextSegment(): segment (%d) to (%d): valid, %zu marks detected", job->startPacket, job->endPacket, job->marks.size());
+    return job;
+}
+
+
+void *cSegments::WorkerThread(void *segments) {
+    static_cast<cSegments *>(segments)->Worker();
+    return nullptr;
+}
+
+
+void cSegments::Worker() {
+    pthread_mutex_lock(&mutex);
+    unsigned int jobIndex = nextJob++;
+    pthread_mutex_unlock(&mutex);
+    if (jobIndex >= jobs.size()) return;
+
+    bool done = DetectSegment(&jobs[jobIndex]);
+
+    pthread_mutex_lock(&mutex);
+    jobs[jobIndex].done     = done;
+    jobs[jobIndex].finished = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+
+bool cSegments::DetectSegment(sSegmentJob *job) {
+    if (!job) return false;
+
+    // own index, decoder and criteria, index is build from recording start by reading all packets up to segment
+    cIndex *indexWorker = new cIndex(decoder->GetFullDecode());
+    ALLOC(sizeof(*indexWorker), "indexWorker");
+    cDecoder *decoderWorker = new cDecoder(decoder->GetRecordingDir(), decoder->GetThreads(), decoder->GetFullDecode(), decoder->GetHWaccelName(), decoder->GetForceHWaccel(), forceInterlaced, indexWorker);
+    ALLOC(sizeof(*decoderWorker), "decoderWorker");
+    decoderWorker->SetFastDecode(fastDecode);
+    cCriteria *criteriaWorker = new cCriteria(channelName);
+    ALLOC(sizeof(*criteriaWorker), "criteriaWorker");
+    criteriaWorker->ReadState(criteriaState);
+
+    bool done           = false;
+    cVideo *videoWorker = nullptr;
+    cAudio *audioWorker = nullptr;
+    int frameRate       = 0;
+    if (decoderWorker->ReadNextFile()) frameRate = decoderWorker->GetVideoFrameRate();
+    if (frameRate > 0) {
+        videoWorker = new cVideo(decoderWorker, indexWorker, criteriaWorker, decoder->GetRecordingDir(), autoLogo, logoCacheDir);
+        ALLOC(sizeof(*videoWorker), "videoWorker");
+        videoWorker->SetAspectRatioBroadcast(aspectRatio);
+        if (reducedPlanes) videoWorker->ReducePlanes();   // same logo planes as main thread, reduced in CheckStart()
+        audioWorker = new cAudio(decoderWorker, indexWorker, criteriaWorker);
+        ALLOC(sizeof(*audioWorker), "audioWorker");
+
+        int warmupPacket = std::max(0, job->startPacket - (SEGMENT_WARMUP * frameRate));
+        dsyslog("cSegments::DetectSegment(): segment (%d) to (%d): warmup from packet (%d)", job->startPacket, job->endPacket, warmupPacket);
+        bool started = false;
+        if (decoderWorker->SeekToPacket(warmupPacket)) {
+            while (decoderWorker->DecodeNextFrame(criteriaWorker->GetDetectionState(MT_SOUNDCHANGE))) {
+                if (abortNow) break;
+                if (decoderWorker->IsVideoFrame()) {
+                    int packetNumber = decoderWorker->GetPacketNumber();
+                    // segment start and end, get all audio levels up to this packet, main thread does the same at segment border
+                    if ((!started && (packetNumber >= job->startPacket)) || (packetNumber >= job->endPacket)) {
+                        decoderWorker->WaitForAudioLevels();
+                        if (criteriaWorker->GetDetectionState(MT_AUDIO)) {
+                            sMarkAdMarks *amarks = audioWorker->Detect();
+                            if (started && amarks) job->marks.insert(job->marks.end(), amarks->Number, amarks->Number + amarks->Count);
+                        }
+                        if (!started) {
+                            videoWorker->GetState(&job->startState);
+                            audioWorker->GetState(&job->startState);
+                            started = true;
+                        }
+                        else {
+                            videoWorker->GetState(&job->endState);
+                            audioWorker->GetState(&job->endState);
+                            criteriaWorker->GetState(job->criteriaState, sizeof(job->criteriaState));
+                            done = true;
+                            break;
+                        }
+                    }
+                    // same video detection as main thread
+                    if (criteriaWorker->GetDetectionState(MT_VIDEO)) {
+                        if (!forcedFullDecode || decoderWorker->IsVideoIFrame()) {
+                            sMarkAdMarks *vmarks = videoWorker->Process();
+                            if (started && vmarks) job->marks.insert(job->marks.end(), vmarks->Number, vmarks->Number + vmarks->Count);
+                        }
+                        else decoderWorker->DropFrame();
+                    }
+                }
+                if (criteriaWorker->GetDetectionState(MT_AUDIO)) {
+                    sMarkAdMarks *amarks = audioWorker->Detect();
+                    if (started && amarks) job->marks.insert(job->marks.end(), amarks->Number, amarks->Number + amarks->Count);
+                }
+            }
+        }
+        else esyslog("cSegments::DetectSegment(): segment (%d) to (%d): seek to packet (%d) failed", job->startPacket, job->endPacket, warmupPacket);
+    }
+    if (!done) dsyslog("cSegments::DetectSegment(): segment (%d) to (%d): end of recording or abort before end of segment", job->startPacket, job->endPacket);
+    else dsyslog("cSegments::DetectSegment(): segment (%d) to (%d): %zu marks detected", job->startPacket, job->endPacket, job->marks.size());
+
+    if (audioWorker) {
+        FREE(sizeof(*audioWorker), "audioWorker");
+        delete audioWorker;
+    }
+    if (videoWorker) {
+        FREE(sizeof(*videoWorker), "videoWorker");
+        delete videoWorker;
+    }
+    FREE(sizeof(*criteriaWorker), "criteriaWorker");
+    delete criteriaWorker;
+    FREE(sizeof(*decoderWorker), "decoderWorker");
+    delete decoderWorker;
+    FREE(sizeof(*indexWorker), "indexWorker");
+    delete indexWorker;
+    return done;
+}
@@ -0,0 +1,194 @@
+/*
+ * segment.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __segment_h_
+#define __segment_h_
+
+#include <vector>
+#include <string.h>
+#include <pthread.h>
+
+#include "global.h"
+#include "debug.h"
+#include "index.h"
+#include "decoder.h"
+#include "criteria.h"
+
+
+#define SEGMENT_MAX         8   // maximum count of segments, includes segment of main thread
+#define SEGMENT_MIN_LENGTH 300  // minimum length of a segment in s
+#define SEGMENT_WARMUP      60  // length in s before segment start to settle detector states
+
+
+/**
+ * mark detection job of one segment of the recording
+ */
+typedef struct sSegmentJob {
+    int startPacket             = -1;      //!< first packet of segment, marks detected from this packet are result of this segment
+    //!<
+    int endPacket               = -1;      //!< first packet after segment, detection stops at this packet
+    //!<
+    sDetectorState startState;             //!< detector state at segment start, after warmup
+    //!<
+    sDetectorState endState;               //!< detector state at segment end
+    //!<
+    char criteriaState[CRITERIA_STATE_SIZE] = {0};   //!< criteria state at segment end
+    //!<
+    std::vector<sMarkAdMark> marks;        //!< marks detected in segment, in order of detection
+    //!<
+    bool done                   = false;   //!< true if detection of segment was completed
+    //!<
+    bool finished               = false;   //!< true if worker has finished this segment, successful or not
+    //!<
+} sSegmentJob;
+
+
+/**
+ * detect marks of segments of a finished recording in parallel threads <br>
+ * each segment is processed with its own decoder, index, criteria, video and audio detection, starting with a warmup before segment start <br>
+ * main thread detects first segment and takes marks of the following segments only if detector states at segment border are the same
+ */
+class cSegments {
+public:
+
+    /**
+     * constructor of segmented mark detection
+     * @param decoderParam          main decoder, used for decoder settings
+     * @param channelNameParam      channel name
+     * @param autoLogoParam         mode of logo source
+     * @param logoCacheDirParam     logo cache directory
+     * @param aspectRatioParam      aspect ratio of broadcast
+     * @param fastDecodeParam       true to use analysis decode profile
+     * @param forcedFullDecodeParam true if full decode was forced because of video codec, only i-frames are analysed
+     * @param forceInterlacedParam  true if hwaccel decoder has to treat video as interlaced
+     */
+    cSegments(cDecoder *decoderParam, const char *channelNameParam, const int autoLogoParam, const char *logoCacheDirParam, const sAspectRatio aspectRatioParam, const bool fastDecodeParam, const bool forcedFullDecodeParam, const bool forceInterlacedParam);
+
+    ~cSegments();
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cSegments(const cSegments &origin) {
+        decoder          = origin.decoder;
+        channelName      = origin.channelName;
+        autoLogo         = origin.autoLogo;
+        logoCacheDir     = origin.logoCacheDir;
+        aspectRatio      = origin.aspectRatio;
+        fastDecode       = origin.fastDecode;
+        forcedFullDecode = origin.forcedFullDecode;
+        forceInterlaced  = origin.forceInterlaced;
+        reducedPlanes    = origin.reducedPlanes;
+        memcpy(criteriaState, origin.criteriaState, sizeof(criteriaState));
+        jobs.clear();
+        threads.clear();
+        nextJob          = 0;
+        nextSegment      = 0;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cSegments &operator =(const cSegments *origin) {
+        decoder          = origin->decoder;
+        channelName      = origin->channelName;
+        autoLogo         = origin->autoLogo;
+        logoCacheDir     = origin->logoCacheDir;
+        aspectRatio      = origin->aspectRatio;
+        fastDecode       = origin->fastDecode;
+        forcedFullDecode = origin->forcedFullDecode;
+        forceInterlaced  = origin->forceInterlaced;
+        reducedPlanes    = origin->reducedPlanes;
+        memcpy(criteriaState, origin->criteriaState, sizeof(criteriaState));
+        jobs.clear();
+        threads.clear();
+        nextJob          = 0;
+        nextSegment      = 0;
+        return *this;
+    };
+
+    /**
+     * split range into segments and start a worker thread for each segment after the first
+     * @param startPacket      first packet of range, first segment is processed by main thread from here
+     * @param endPacket        first packet after range
+     * @param count            count of segments, including first segment
+     * @param criteriaParam    criteria of main thread, copied to each worker
+     * @param reducedPlanesParam true if logo detection of main thread is reduced to plane 0, applied to each worker
+     * @return count of started worker threads
+     */
+    int Start(const int startPacket, const int endPacket, const int count, const cCriteria *criteriaParam, const bool reducedPlanesParam);
+
+    /**
+     * get first packet of next segment not yet checked
+     * @return first packet of next segment, INT_MAX if all segments are checked
+     */
+    int GetNextSegmentStart() const;
+
+    /**
+     * wait for worker of next segment and check if its result is valid as continuation of the detection chain <br>
+     * a segment is valid if the detector states at segment start are the same as at the end of the chain,
+     * criteria are unchanged and no aspect ratio or channel marks are detected, they change criteria and detector state
+     * @param chainState    detector state at end of detection chain
+     * @param criteriaParam criteria at end of detection chain
+     * @return next segment if valid, nullptr otherwise, next segment is checked in both cases
+     */
+    const sSegmentJob *GetNextSegment(const sDetectorState *chainState, const cCriteria *criteriaParam);
+
+private:
+
+    /**
+     * segment worker thread
+     * @param segments pointer to cSegments object
+     */
+    static void *WorkerThread(void *segments);
+
+    /**
+     * process next segment job
+     */
+    void Worker();
+
+    /**
+     * detect marks in one segment with own decoder, index, criteria, video and audio detection
+     * @param[in, out] job segment job, set to detected marks and detector states
+     * @return true if detection of segment was completed, false otherwise
+     */
+    bool DetectSegment(sSegmentJob *job);
+
+    cDecoder *decoder                       = nullptr;   //!< main decoder
+    //!<
+    const char *channelName                 = nullptr;   //!< channel name
+    //!<
+    int autoLogo                            = 0;         //!< mode of logo source
+    //!<
+    const char *logoCacheDir                = nullptr;   //!< logo cache directory
+    //!<
+    sAspectRatio aspectRatio                = {};        //!< aspect ratio of broadcast
+    //!<
+    bool fastDecode                         = false;     //!< true to use analysis decode profile
+    //!<
+    bool forcedFullDecode                   = false;     //!< true if only i-frames are analysed
+    //!<
+    bool forceInterlaced                    = false;     //!< true if hwaccel decoder has to treat video as interlaced
+    //!<
+    bool reducedPlanes                      = false;     //!< true if logo detection of main thread is reduced to plane 0
+    //!<
+    char criteriaState[CRITERIA_STATE_SIZE] = {0};       //!< criteria state of main thread at start of segmented detection
+    //!<
+    std::vector<sSegmentJob> jobs;                       //!< segment jobs, first segment of main thread is not included
+    //!<
+    std::vector<pthread_t> threads;                      //!< running worker threads
+    //!<
+    unsigned int nextJob                    = 0;         //!< index of next job for a worker thread
+    //!<
+    unsigned int nextSegment                = 0;         //!< index of next job to check by main thread
+    //!<
+    pthread_mutex_t mutex                   = PTHREAD_MUTEX_INITIALIZER;   //!< mutex for next job and finished jobs
+    //!<
+    pthread_cond_t cond                     = PTHREAD_COND_INITIALIZER;    //!< condition for finished jobs
+    //!<
+};
+#endif
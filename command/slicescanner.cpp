@@ -0,0 +1,216 @@
+/*
+ * slicescanner.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <inttypes.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "slicescanner.h"
+
+
+/**
+ * bit reader for NAL unit payload, skips emulation prevention bytes
+ */
+typedef struct sBitReader {
+    const uint8_t *data = nullptr;   //!< NAL unit payload
+    //!<
+    int size            = 0;         //!< size of payload
+    //!<
+    int pos             = 0;         //!< current byte position
+    //!<
+    int bit             = 0;         //!< current bit position in byte, 0 is MSB
+    //!<
+    int zeros           = 0;         //!< count of zero bytes before current byte
+    //!<
+    bool error          = false;     //!< true if read after end of payload
+    //!<
+} sBitReader;
+
+
+/**
+ * read next bit
+ * @param reader bit reader
+ * @return value of bit, 0 after end of payload
+ */
+static int ReadBit(sBitReader *reader) {
+    if (reader->bit == 0) {
+        // skip emulation prevention byte 0x03 after two zero bytes
+        if ((reader->zeros >= 2) && (reader->pos < reader->size) && (reader->data[reader->pos] == 0x03)) {
+            reader->pos++;
+            reader->zeros = 0;
+        }
+        if (reader->pos >= reader->size) {
+            reader->error = true;
+            return 0;
+        }
+    }
+    int value = (reader->data[reader->pos] >> (7 - reader->bit)) & 0x01;
+    reader->bit++;
+    if (reader->bit == 8) {
+        reader->zeros = (reader->data[reader->pos] == 0) ? reader->zeros + 1 : 0;
+        reader->bit   = 0;
+        reader->pos++;
+    }
+    return value;
+}
+
+
+/**
+ * read unsigned integer
+ * @param reader bit reader
+ * @param bits   count of bits, at most 32
+ * @return value
+ */
+static uint32_t ReadBits(sBitReader *reader, const int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits; i++) value = (value << 1) | ReadBit(reader);
+    return value;
+}
+
+
+/**
+ * read unsigned exp-Golomb code
+ * @param reader bit reader
+ * @return value, 0 on invalid code
+ */
+static uint32_t ReadUE(sBitReader *reader) {
+    int leadingZeros = 0;
+    while (!ReadBit(reader)) {
+        if (reader->error || (leadingZeros >= 31)) {
+            reader->error = true;
+            return 0;
+        }
+        leadingZeros++;
+    }
+    return ((1U << leadingZeros) - 1) + ReadBits(reader, leadingZeros);
+}
+
+
+/**
+ * check SEI NAL unit for recovery point message
+ * @param data SEI payload after NAL header
+ * @param size size of payload
+ * @return true if recovery point SEI found, false otherwise
+ */
+static bool HasRecoveryPoint(const uint8_t *data, const int size) {
+    sBitReader reader;
+    reader.data = data;
+    reader.size = size;
+    while ((reader.pos < reader.size - 1) && !reader.error) {  // last byte is rbsp trailing bits
+        int payloadType = 0;
+        int byte        = 0xFF;
+        while ((byte == 0xFF) && !reader.error) {
+            byte         = ReadBits(&reader, 8);
+            payloadType += byte;
+        }
+        int payloadSize = 0;
+        byte            = 0xFF;
+        while ((byte == 0xFF) && !reader.error) {
+            byte         = ReadBits(&reader, 8);
+            payloadSize += byte;
+        }
+        if (reader.error) return false;
+        if (payloadType == 6) return true;   // recovery point
+        for (int i = 0; (i < payloadSize) && !reader.error; i++) ReadBits(&reader, 8);
+    }
+    return false;
+}
+
+
+cSliceScanner::cSliceScanner() {
+}
+
+
+cSliceScanner::~cSliceScanner() {
+}
+
+
+bool cSliceScanner::Scan(const uint8_t *data, const int size, sSliceInfo *info) {
+    if (!data) return false;
+    if (!info) return false;
+    *info = {};
+
+    // find next start code 0x000001, NAL unit header is next byte
+    int pos = 0;
+    while (pos < size - 3) {
+        if ((data[pos] != 0) || (data[pos + 1] != 0) || (data[pos + 2] != 1)) {
+            pos++;
+            continue;
+        }
+        pos += 3;
+        int nalUnitType = data[pos] & 0x1F;
+        pos++;
+        switch (nalUnitType) {
+        case 1:   // coded slice of non IDR picture
+        case 5: { // coded slice of IDR picture
+            sBitReader reader;
+            reader.data = data + pos;
+            reader.size = size - pos;
+            ReadUE(&reader);  // first_mb_in_slice
+            uint32_t sliceType = ReadUE(&reader);
+            if (reader.error || (sliceType > 9)) return false;
+            info->sliceType = sliceType % 5;
+            info->idr       = (nalUnitType == 5);
+            return true;
+        }
+        case 6: { // SEI, ends with next start code
+            int end = pos;
+            while ((end < size - 2) && ((data[end] != 0) || (data[end + 1] != 0) || (data[end + 2] != 1))) end++;
+            if (end >= size - 2) end = size;
+            if (HasRecoveryPoint(data + pos, end - pos)) info->recoveryPoint = true;
+            pos = end;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+
+int64_t cSliceScanner::Process(const int packetNumber, const int64_t pts, const uint8_t *data, const int size) {
+    if (packetNumber != (lastPacketNumber + 1)) Reset();  // seek in input stream
+    lastPacketNumber = packetNumber;
+
+    sSliceInfo info;
+    if (!Scan(data, size, &info)) {
+        startPTS   = -1;  // unknown picture type, no p-slice
+        pendingPTS = -1;
+        return -1;
+    }
+#ifdef DEBUG_INDEX
+    dsyslog("cSliceScanner::Process(): packet (%5d) PTS %" PRId64 ": slice type %d, IDR %d, recovery point %d", packetNumber, pts, info.sliceType, info.idr, info.recoveryPoint);
+#endif
+
+    int64_t pSlicePTS = -1;
+    if (info.sliceType == SLICE_TYPE_I) {
+        pSlicePTS  = pendingPTS;   // all leading pictures of previous i-frame are checked
+        pendingPTS = startPTS;     // current sequence is p-slice up to this i-frame, wait for leading pictures
+        startPTS   = pts;
+        iFramePTS  = pts;
+    }
+    else if ((iFramePTS >= 0) && (pts < iFramePTS)) {  // leading picture, in presentation order before last i-frame
+        if (info.sliceType != SLICE_TYPE_P) pendingPTS = -1;
+    }
+    else {
+        pSlicePTS  = pendingPTS;   // no more leading pictures
+        pendingPTS = -1;
+        if (info.sliceType != SLICE_TYPE_P) startPTS = -1;
+    }
+    return pSlicePTS;
+}
+
+
+void cSliceScanner::Reset() {
+    lastPacketNumber = -1;
+    iFramePTS        = -1;
+    startPTS         = -1;
+    pendingPTS       = -1;
+}
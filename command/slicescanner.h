@@ -0,0 +1,84 @@
+/*
+ * slicescanner.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __slicescanner_h_
+#define __slicescanner_h_
+
+#include <stdint.h>
+
+#include "global.h"
+#include "debug.h"
+
+
+// H.264 slice types, values 5 to 9 are the same types with all slices of picture from same type
+#define SLICE_TYPE_P   0
+#define SLICE_TYPE_B   1
+#define SLICE_TYPE_I   2
+#define SLICE_TYPE_SP  3
+#define SLICE_TYPE_SI  4
+
+
+/**
+ * classification of a H.264 access unit from NAL unit headers
+ */
+typedef struct sSliceInfo {
+    int sliceType      = -1;      //!< slice type of first slice (SLICE_TYPE_*), -1 if no slice header found
+    //!<
+    bool idr           = false;   //!< true if first slice is from an IDR picture
+    //!<
+    bool recoveryPoint = false;   //!< true if access unit has a recovery point SEI
+    //!<
+} sSliceInfo;
+
+
+/**
+ * find start of H.264 p-slices from demuxed packets without decoding <br>
+ * a p-slice is a sequence of pictures from an i-frame to the next i-frame with only p-frames in presentation order,
+ * same result as check of decoded frame picture types, but without the need of full decoding
+ */
+class cSliceScanner {
+public:
+
+    cSliceScanner();
+
+    ~cSliceScanner();
+
+    /**
+     * parse NAL units of an Annex B H.264 packet up to first slice header
+     * @param[in]  data packet data
+     * @param[in]  size packet size
+     * @param[out] info classification of access unit
+     * @return true if a slice header was found, false otherwise
+     */
+    static bool Scan(const uint8_t *data, const int size, sSliceInfo *info);
+
+    /**
+     * process next video packet in decode order
+     * @param packetNumber  packet number, restart p-slice detection if not directly after previous packet
+     * @param pts           PTS of packet
+     * @param data          packet data
+     * @param size          packet size
+     * @return PTS of i-frame at start of a completed p-slice, -1 if no p-slice is completed with this packet
+     */
+    int64_t Process(const int packetNumber, const int64_t pts, const uint8_t *data, const int size);
+
+    /**
+     * reset p-slice detection, used after seek in input stream
+     */
+    void Reset();
+
+private:
+    int lastPacketNumber = -1;   //!< packet number of previous packet
+    //!<
+    int64_t iFramePTS    = -1;   //!< PTS of last i-frame
+    //!<
+    int64_t startPTS     = -1;   //!< PTS of i-frame at start of current p-slice, -1 if current sequence is no p-slice
+    //!<
+    int64_t pendingPTS   = -1;   //!< PTS of i-frame at start of previous p-slice, waits for leading pictures of current i-frame
+    //!<
+};
+#endif
@@ -8,8 +8,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <algorithm>
 
 #include "sobel.h"
+#ifdef WINDOWS
+#include <malloc.h>
+#endif
 
 
 cSobel::cSobel(const int videoWidthParam, const int videoHeightParam, const int boundaryParam) {
@@ -41,6 +45,14 @@ cSobel::cSobel(const int videoWidthParam, const int videoHeightParam, const int
     GY[2][1] = -2;
     GY[2][2] = -1;
 
+    // select sobel kernel for video size
+    if      ((videoWidth ==  720) && (videoHeight ==  576)) sobelPlaneKernel = &cSobel::SobelPlaneKernel< 720,  576>;
+    else if ((videoWidth == 1280) && (videoHeight ==  720)) sobelPlaneKernel = &cSobel::SobelPlaneKernel<1280,  720>;
+    else if ((videoWidth == 1440) && (videoHeight == 1080)) sobelPlaneKernel = &cSobel::SobelPlaneKernel<1440, 1080>;
+    else if ((videoWidth == 1920) && (videoHeight == 1080)) sobelPlaneKernel = &cSobel::SobelPlaneKernel<1920, 1080>;
+    else if ((videoWidth == 3840) && (videoHeight == 2160)) sobelPlaneKernel = &cSobel::SobelPlaneKernel<3840, 2160>;
+    else                                                    sobelPlaneKernel = &cSobel::SobelPlaneKernel<0, 0>;
+
     dsyslog("cSobel::cSobel(): video %dx%d", videoWidth, videoHeight);
 }
 
@@ -49,6 +61,12 @@ cSobel::~cSobel() {
 }
 
 
+int cSobel::GetPlanePixel(const sLogoSize logoSize, const int plane) {
+    if (plane == 0) return logoSize.width * logoSize.height;
+    return ((logoSize.width / 2) + 1) * ((logoSize.height / 2) + 1);
+}
+
+
 bool cSobel::AllocAreaBuffer(sAreaT *area) const {
     // if we have no area logo size, we use max size for this resolution
     if ((area->logoSize.width == 0) || (area->logoSize.height == 0)) {
@@ -56,35 +74,43 @@ bool cSobel::AllocAreaBuffer(sAreaT *area) const {
     }
     dsyslog("cSobel::AllocResultBuffer(): logo size %dx%d", area->logoSize.width, area->logoSize.height);
 
-    // alloc memory for sobel transformed planes
-    int logoPixel = area->logoSize.width * area->logoSize.height;
-    area->sobel = new uchar*[PLANES];
+    // one memory block for all buffers: pointer arrays, then for each plane sobel, logo, result and inverse side by side,
+    // so SobelPlane() reads and writes near memory, each buffer starts 64 byte aligned
+    size_t pointerSize = ((4 * PLANES * sizeof(uchar *)) + SOBEL_ALIGN - 1) & ~(SOBEL_ALIGN - 1);
+    size_t planeSize[PLANES];
+    size_t bufferSize  = pointerSize;
     for (int plane = 0; plane < PLANES; plane++) {
-        area->sobel[plane] = new uchar[logoPixel];
+        planeSize[plane] = (GetPlanePixel(area->logoSize, plane) + SOBEL_ALIGN - 1) & ~(SOBEL_ALIGN - 1);
+        bufferSize += 4 * planeSize[plane];
     }
-    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * logoPixel, "area.sobel");
-
-    // alloc memory for logo
-    area->logo = new uchar*[PLANES];
-    for (int plane = 0; plane < PLANES; plane++) {
-        area->logo[plane] = new uchar[logoPixel];
-    }
-    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * logoPixel, "area.logo");
-
-    // alloc memory for mask result (machtes)
-    area->result = new uchar*[PLANES];
-    for (int plane = 0; plane < PLANES; plane++) {
-        area->result[plane] = new uchar[logoPixel];
+    void *buffer = nullptr;
+#ifdef POSIX
+    if (posix_memalign(&buffer, SOBEL_ALIGN, bufferSize) != 0) buffer = nullptr;
+#else
+    buffer = _aligned_malloc(bufferSize, SOBEL_ALIGN);
+#endif
+    if (!buffer) {
+        esyslog("cSobel::AllocAreaBuffer(): out of memory");
+        return false;
     }
-    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * logoPixel, "area.result");
-
-    // alloc memory for mask inverse result
-    area->inverse = new uchar*[PLANES];
+    memset(buffer, 0, bufferSize);
+    ALLOC(bufferSize, "area.buffer");
+    area->buffer     = static_cast<uchar *>(buffer);
+    area->bufferSize = bufferSize;
+
+    uchar **pointer = reinterpret_cast<uchar **>(area->buffer);
+    area->sobel     = pointer;
+    area->logo      = pointer + PLANES;
+    area->result    = pointer + (2 * PLANES);
+    area->inverse   = pointer + (3 * PLANES);
+    uchar *planeBuffer = area->buffer + pointerSize;
     for (int plane = 0; plane < PLANES; plane++) {
-        area->inverse[plane] = new uchar[logoPixel];
+        area->sobel[plane]   = planeBuffer;
+        area->logo[plane]    = planeBuffer + planeSize[plane];
+        area->result[plane]  = planeBuffer + (2 * planeSize[plane]);
+        area->inverse[plane] = planeBuffer + (3 * planeSize[plane]);
+        planeBuffer += 4 * planeSize[plane];
     }
-    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * logoPixel, "area.inverse");
-
     return true;
 }
 
@@ -95,34 +121,21 @@ bool cSobel::FreeAreaBuffer(sAreaT *area) {
         return false;
     }
     dsyslog("cSobel::FreeResultBuffer(): logo size %dx%d", area->logoSize.width, area->logoSize.height);
-    // free memory for sobel plane
-    if (area->sobel) {
-        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area->logoSize.width * area->logoSize.height, "area.sobel");
-        for (int plane = 0; plane < PLANES; plane++) delete[] area->sobel[plane];
-        delete[] area->sobel;
-        area->sobel = nullptr;
-    }
-    // free memory for logo
-    if (area->logo) {
-        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area->logoSize.width * area->logoSize.height, "area.logo");
-        for (int plane = 0; plane < PLANES; plane++) delete[] area->logo[plane];
-        delete[] area->logo;
-        area->logo = nullptr;
-    }
-    // free memory for sobel result
-    if (area->result) {
-        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area->logoSize.width * area->logoSize.height, "area.result");
-        for (int plane = 0; plane < PLANES; plane++) delete[] area->result[plane];
-        delete[] area->result;
-        area->result = nullptr;
-    }
-    // free memory for sobel inverse result
-    if (area->inverse) {
-        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * area->logoSize.width * area->logoSize.height, "area.inverse");
-        for (int plane = 0; plane < PLANES; plane++) delete[] area->inverse[plane];
-        delete[] area->inverse;
-        area->inverse = nullptr;
+    // free memory block with all planes
+    if (area->buffer) {
+        FREE(area->bufferSize, "area.buffer");
+#ifdef POSIX
+        free(area->buffer);
+#else
+        _aligned_free(area->buffer);
+#endif
+        area->buffer     = nullptr;
+        area->bufferSize = 0;
     }
+    area->sobel   = nullptr;
+    area->logo    = nullptr;
+    area->result  = nullptr;
+    area->inverse = nullptr;
     for (int plane = 0; plane < PLANES; plane++) {
         area->valid[plane]  = false;
         area->rPixel[plane] = 0;
@@ -186,6 +199,14 @@ bool cSobel::SobelPlane(const sVideoPicture *picture, sAreaT *area, const int pl
     area->rPixel[plane] = 0;
     area->iPixel[plane] = 0;
 
+    return (this->*sobelPlaneKernel)(picture, area, plane);
+}
+
+
+// VIDEO_WIDTH and VIDEO_HEIGHT are compile time constants for the broadcast resolutions, 0 for generic kernel with size from object
+// borders of logo area and video are checked once per line and column range, not for each pixel
+//
+template<int VIDEO_WIDTH, int VIDEO_HEIGHT> bool cSobel::SobelPlaneKernel(const sVideoPicture *picture, sAreaT *area, const int plane) {
     // get logo coordinates
     int xStart = 0;
     int xEnd   = 0;
@@ -198,8 +219,8 @@ bool cSobel::SobelPlane(const sVideoPicture *picture, sAreaT *area, const int pl
 
     int cutval           = 127;
     int planeLogoWidth   = area->logoSize.width;
-    int planeVideoWidth  = videoWidth;
-    int planeVideoHeight = videoHeight;
+    int planeVideoWidth  = (VIDEO_WIDTH  > 0) ? VIDEO_WIDTH  : videoWidth;
+    int planeVideoHeight = (VIDEO_HEIGHT > 0) ? VIDEO_HEIGHT : videoHeight;
     int planeBoundary    = boundary;
     if (plane > 0) {
         planeBoundary    /= 2;
@@ -208,68 +229,61 @@ bool cSobel::SobelPlane(const sVideoPicture *picture, sAreaT *area, const int pl
         planeVideoWidth  /= 2;
         planeVideoHeight /= 2;
     }
-    int SUM;
-    int sumX;
-    int sumY;
     rPixel    = 0;
     iPixel    = 0;
     intensity = 0;
 
+    // range with sobel transformation, outside of this range pixel are boundary (SUM = 0)
+    int xFirst = std::max(xStart + planeBoundary, 1);
+    int xLast  = std::min(xEnd - planeBoundary, planeVideoWidth - 2) - 1;
+    int yFirst = std::max(yStart + planeBoundary, 1);
+    int yLast  = std::min(yEnd - planeBoundary, planeVideoHeight - 3);
+
 #ifdef DEBUG_SOBEL
     dsyslog("cSobel::SobelPlane(): plane %d: xStart %d, xEend %d, yStart %d, yEnd %d", plane, xStart, xEnd, yStart, yEnd);
 #endif
 
+    const int lineSize = picture->planeLineSize[plane];
     for (int Y = yStart; Y <= yEnd; Y++) {
-        for (int X = xStart; X <= xEnd; X++) {
-            if (plane == 0) {
-                intensity += picture->plane[plane][X + (Y * picture->planeLineSize[plane])];
-            }
-            sumX = 0;
-            sumY = 0;
-
-            // image boundaries from coordinates
-            if ((X < (xStart + planeBoundary))     || (X <= 0) ||
-                    (X >= (xEnd - planeBoundary))  || (X >= (planeVideoWidth - 2)) ||
-                    (Y < (yStart + planeBoundary)) || (Y <= 0) ||
-                    (Y > (yEnd - planeBoundary))   || (Y >= (planeVideoHeight - 2))) SUM = 0;
-            // convolution starts here
-            else {
-                // X Gradient approximation
-                for (int I = -1; I <= 1; I++) {
-                    for (int J = -1; J <= 1; J++) {
-                        sumX = sumX + static_cast<int> ((*(picture->plane[plane] + X + I + (Y + J) * picture->planeLineSize[plane])) * GX[I + 1][J + 1]);
-                    }
-                }
-
-                // Y Gradient approximation
-                for (int I = -1; I <= 1; I++) {
-                    for (int J = -1; J <= 1; J++) {
-                        sumY = sumY+ static_cast<int> ((*(picture->plane[plane] + X + I + (Y + J) * picture->planeLineSize[plane])) * GY[I + 1][J + 1]);
-                    }
-                }
-
-                // Gradient Magnitude approximation
-                SUM = abs(sumX) + abs(sumY);
-            }
+        const uchar *line = picture->plane[plane] + (Y * lineSize);
+        uchar *sobelLine  = area->sobel[plane] + ((Y - yStart) * planeLogoWidth);
 
-            if (SUM >= cutval) SUM = 255;
-            if (SUM <  cutval) SUM =   0;
-
-            int val = 255 - (uchar) SUM;
+        if (plane == 0) {
+            for (int X = xStart; X <= xEnd; X++) intensity += line[X];
+        }
 
-            area->sobel[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] = val;
+        if ((Y < yFirst) || (Y > yLast) || (xFirst > xLast)) {
+            memset(sobelLine, 255, xEnd - xStart + 1);  // boundary line
+        }
+        else {
+            const uchar *lineBefore = line - lineSize;
+            const uchar *lineAfter  = line + lineSize;
+            for (int X = xStart; X < xFirst; X++) sobelLine[X - xStart] = 255;
+            for (int X = xFirst; X <= xLast; X++) {
+                // gradient approximation with GX and GY sobel mask
+                int sumX = (lineAfter[X - 1] + 2 * lineAfter[X] + lineAfter[X + 1]) - (lineBefore[X - 1] + 2 * lineBefore[X] + lineBefore[X + 1]);
+                int sumY = (lineBefore[X - 1] + 2 * line[X - 1] + lineAfter[X - 1]) - (lineBefore[X + 1] + 2 * line[X + 1] + lineAfter[X + 1]);
+                // gradient magnitude approximation
+                int SUM = abs(sumX) + abs(sumY);
+                sobelLine[X - xStart] = (SUM >= cutval) ? 0 : 255;
+            }
+            for (int X = xLast + 1; X <= xEnd; X++) sobelLine[X - xStart] = 255;
+        }
 
-            // only store results in logo coordinates range
-            if (area->valid[plane]) {  // if we are called by logo search, we have no valid logo
+        // only store results in logo coordinates range
+        if (area->valid[plane]) {  // if we are called by logo search, we have no valid logo
+            const uchar *logoLine = area->logo[plane]    + ((Y - yStart) * planeLogoWidth);
+            uchar *resultLine     = area->result[plane]  + ((Y - yStart) * planeLogoWidth);
+            uchar *inverseLine    = area->inverse[plane] + ((Y - yStart) * planeLogoWidth);
+            for (int X = 0; X <= (xEnd - xStart); X++) {
                 // area result
-                area->result[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] = (area->logo[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] + val) & 255;
-                if (area->result[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] == 0) area->rPixel[plane]++;
+                resultLine[X] = (logoLine[X] + sobelLine[X]) & 255;
+                if (resultLine[X] == 0) area->rPixel[plane]++;
                 // area inverted
-                area->inverse[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] = ((255 - area->logo[plane][(X - xStart) + (Y - yStart) * planeLogoWidth]) + val) & 255;
-                if (area->inverse[plane][(X - xStart) + (Y - yStart) * planeLogoWidth] == 0) area->iPixel[plane]++;
+                inverseLine[X] = ((255 - logoLine[X]) + sobelLine[X]) & 255;
+                if (inverseLine[X] == 0) area->iPixel[plane]++;
             }
         }
-
     }
     if (plane == 0) {
         area->intensity = intensity / (area->logoSize.width * area->logoSize.height);
@@ -13,6 +13,9 @@
 #include "global.h"
 #include "debug.h"
 
+
+#define SOBEL_ALIGN 64   // alignment of area planes, for vector loads and cache lines
+
 /**
  * class to do sobel transformation
  */
@@ -36,6 +39,7 @@ public:
         rPixel       = origin.rPixel;
         iPixel       = origin.iPixel;
         intensity    = origin.intensity;
+        sobelPlaneKernel = origin.sobelPlaneKernel;
     }
 
     /**
@@ -50,6 +54,7 @@ public:
         rPixel       = origin->rPixel;
         iPixel       = origin->iPixel;
         intensity    = origin->intensity;
+        sobelPlaneKernel = origin->sobelPlaneKernel;
         return *this;
     }
 
@@ -67,6 +72,15 @@ public:
     */
     static bool FreeAreaBuffer(sAreaT *area);
 
+    /**
+    * get size of a plane in area buffer
+    * chroma planes have half width and half height, one more line and column for odd logo size
+    * @param logoSize logo size
+    * @param plane    number of video plane
+    * @return count of pixel in plane
+    */
+    static int GetPlanePixel(const sLogoSize logoSize, const int plane);
+
     /**
     * sobel transformation of a all planes with a logo plane from input picture
     * @param picture    input picture
@@ -117,6 +131,20 @@ private:
     */
     sLogoSize GetMaxLogoSize() const;
 
+    /**
+    * sobel transformation kernel of a single plane, specialized for video size
+    * @tparam VIDEO_WIDTH  video width, 0 for generic kernel
+    * @tparam VIDEO_HEIGHT video height, 0 for generic kernel
+    * @param picture    input video picture
+    * @param area       result area
+    * @param plane      number of video plane
+    * @return           true if successful, false otherwise
+    */
+    template<int VIDEO_WIDTH, int VIDEO_HEIGHT> bool SobelPlaneKernel(const sVideoPicture *picture, sAreaT *area, const int plane);
+
+    typedef bool (cSobel::*tSobelPlaneKernel)(const sVideoPicture *picture, sAreaT *area, const int plane);   //!< sobel kernel function
+    //!<
+
     int GX[3][3]         = {0};      //!< GX Sobel mask
     //!<
     int GY[3][3]         = {0};      //!< GY Sobel mask
@@ -133,5 +161,7 @@ private:
     //!<
     int intensity        = 0;        //!< brightness of plane 0 picture
     //!<
+    tSobelPlaneKernel sobelPlaneKernel = nullptr;   //!< sobel kernel, selected for video size in constructor
+    //!<
 };
 #endif
@@ -7,6 +7,7 @@
 
 #include "tools.h"
 #include "debug.h"
+#include "trace.h"
 
 #include <string>
 #include <cstring>
@@ -36,6 +37,10 @@ int cTools::EndSection(const char* name) const {
     std::chrono::high_resolution_clock::time_point stopSectionTime = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> durationSection = stopSectionTime - startSectionTime;
     int msElapsed = round(durationSection.count());
+    if (cTrace::IsActive()) {  // sections are not sampled
+        int64_t usElapsed = round(durationSection.count() * 1000);
+        cTrace::Add(name, "section", cTrace::Now() - usElapsed, usElapsed);
+    }
     dsyslog(">>>>>>>>>> end  section: %s: %5ds %3dms >>>>>>>>>>>>>>>>>", name, static_cast<int>(msElapsed / 1000), msElapsed % 1000);
     return msElapsed;
 }
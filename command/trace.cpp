@@ -0,0 +1,132 @@
+/*
+ * trace.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/syscall.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "trace.h"
+
+#define TRACE_BUFFER_EVENTS 4096   // count of buffered spans of a thread before they are written
+
+
+/**
+ * spans and sample state of a thread, written to trace file on thread exit
+ */
+typedef struct sTraceThread {
+    std::vector<sTraceEvent> events;  //!< buffered spans
+    //!<
+    int packetNumber = 0;             //!< current video packet of thread
+    //!<
+    long int tid     = 0;             //!< thread id
+    //!<
+
+    sTraceThread() {
+#ifdef POSIX
+        tid = syscall(SYS_gettid);
+#endif
+    }
+
+    ~sTraceThread() {
+        cTrace::Flush(&events, tid);
+    }
+} sTraceThread;
+
+static thread_local sTraceThread traceThread;
+
+
+std::atomic<bool> cTrace::active(false);
+FILE *cTrace::file                                  = nullptr;
+pthread_mutex_t cTrace::mutex                       = PTHREAD_MUTEX_INITIALIZER;
+int cTrace::rate                                    = 1;
+bool cTrace::firstEvent                             = true;
+std::chrono::steady_clock::time_point cTrace::startTime;
+
+
+bool cTrace::Open(const char *fileName, const int sampleRate) {
+    if (!fileName) return false;
+    pthread_mutex_lock(&mutex);
+    if (file) {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+    file = fopen(fileName, "w");
+    if (!file) {
+        pthread_mutex_unlock(&mutex);
+        esyslog("cTrace::Open(): failed to open trace file %s", fileName);
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    rate       = (sampleRate > 0) ? sampleRate : 1;
+    firstEvent = true;
+    startTime  = std::chrono::steady_clock::now();
+    active     = true;
+    pthread_mutex_unlock(&mutex);
+    dsyslog("cTrace::Open(): write trace to %s, sample every %d. video packet", fileName, rate);
+    return true;
+}
+
+
+void cTrace::Close() {
+    if (!active) return;
+    active = false;
+    Flush(&traceThread.events, traceThread.tid);
+    pthread_mutex_lock(&mutex);
+    if (file) {
+        fprintf(file, "\n]}\n");
+        fclose(file);
+        file = nullptr;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+
+void cTrace::SetPacket(const int packetNumber) {
+    traceThread.packetNumber = packetNumber;
+}
+
+
+bool cTrace::IsSampled() {
+    return (traceThread.packetNumber % rate) == 0;
+}
+
+
+int64_t cTrace::Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+
+void cTrace::Add(const char *name, const char *category, const int64_t start, const int64_t duration) {
+    if (!name || !category) return;
+    sTraceEvent event;
+    event.name     = name;
+    event.category = category;
+    event.start    = start;
+    event.duration = duration;
+    traceThread.events.push_back(event);
+    if (traceThread.events.size() >= TRACE_BUFFER_EVENTS) Flush(&traceThread.events, traceThread.tid);
+}
+
+
+void cTrace::Flush(std::vector<sTraceEvent> *events, const long int tid) {
+    if (!events || events->empty()) return;
+    pthread_mutex_lock(&mutex);
+    if (file) {
+        int pid = getpid();
+        for (const sTraceEvent &event : *events) {
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRId64 ",\"dur\":%" PRId64 ",\"pid\":%d,\"tid\":%ld}", firstEvent ? "" : ",\n", event.name, event.category, event.start, event.duration, pid, tid);
+            firstEvent = false;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    events->clear();
+}
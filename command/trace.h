@@ -0,0 +1,164 @@
+/*
+ * trace.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __trace_h_
+#define __trace_h_
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <pthread.h>
+
+#include "global.h"
+#include "debug.h"
+
+
+/**
+ * timestamped span of a pipeline stage
+ */
+typedef struct sTraceEvent {
+    const char *name     = nullptr;  //!< span name, has to be a string literal
+    //!<
+    const char *category = nullptr;  //!< span category, has to be a string literal
+    //!<
+    int64_t start        = 0;        //!< start in us from open of trace file
+    //!<
+    int64_t duration     = 0;        //!< duration in us
+    //!<
+} sTraceEvent;
+
+
+/**
+ * process wide writer of per thread pipeline spans in Chrome trace JSON format (chrome://tracing, Perfetto) <br>
+ * spans are buffered per thread and written in blocks, each thread records only spans of every n-th video packet it has read
+ */
+class cTrace {
+public:
+
+    /**
+     * open trace file and start recording
+     * @param fileName   trace file name
+     * @param sampleRate record spans of every n-th video packet of each thread
+     * @return true if successful, false otherwise
+     */
+    static bool Open(const char *fileName, const int sampleRate);
+
+    /**
+     * stop recording, write buffered spans of calling thread and close trace file <br>
+     * all other threads with spans have to be finished before
+     */
+    static void Close();
+
+    /**
+     * check if trace is recorded
+     * @return true if trace file is open
+     */
+    static bool IsActive() {
+        return active;
+    }
+
+    /**
+     * set current video packet of calling thread, used for sampling
+     * @param packetNumber video packet number
+     */
+    static void SetPacket(const int packetNumber);
+
+    /**
+     * check if spans of current video packet of calling thread are recorded
+     * @return true if sampled, false otherwise
+     */
+    static bool IsSampled();
+
+    /**
+     * get timestamp
+     * @return us from open of trace file
+     */
+    static int64_t Now();
+
+    /**
+     * add span of calling thread
+     * @param name     span name, has to be a string literal
+     * @param category span category, has to be a string literal
+     * @param start    start in us from open of trace file
+     * @param duration duration in us
+     */
+    static void Add(const char *name, const char *category, const int64_t start, const int64_t duration);
+
+    /**
+     * write spans to trace file and clear them
+     * @param events buffered spans of a thread
+     * @param tid    thread id
+     */
+    static void Flush(std::vector<sTraceEvent> *events, const long int tid);
+
+private:
+    static std::atomic<bool> active;                            //!< true if trace is recorded
+    //!<
+    static FILE *file;                                          //!< trace file
+    //!<
+    static pthread_mutex_t mutex;                               //!< mutex for trace file
+    //!<
+    static int rate;                                            //!< sample rate in video packets
+    //!<
+    static bool firstEvent;                                     //!< true if no event is written yet
+    //!<
+    static std::chrono::steady_clock::time_point startTime;     //!< time of open trace file
+    //!<
+};
+
+
+/**
+ * record one span from constructor to destructor if trace is active and current packet is sampled
+ */
+class cTraceSpan {
+public:
+
+    /**
+     * start span
+     * @param nameParam     span name, has to be a string literal
+     * @param categoryParam span category, has to be a string literal
+     */
+    cTraceSpan(const char *nameParam, const char *categoryParam) {
+        if (!cTrace::IsActive() || !cTrace::IsSampled()) return;
+        name     = nameParam;
+        category = categoryParam;
+        start    = cTrace::Now();
+    }
+
+    ~cTraceSpan() {
+        if (start >= 0) cTrace::Add(name, category, start, cTrace::Now() - start);
+    }
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cTraceSpan(const cTraceSpan &origin) {
+        name     = origin.name;
+        category = origin.category;
+        start    = -1;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cTraceSpan &operator =(const cTraceSpan *origin) {
+        name     = origin->name;
+        category = origin->category;
+        start    = -1;
+        return *this;
+    };
+
+private:
+    const char *name     = nullptr;  //!< span name
+    //!<
+    const char *category = nullptr;  //!< span category
+    //!<
+    int64_t start        = -1;       //!< start in us, -1 if span is not recorded
+    //!<
+};
+#endif
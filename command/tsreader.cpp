@@ -0,0 +1,361 @@
+/*
+ * tsreader.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#ifdef WINDOWS
+#include "win32/mingw64.h"
+#endif
+#include "tsreader.h"
+
+
+cTsReader::cTsReader(const char *recDir, const bool dropCacheParam) {
+    if (!recDir) return;
+    if (asprintf(&recordingDir, "%s", recDir) == -1) {
+        esyslog("cTsReader::cTsReader(): failed to allocate string, out of memory");
+        return;
+    }
+    ALLOC(strlen(recordingDir) + 1, "recordingDir");
+    dropCache = dropCacheParam;
+}
+
+
+cTsReader::~cTsReader() {
+    StopThread();
+    if (avioContext) {
+        FREE(TSREADER_BUFFER_SIZE, "avioContext->buffer");
+        av_freep(&avioContext->buffer);  // buffer can be reallocated by libavformat, free current one
+        FREE(sizeof(*avioContext), "avioContext");
+        avio_context_free(&avioContext);
+    }
+    if (fd >= 0) close(fd);
+    if (recordingDir) {
+        FREE(strlen(recordingDir) + 1, "recordingDir");
+        free(recordingDir);
+    }
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond);
+}
+
+
+AVIOContext *cTsReader::Open() {
+    if (!recordingDir) return nullptr;
+    if (avioContext)   return avioContext;
+
+    if (!OpenFile(1)) return nullptr;
+
+    uchar *buffer = static_cast<uchar *>(av_malloc(TSREADER_BUFFER_SIZE));
+    if (!buffer) {
+        esyslog("cTsReader::Open(): failed to allocate AVIO buffer");
+        return nullptr;
+    }
+    ALLOC(TSREADER_BUFFER_SIZE, "avioContext->buffer");
+
+    avioContext = avio_alloc_context(buffer, TSREADER_BUFFER_SIZE, 0, this, ReadCallback, nullptr, SeekCallback);
+    if (!avioContext) {
+        esyslog("cTsReader::Open(): failed to allocate AVIO context");
+        FREE(TSREADER_BUFFER_SIZE, "avioContext->buffer");
+        av_free(buffer);
+        return nullptr;
+    }
+    ALLOC(sizeof(*avioContext), "avioContext");
+    // do not announce seek support to libavformat, otherwise stream info detection reads end of last file
+    // to estimate duration, seek callback is used only on explicit avio_seek()
+    avioContext->seekable = 0;
+
+    if (pthread_create(&readAheadThread, nullptr, ReadAheadThread, this) == 0) threadRunning = true;
+    else esyslog("cTsReader::Open(): failed to create readahead thread, continue without readahead");
+    Hint();
+
+    dsyslog("cTsReader::Open(): AVIO buffer size %d KiB, readahead %d MiB, %s page cache", TSREADER_BUFFER_SIZE / 1024, TSREADER_READAHEAD / 1024 / 1024, (dropCache) ? "drop" : "keep");
+    return avioContext;
+}
+
+
+int cTsReader::GetFileNumber(const int64_t pos) const {
+    if (pos < 0) return 0;
+    // file start positions are ascending, search from last file, usually we are there
+    for (int i = static_cast<int>(fileStart.size()) - 1; i >= 0; i--) {
+        if (pos >= fileStart[i]) return i + 1;
+    }
+    return 0;
+}
+
+
+int cTsReader::GetMaxFileNumber() const {
+    return fileStart.size();
+}
+
+
+int64_t cTsReader::FileSize(const int number) const {
+    if (!recordingDir) return -1;
+    char *filename = nullptr;
+    if (asprintf(&filename, "%s/%05i.ts", recordingDir, number) == -1) {
+        esyslog("cTsReader::FileSize(): failed to allocate string, out of memory");
+        return -1;
+    }
+    ALLOC(strlen(filename) + 1, "filename");
+    struct stat statbuf;
+    int64_t size = -1;
+    if (stat(filename, &statbuf) == 0) size = statbuf.st_size;
+    FREE(strlen(filename) + 1, "filename");
+    free(filename);
+    return size;
+}
+
+
+int64_t cTsReader::GetFileStart(const int number) {
+    if (number < 1) return -1;
+    if (number <= static_cast<int>(fileStart.size())) return fileStart[number - 1];
+    // file not yet opened, calculate from size of files before, all of them are complete
+    int64_t start = fileStart.empty() ? 0 : fileStart.back();
+    for (int i = (fileStart.empty() ? 1 : static_cast<int>(fileStart.size())); i < number; i++) {
+        int64_t size = FileSize(i);
+        if (size < 0) return -1;
+        start += size;
+    }
+    if (FileSize(number) < 0) return -1;
+    return start;
+}
+
+
+void cTsReader::SetSeekable(const bool seekable) {
+    if (!avioContext) return;
+    avioContext->seekable = (seekable) ? AVIO_SEEKABLE_NORMAL : 0;
+    dsyslog("cTsReader::SetSeekable(): seek %s", (seekable) ? "enabled" : "disabled");
+}
+
+
+bool cTsReader::OpenFile(const int number) {
+    if (number > 1000) return false;  // limit for max ts files per recording
+    char *filename = nullptr;
+    if (asprintf(&filename, "%s/%05i.ts", recordingDir, number) == -1) {
+        esyslog("cTsReader::OpenFile(): failed to allocate string, out of memory");
+        return false;
+    }
+    ALLOC(strlen(filename) + 1, "filename");
+
+    int newFd = open(filename, O_RDONLY);
+    if (newFd < 0) {
+        dsyslog("cTsReader::OpenFile(): file %s does not exists", filename);
+        FREE(strlen(filename) + 1, "filename");
+        free(filename);
+        return false;
+    }
+#ifdef POSIX
+    posix_fadvise(newFd, 0, 0, POSIX_FADV_SEQUENTIAL);  // double kernel readahead window
+#endif
+    dsyslog("cTsReader::OpenFile(): opened file %s", filename);
+    FREE(strlen(filename) + 1, "filename");
+    free(filename);
+
+    // store start position of file in logical stream
+    int64_t start = GetFileStart(number);
+    if (start < 0) start = 0;
+    if (number > static_cast<int>(fileStart.size())) {
+        for (int i = static_cast<int>(fileStart.size()) + 1; i < number; i++) fileStart.push_back(GetFileStart(i));
+        fileStart.push_back(start);
+    }
+
+    if (fd >= 0) close(fd);
+    fd         = newFd;
+    fileNumber = number;
+    filePos    = 0;
+    hintPos    = 0;
+
+    // give readahead thread the new file
+    pthread_mutex_lock(&mutex);
+    if (requestFd >= 0) close(requestFd);
+    requestFd         = dup(fd);
+    requestFileNumber = fileNumber;
+    requestPos        = -1;
+    requestDrop       = 0;
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+
+int cTsReader::ReadCallback(void *opaque, uint8_t *buf, int bufSize) {
+    cTsReader *reader = static_cast<cTsReader *>(opaque);
+    return reader->Read(buf, bufSize);
+}
+
+
+int64_t cTsReader::SeekCallback(void *opaque, int64_t offset, int whence) {
+    cTsReader *reader = static_cast<cTsReader *>(opaque);
+    return reader->Seek(offset, whence);
+}
+
+
+int cTsReader::Read(uint8_t *buf, int bufSize) {
+    if (fd < 0) return AVERROR_EOF;
+    while (true) {
+        ssize_t bytes = read(fd, buf, bufSize);
+        if (bytes > 0) {
+            filePos += bytes;
+            if (filePos >= (hintPos + TSREADER_READAHEAD / 2)) Hint();
+            return bytes;
+        }
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            esyslog("cTsReader::Read(): read from file %05i.ts failed, errno %d", fileNumber, errno);
+            return AVERROR(errno);
+        }
+        // end of current file, continue with next file without notice to libavformat
+        if (!OpenFile(fileNumber + 1)) {
+            dsyslog("cTsReader::Read(): end of last file %05i.ts reached", fileNumber);
+            return AVERROR_EOF;
+        }
+        Hint();
+    }
+}
+
+
+int64_t cTsReader::Seek(int64_t offset, int whence) {
+    int64_t currentPos = ((fileNumber > 0) ? fileStart[fileNumber - 1] : 0) + filePos;
+    int64_t newPos     = 0;
+
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE: {
+        int64_t size = 0;
+        for (int number = 1; ; number++) {
+            int64_t fileSize = FileSize(number);
+            if (fileSize < 0) break;
+            size += fileSize;
+        }
+        return size;
+    }
+    case SEEK_SET:
+        newPos = offset;
+        break;
+    case SEEK_CUR:
+        newPos = currentPos + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (newPos < 0) return AVERROR(EINVAL);
+
+    // find ts file of new position
+    int number = 1;
+    while (true) {
+        int64_t nextStart = GetFileStart(number + 1);
+        if ((nextStart < 0) || (newPos < nextStart)) break;
+        number++;
+    }
+    if ((number != fileNumber) && !OpenFile(number)) return AVERROR(EIO);
+    int64_t pos = newPos - fileStart[number - 1];
+    if (lseek(fd, pos, SEEK_SET) < 0) return AVERROR(errno);
+    filePos = pos;
+    hintPos = pos;
+    Hint();
+    return newPos;
+}
+
+
+void cTsReader::Hint() {
+    if (!threadRunning) return;
+    pthread_mutex_lock(&mutex);
+    requestPos        = filePos;
+    requestFileNumber = fileNumber;
+    // keep last readahead window in cache, libavformat can seek back inside AVIO buffer
+    if (dropCache && (filePos > TSREADER_READAHEAD)) requestDrop = filePos - TSREADER_READAHEAD;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+    hintPos = filePos;
+}
+
+
+void *cTsReader::ReadAheadThread(void *reader) {
+    cTsReader *tsReader = static_cast<cTsReader *>(reader);
+    int64_t dropped     = 0;
+    int droppedFile     = 0;
+
+    pthread_mutex_lock(&tsReader->mutex);
+    while (!tsReader->threadStop) {
+        if ((tsReader->requestPos < 0) || (tsReader->requestFd < 0)) {
+            pthread_cond_wait(&tsReader->cond, &tsReader->mutex);
+            continue;
+        }
+        // take request, fadvise can block for some time, do not hold the lock
+        int requestFd      = dup(tsReader->requestFd);
+        int number         = tsReader->requestFileNumber;
+        int64_t pos        = tsReader->requestPos;
+        int64_t drop       = tsReader->requestDrop;
+        tsReader->requestPos = -1;
+        pthread_mutex_unlock(&tsReader->mutex);
+
+        if (requestFd >= 0) {
+#ifdef POSIX
+            posix_fadvise(requestFd, pos, TSREADER_READAHEAD, POSIX_FADV_WILLNEED);
+            if (number != droppedFile) {
+                droppedFile = number;
+                dropped     = 0;
+            }
+            if (drop > dropped) {
+                posix_fadvise(requestFd, dropped, drop - dropped, POSIX_FADV_DONTNEED);
+                dropped = drop;
+            }
+            // near end of file, start readahead of next file
+            struct stat statbuf;
+            if ((fstat(requestFd, &statbuf) == 0) && ((pos + TSREADER_READAHEAD) > statbuf.st_size)) {
+                char *filename = nullptr;
+                if (asprintf(&filename, "%s/%05i.ts", tsReader->recordingDir, number + 1) != -1) {
+                    ALLOC(strlen(filename) + 1, "filename");
+                    int nextFd = open(filename, O_RDONLY);
+                    if (nextFd >= 0) {
+                        posix_fadvise(nextFd, 0, TSREADER_READAHEAD - (statbuf.st_size - pos), POSIX_FADV_WILLNEED);
+                        close(nextFd);
+                    }
+                    FREE(strlen(filename) + 1, "filename");
+                    free(filename);
+                }
+            }
+            // file is completely consumed
+            if (tsReader->dropCache && (number > 1) && (pos == 0)) {
+                char *filename = nullptr;
+                if (asprintf(&filename, "%s/%05i.ts", tsReader->recordingDir, number - 1) != -1) {
+                    ALLOC(strlen(filename) + 1, "filename");
+                    int prevFd = open(filename, O_RDONLY);
+                    if (prevFd >= 0) {
+                        posix_fadvise(prevFd, 0, 0, POSIX_FADV_DONTNEED);
+                        close(prevFd);
+                    }
+                    FREE(strlen(filename) + 1, "filename");
+                    free(filename);
+                }
+            }
+#endif
+            close(requestFd);
+        }
+        pthread_mutex_lock(&tsReader->mutex);
+    }
+    pthread_mutex_unlock(&tsReader->mutex);
+    return nullptr;
+}
+
+
+void cTsReader::StopThread() {
+    if (threadRunning) {
+        pthread_mutex_lock(&mutex);
+        threadStop = true;
+        pthread_cond_signal(&cond);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(readAheadThread, nullptr);
+        threadRunning = false;
+    }
+    if (requestFd >= 0) {
+        close(requestFd);
+        requestFd = -1;
+    }
+}
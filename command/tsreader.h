@@ -0,0 +1,212 @@
+/*
+ * tsreader.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __tsreader_h_
+#define __tsreader_h_
+
+#include <vector>
+#include <pthread.h>
+
+#include "global.h"
+#include "debug.h"
+#include "tools.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+}
+
+
+#define TSREADER_BUFFER_SIZE  (1024 * 1024)        // size of AVIO buffer, default AVIO buffer is only 32 KiB
+#define TSREADER_READAHEAD    (32 * 1024 * 1024)   // size of readahead window in front of current read position
+
+
+/**
+ * input layer for a VDR recording
+ * presents all ts files of a recording (00001.ts ... 000NN.ts) as one logical stream to libavformat,
+ * so decoder has not to re-open and re-probe input at each file boundary <br>
+ * a background thread gives the kernel readahead hints for the data in front of the read position
+ * and optional drops already consumed pages from page cache
+ */
+class cTsReader : private cTools {
+public:
+
+    /**
+     * cTsReader constructor
+     * @param recDir         recording directory
+     * @param dropCacheParam true to drop consumed pages from page cache
+     */
+    cTsReader(const char *recDir, const bool dropCacheParam);
+
+    ~cTsReader();
+
+    /**
+     * copy constructor, not used, only for formal reason
+     */
+    cTsReader(const cTsReader &origin) {
+        recordingDir      = nullptr;
+        dropCache         = origin.dropCache;
+        avioContext       = nullptr;
+        fd                = -1;
+        fileNumber        = 0;
+        filePos           = 0;
+        fileStart         = {};
+        hintPos           = 0;
+        threadRunning     = false;
+        threadStop        = false;
+        requestFd         = -1;
+        requestFileNumber = 0;
+        requestPos        = -1;
+        requestDrop       = 0;
+    };
+
+    /**
+     * operator=, not used, only for formal reason
+     */
+    cTsReader &operator =(const cTsReader *origin) {
+        recordingDir      = nullptr;
+        dropCache         = origin->dropCache;
+        avioContext       = nullptr;
+        fd                = -1;
+        fileNumber        = 0;
+        filePos           = 0;
+        fileStart         = {};
+        hintPos           = 0;
+        threadRunning     = false;
+        threadStop        = false;
+        requestFd         = -1;
+        requestFileNumber = 0;
+        requestPos        = -1;
+        requestDrop       = 0;
+        return *this;
+    };
+
+    /**
+     * open first ts file of recording and create AVIO context
+     * @return AVIO context to use as AVFormatContext->pb, nullptr on error
+     */
+    AVIOContext *Open();
+
+    /**
+     * get number of ts file from byte position in logical stream (e.g. AVPacket->pos)
+     * @param pos byte position in logical stream
+     * @return ts file number, 0 if position is unknown
+     */
+    int GetFileNumber(const int64_t pos) const;
+
+    /**
+     * get highest opened ts file number
+     * @return ts file number
+     */
+    int GetMaxFileNumber() const;
+
+    /**
+     * get start position of ts file in logical stream
+     * @param number ts file number
+     * @return byte position of first byte of ts file, -1 if file does not exist
+     */
+    int64_t GetFileStart(const int number);
+
+    /**
+     * announce seek support to libavformat
+     * call this after stream info detection to allow byte based seek with av_seek_frame()
+     * @param seekable true to allow seek, false to read forward only
+     */
+    void SetSeekable(const bool seekable);
+
+private:
+    /**
+     * AVIO read callback
+     */
+    static int ReadCallback(void *opaque, uint8_t *buf, int bufSize);
+
+    /**
+     * AVIO seek callback
+     */
+    static int64_t SeekCallback(void *opaque, int64_t offset, int whence);
+
+    /**
+     * readahead thread
+     */
+    static void *ReadAheadThread(void *reader);
+
+    /**
+     * read data from current ts file, switch to next file at end of file
+     * @param buf     read buffer
+     * @param bufSize size of read buffer
+     * @return number of bytes read, AVERROR_EOF at end of last file
+     */
+    int Read(uint8_t *buf, int bufSize);
+
+    /**
+     * seek in logical stream
+     * @param offset byte offset
+     * @param whence SEEK_SET, SEEK_CUR, SEEK_END or AVSEEK_SIZE
+     * @return new position, size of logical stream for AVSEEK_SIZE, negative on error
+     */
+    int64_t Seek(int64_t offset, int whence);
+
+    /**
+     * open ts file
+     * @param number ts file number
+     * @return true if successful, false otherwise
+     */
+    bool OpenFile(const int number);
+
+    /**
+     * get size of ts file
+     * @param number ts file number
+     * @return size of file in bytes, -1 if file does not exist
+     */
+    int64_t FileSize(const int number) const;
+
+    /**
+     * send readahead request for current read position to readahead thread
+     */
+    void Hint();
+
+    /**
+     * stop readahead thread and close file descriptor of readahead request
+     */
+    void StopThread();
+
+    char *recordingDir            = nullptr;   //!< recording directory
+    //!<
+    bool dropCache                = false;     //!< true if we drop consumed pages from page cache
+    //!<
+    AVIOContext *avioContext      = nullptr;   //!< AVIO context of logical stream
+    //!<
+    int fd                        = -1;        //!< file descriptor of current ts file
+    //!<
+    int fileNumber                = 0;         //!< number of current ts file
+    //!<
+    int64_t filePos               = 0;         //!< read position in current ts file
+    //!<
+    std::vector<int64_t> fileStart;            //!< start position of each opened ts file in logical stream, index 0 is file 00001.ts
+    //!<
+    int64_t hintPos               = 0;         //!< file position of last readahead request
+    //!<
+    pthread_t readAheadThread     = {};        //!< readahead thread
+    //!<
+    pthread_mutex_t mutex         = PTHREAD_MUTEX_INITIALIZER;   //!< mutex for readahead request
+    //!<
+    pthread_cond_t  cond          = PTHREAD_COND_INITIALIZER;    //!< condition for readahead request
+    //!<
+    bool threadRunning            = false;     //!< true if readahead thread is running
+    //!<
+    bool threadStop               = false;     //!< true if readahead thread has to stop
+    //!<
+    int requestFd                 = -1;        //!< file descriptor of readahead request (duplicate of fd)
+    //!<
+    int requestFileNumber         = 0;         //!< ts file number of readahead request
+    //!<
+    int64_t requestPos            = -1;        //!< file position of readahead request, -1 if no request pending
+    //!<
+    int64_t requestDrop           = 0;         //!< consumed bytes of current file to drop from page cache
+    //!<
+};
+#endif
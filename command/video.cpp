@@ -13,6 +13,8 @@
 
 #include "video.h"
 #include "logo.h"
+#include "integralimage.h"
+#include "trace.h"
 
 // global variables
 extern bool abortNow;
@@ -82,6 +84,7 @@ bool cLogoDetect::LoadLogo() {
         return false;
     }
     Clear( (area.status == LOGO_RESTART) );   // keep restart state
+    reducedPlanes  = false;
     bool foundLogo = false;
 
     // logo name
@@ -144,6 +147,11 @@ bool cLogoDetect::LoadLogo() {
             if (area.mPixel[plane] == 0) area.mPixel[plane] = area.mPixel[0] / 4;
         }
     }
+    // planes were reduced before logo was loaded, e.g. segment detectors with state of main thread
+    if (foundLogo && reducePlanesOnLoad) {
+        reducePlanesOnLoad = false;
+        ReducePlanes();
+    }
     return foundLogo;
 }
 
@@ -228,6 +236,11 @@ int cLogoDetect::GetLogoCorner() const {
 }
 
 
+int cLogoDetect::State() const {
+    return area.status;
+}
+
+
 // reduce brightness and increase contrast
 // return true if we now have a valid detection result
 //
@@ -242,6 +255,9 @@ bool cLogoDetect::ReduceBrightness(const int logo_vmark, int *logo_imark) {
 
 // calculate coorginates for logo black pixel area in logo corner
     if ((logo_xstart == -1) && (logo_xend == -1) && (logo_ystart == -1) && (logo_yend == -1)) {  // have to init
+        // count of black pixel in logo, lines and columns are counted up to a minimum of pixel
+        cIntegralImage integral;
+        if (!integral.Init(area.logo[0], area.logoSize.width, area.logoSize.height)) return false;
         switch (area.logoCorner) {  // logo is usually in the inner part of the logo corner
 #define LOGO_MIN_PIXEL 30  // big enough to get in the main part of the logo
         case TOP_LEFT: {
@@ -250,28 +266,10 @@ bool cLogoDetect::ReduceBrightness(const int logo_vmark, int *logo_imark) {
             logo_yend = yend;
 
             // xstart is first column with pixel in logo area
-            int pixelCount = 0;
-            int column;
-            int line;
-            for (column = 0; column < area.logoSize.width; column++) {
-                for (line = 0; line < area.logoSize.height; line++) {
-                    if (area.logo[0][line * area.logoSize.width + column] == 0) pixelCount++;
-                    if (pixelCount > LOGO_MIN_PIXEL) break;
-                }
-                if (pixelCount > LOGO_MIN_PIXEL) break;
-            }
-            logo_xstart = column;
+            logo_xstart = integral.FirstColumn(0, 0, area.logoSize.width - 1, area.logoSize.height - 1, LOGO_MIN_PIXEL);
 
             // ystart is first line with pixel in logo area
-            pixelCount = 0;
-            for (line = 0; line < area.logoSize.height; line++) {
-                for (column = 0; column < area.logoSize.width; column++) {
-                    if (area.logo[0][line * area.logoSize.width + column] == 0) pixelCount++;
-                    if (pixelCount >= LOGO_MIN_PIXEL) break;
-                }
-                if (pixelCount >= LOGO_MIN_PIXEL) break;
-            }
-            logo_ystart = line;
+            logo_ystart = integral.FirstLine(0, 0, area.logoSize.width - 1, area.logoSize.height - 1, LOGO_MIN_PIXEL - 1);
             break;
         }
         case TOP_RIGHT: {
@@ -280,28 +278,11 @@ bool cLogoDetect::ReduceBrightness(const int logo_vmark, int *logo_imark) {
             logo_yend   = yend;
 
             // xend is last column with pixel in logo area
-            int pixelCount = 0;
-            int column;
-            int line;
-            for (column = area.logoSize.width - 1; column >= 0; column--) {
-                for (line = 0; line < area.logoSize.height; line++) {
-                    if (area.logo[0][line * area.logoSize.width + column] == 0) pixelCount++;
-                    if (pixelCount > LOGO_MIN_PIXEL) break;
-                }
-                if (pixelCount > LOGO_MIN_PIXEL) break;
-            }
+            int column = integral.LastColumn(0, 0, area.logoSize.width - 1, area.logoSize.height - 1, LOGO_MIN_PIXEL);
             logo_xend = xend - (area.logoSize.width - column);
 
             // ystart is first line with pixel in logo area
-            pixelCount = 0;
-            for (line = 0; line < area.logoSize.height; line++) {
-                for (column = 0; column < area.logoSize.width; column++) {
-                    if (area.logo[0][line * area.logoSize.width + column] == 0) pixelCount++;
-                    if (pixelCount >= LOGO_MIN_PIXEL) break;
-                }
-                if (pixelCount >= LOGO_MIN_PIXEL) break;
-            }
-            logo_ystart = line;
+            logo_ystart = integral.FirstLine(0, 0, area.logoSize.width - 1, area.logoSize.height - 1, LOGO_MIN_PIXEL - 1);
             break;
         }
         // TODO: calculate exact coordinates
@@ -1034,7 +1015,13 @@ int cLogoDetect::Detect(int *logoPacketNumber, int64_t *logoFramePTS) {
 
 // disable colored planes
 void cLogoDetect::ReducePlanes() {
+    if (!area.valid[0]) {
+        dsyslog("cLogoDetect::ReducePlanes(): no logo loaded, reduce planes after logo is loaded");
+        reducePlanesOnLoad = true;
+        return;
+    }
     dsyslog("cLogoDetect::ReducePlanes():");
+    reducedPlanes = true;
     for (int plane = 1; plane < PLANES; plane++) {
         area.valid[plane]  = false;
         area.rPixel[plane] = 0;
@@ -1094,6 +1081,11 @@ cSceneChangeDetect::~cSceneChangeDetect() {
 }
 
 
+int cSceneChangeDetect::State() const {
+    return sceneStatus;
+}
+
+
 int cSceneChangeDetect::Process(int *changePacketNumber, int64_t *changeFramePTS) {
     if (!changePacketNumber) return SCENE_ERROR;
     if (!changeFramePTS)     return SCENE_ERROR;
@@ -1282,6 +1274,16 @@ cBlackScreenDetect::cBlackScreenDetect(cDecoder *decoderParam, cCriteria *criter
 }
 
 
+int cBlackScreenDetect::State() const {
+    return blackScreenStatus;
+}
+
+
+int cBlackScreenDetect::LowerBorderState() const {
+    return lowerBorderStatus;
+}
+
+
 void cBlackScreenDetect::Clear() {
     blackScreenStatus = BLACKSCREEN_UNINITIALIZED;
     lowerBorderStatus = BLACKSCREEN_UNINITIALIZED;
@@ -1388,6 +1390,50 @@ int cBlackScreenDetect::Process() {
 }
 
 
+#define CHECKHEIGHT           5  // changed from 8 to 5
+#define NO_HBORDER          200  // internal limit for early loop exit, must be more than BRIGHTNESS_H_MAYBE
+#define IGNORE_EDGE         0.2  // ignore 20% of left and right edge in case of we have vborder
+#define CHECKWIDTH           11  // do not reduce, very small vborder are unreliable to detect, better use logo in this case
+//                                  changed from 10 to 11 because of unreliable detection of very small vborder at Comedy Central
+
+
+/**
+ * sum of brightness of a line without left and right edge
+ * @tparam WIDTH video width, 0 for generic kernel with width from parameter
+ * @param  line  first pixel of line
+ * @param  width video width
+ * @return sum of brightness
+ */
+template<int WIDTH> static int HBorderLineSum(const uchar *line, const int width) {
+    // for the specialized widths 20% of edge are integer, so start and end are compile time constants
+    const int columnStart = (WIDTH > 0) ? (WIDTH / 5)     : static_cast<int>(width * IGNORE_EDGE);
+    const int columnEnd   = (WIDTH > 0) ? (WIDTH * 4 / 5) : static_cast<int>(ceil(width * (1 - IGNORE_EDGE)));
+    int sum = 0;
+    for (int column = columnStart; column < columnEnd; column++) sum += line[column];
+    return sum;
+}
+
+
+/**
+ * sum of brightness of CHECKWIDTH columns over all lines
+ * @tparam HEIGHT   video height, 0 for generic kernel with height from parameter
+ * @param  plane    first pixel of plane 0
+ * @param  lineSize line size of plane 0
+ * @param  height   video height
+ * @param  xStart   first column
+ * @return sum of brightness
+ */
+template<int HEIGHT> static int VBorderColumnSum(const uchar *plane, const int lineSize, const int height, const int xStart) {
+    const int lines = (HEIGHT > 0) ? HEIGHT : height;
+    int sum = 0;
+    for (int y = 0; y < lines; y++) {
+        const uchar *pixel = plane + (y * lineSize) + xStart;
+        for (int x = 0; x < CHECKWIDTH; x++) sum += pixel[x];
+    }
+    return sum;
+}
+
+
 cHorizBorderDetect::cHorizBorderDetect(cDecoder *decoderParam, cIndex *indexParam, cCriteria *criteriaParam) {
     decoder      = decoderParam;
     index        = indexParam;
@@ -1433,9 +1479,6 @@ void cHorizBorderDetect::Clear(const bool isRestart) {
 int cHorizBorderDetect::Process(int *hBorderPacketNumber, int64_t *hBorderFramePTS) {
     if (!hBorderPacketNumber) return HBORDER_ERROR;
     if (!hBorderFramePTS)     return HBORDER_ERROR;
-#define CHECKHEIGHT           5  // changed from 8 to 5
-#define NO_HBORDER          200  // internal limit for early loop exit, must be more than BRIGHTNESS_H_MAYBE
-#define IGNORE_EDGE         0.2  // ignore 20% of left and right edge in case of we have vborder
 
     const sVideoPicture *picture = decoder->GetVideoPicture();
     if (!picture) {  // picture->pts, picture->plane[] and picture->planeLineSize[] was checked by GetVideoPicture()
@@ -1443,6 +1486,34 @@ int cHorizBorderDetect::Process(int *hBorderPacketNumber, int64_t *hBorderFrameP
         return HBORDER_ERROR;
     }
 
+    // select line kernel once for video width
+    if (!lineSum || (kernelWidth != picture->width)) {
+        switch (picture->width) {
+        case  720:
+            lineSum = HBorderLineSum<720>;
+            break;
+        case 1280:
+            lineSum = HBorderLineSum<1280>;
+            break;
+        case 1440:
+            lineSum = HBorderLineSum<1440>;
+            break;
+        case 1920:
+            lineSum = HBorderLineSum<1920>;
+            break;
+        case 3840:
+            lineSum = HBorderLineSum<3840>;
+            break;
+        default:
+            lineSum = HBorderLineSum<0>;
+            break;
+        }
+        kernelWidth   = picture->width;
+        divisorTop    = (CHECKHEIGHT - 1) * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE);
+        divisorBottom = CHECKHEIGHT * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE);
+        dsyslog("cHorizBorderDetect::Process(): use %s line kernel for video width %d", (lineSum == HBorderLineSum<0>) ? "generic" : "specialized", kernelWidth);
+    }
+
     *hBorderPacketNumber = -1;   // packet number from first hborder, otherwise -1
     *hBorderFramePTS     = -1;   // PTS of frame  from first hborder, otherwise -1
     int sumTop           =  0;
@@ -1452,24 +1523,20 @@ int cHorizBorderDetect::Process(int *hBorderPacketNumber, int64_t *hBorderFrameP
 
     // check top border
     for (int line = 1; line < CHECKHEIGHT ; line++) {  // ignore first line, sometimes there are pixel
-        for (int column = picture->width * IGNORE_EDGE; column < picture->width * (1 - IGNORE_EDGE); column++) {  // ignore left and right edge in case of we have vborder
-            sumTop += picture->plane[0][(line * picture->planeLineSize[0] + column)];
-        }
-        valTop = sumTop / ((CHECKHEIGHT - 1) * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE));
+        sumTop += lineSum(picture->plane[0] + (line * picture->planeLineSize[0]), picture->width);  // ignore left and right edge in case of we have vborder
+        valTop = sumTop / divisorTop;
         if (valTop > brightnessMaybe) break;
     }
-    valTop = sumTop / ((CHECKHEIGHT - 1) * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE));
+    valTop = sumTop / divisorTop;
 
     // check bottom border
     if (valTop <= brightnessMaybe) {
         for (int line = picture->height - CHECKHEIGHT; line < picture->height; line++) {
-            for (int column =  picture->width * IGNORE_EDGE; column < picture->width * (1 - IGNORE_EDGE); column++) {  // ignore left and right edge in case of we have vborder
-                sumBottom += picture->plane[0][(line * picture->planeLineSize[0] + column)];
-            }
-            valBottom = sumBottom / (CHECKHEIGHT * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE));
+            sumBottom += lineSum(picture->plane[0] + (line * picture->planeLineSize[0]), picture->width);  // ignore left and right edge in case of we have vborder
+            valBottom = sumBottom / divisorBottom;
             if (valBottom > brightnessMaybe) break;
         }
-        valBottom = sumBottom / (CHECKHEIGHT * picture->width * (1 - IGNORE_EDGE) * (1 - IGNORE_EDGE));
+        valBottom = sumBottom / divisorBottom;
     }
     else valBottom = NO_HBORDER;   // we have no top border, so we do not have to calculate bottom border
 
@@ -1570,6 +1637,11 @@ int cVertBorderDetect::GetFirstBorderFrame() const {
 }
 
 
+int cVertBorderDetect::State() const {
+    return borderstatus;
+}
+
+
 int cVertBorderDetect::Process(int *vBorderPacketNumber, int64_t *vBorderFramePTS) {
     if (!vBorderPacketNumber) {
         esyslog("cVertBorderDetect::Process(): packet (%d): vBorderPacketNumber not valid", decoder->GetPacketNumber());
@@ -1595,8 +1667,6 @@ int cVertBorderDetect::Process(int *vBorderPacketNumber, int64_t *vBorderFramePT
         dsyslog("cVertBorderDetect::Process(): packet (%d): picture not valid", decoder->GetPacketNumber());
         return VBORDER_ERROR;
     }
-#define CHECKWIDTH 11           // do not reduce, very small vborder are unreliable to detect, better use logo in this case
-    //                             changed from 10 to 11 because of unreliable detection of very small vborder at Comedy Central
 #define BRIGHTNESS_V_SURE   27  // changed from 33 to 27, some channels has dark separator before vborder start
 #define BRIGHTNESS_V_MAYBE 101  // some channel have logo or infos in one border, so we must accept a higher value, changed from 100 to 101
     // set limits
@@ -1605,30 +1675,40 @@ int cVertBorderDetect::Process(int *vBorderPacketNumber, int64_t *vBorderFramePT
     int brightnessMaybe = BRIGHTNESS_V_SURE;
     if (infoInBorder) brightnessMaybe = BRIGHTNESS_V_MAYBE;    // for pixel from info in border
 
+    // select column kernel once for video height
+    if (!columnSum || (kernelHeight != picture->height)) {
+        switch (picture->height) {
+        case  576:
+            columnSum = VBorderColumnSum<576>;
+            break;
+        case  720:
+            columnSum = VBorderColumnSum<720>;
+            break;
+        case 1080:
+            columnSum = VBorderColumnSum<1080>;
+            break;
+        case 2160:
+            columnSum = VBorderColumnSum<2160>;
+            break;
+        default:
+            columnSum = VBorderColumnSum<0>;
+            break;
+        }
+        kernelHeight = picture->height;
+        dsyslog("cVertBorderDetect::Process(): use %s column kernel for video height %d", (columnSum == VBorderColumnSum<0>) ? "generic" : "specialized", kernelHeight);
+    }
+
     int valLeft          =  0;
     int valRight         =  0;
-    int cnt              =  0;
-
+    int cnt              =  CHECKWIDTH * picture->height;
+    if (cnt <= 0) return VBORDER_ERROR;
 
     // check left border
-    for (int y = 0; y < picture->height; y++) {
-        for (int x = 0; x < CHECKWIDTH; x++) {
-            valLeft += picture->plane[0][x + (y * picture->planeLineSize[0])];
-            cnt++;
-        }
-    }
-    valLeft /= cnt;
+    valLeft = columnSum(picture->plane[0], picture->planeLineSize[0], picture->height, 0) / cnt;
 
     // check right border
     if (valLeft <= brightnessMaybe) {
-        cnt = 0;
-        for (int y = 0; y < picture->height; y++) {
-            for (int x = picture->width - CHECKWIDTH; x < picture->width; x++) {
-                valRight += picture->plane[0][x + (y * picture->planeLineSize[0])];
-                cnt++;
-            }
-        }
-        valRight /= cnt;
+        valRight = columnSum(picture->plane[0], picture->planeLineSize[0], picture->height, picture->width - CHECKWIDTH) / cnt;
     }
     else valRight = INT_MAX;  // left side has no border, so we have not to check right side
 
@@ -1805,6 +1885,19 @@ void cVideo::SetAspectRatioBroadcast(sAspectRatio aspectRatio) {
 }
 
 
+void cVideo::GetState(sDetectorState *state) const {
+    if (!state) return;
+    state->logo          = logoDetect->State();
+    state->scene         = sceneChangeDetect->State();
+    state->blackScreen   = blackScreenDetect->State();
+    state->lowerBorder   = blackScreenDetect->LowerBorderState();
+    state->hBorder       = hBorderDetect->State();
+    state->vBorder       = vBorderDetect->State();
+    state->aspectRatio   = aspectRatioFrameBefore;
+    state->reducedPlanes = logoDetect->IsReducedPlanes();
+}
+
+
 sMarkAdMarks *cVideo::Process() {
     int64_t framePTS = decoder->GetFramePTS();
     if (framePTS == AV_NOPTS_VALUE) return nullptr;    // current frame invalid or not yet decoded
@@ -1814,6 +1907,7 @@ sMarkAdMarks *cVideo::Process() {
 
     // scene change detection
     if (criteria->GetDetectionState(MT_SCENECHANGE)) {
+        cTraceSpan trace("SceneChangeDetect", "video");
         int scenePacketNumber = -1;
         int64_t scenePTS      = -1;
         int sceneRet = sceneChangeDetect->Process(&scenePacketNumber, &scenePTS);
@@ -1823,6 +1917,7 @@ sMarkAdMarks *cVideo::Process() {
 
     // black screen change detection
     if ((packetNumber > 0) && criteria->GetDetectionState(MT_BLACKCHANGE)) { // first frame can be invalid result
+        cTraceSpan trace("BlackScreenDetect", "video");
         int blackret = blackScreenDetect->Process();
         switch (blackret) {
         case BLACKSCREEN_INVISIBLE:
@@ -1844,6 +1939,7 @@ sMarkAdMarks *cVideo::Process() {
 
     // hborder change detection
     if (criteria->GetDetectionState(MT_HBORDERCHANGE)) {
+        cTraceSpan trace("HorizBorderDetect", "video");
         int hBorderPacketNumber = -1;
         int64_t hBorderFramePTS = -1;
         int hret = hBorderDetect->Process(&hBorderPacketNumber, &hBorderFramePTS);  // we get start frame of hborder back
@@ -1859,6 +1955,7 @@ sMarkAdMarks *cVideo::Process() {
 
     // vborder change detection
     if (criteria->GetDetectionState(MT_VBORDERCHANGE)) {
+        cTraceSpan trace("VertBorderDetect", "video");
         int vBorderPacketNumber = -1;
         int64_t vBorderFramePTS = -1;;
         int vret = vBorderDetect->Process(&vBorderPacketNumber, &vBorderFramePTS);
@@ -1905,6 +2002,7 @@ sMarkAdMarks *cVideo::Process() {
 
     // logo change detection
     if (criteria->GetDetectionState(MT_LOGOCHANGE)) {
+        cTraceSpan trace("LogoDetect", "video");
         int logoPacketNumber = -1;
         int64_t logoFramePTS = -1;
         int lret = logoDetect->Process(&logoPacketNumber, &logoFramePTS);
@@ -139,6 +139,8 @@ public:
         decoder            = origin.decoder;
         packetNumberBefore = origin.packetNumberBefore;
         framePTSBefore     = origin.framePTSBefore;
+        reducedPlanes      = origin.reducedPlanes;
+        reducePlanesOnLoad = origin.reducePlanesOnLoad;
     }
 
     /**
@@ -160,6 +162,8 @@ public:
         decoder            = origin->decoder;
         packetNumberBefore = origin->packetNumberBefore;
         framePTSBefore     = origin->framePTSBefore;
+        reducedPlanes      = origin->reducedPlanes;
+        reducePlanesOnLoad = origin->reducePlanesOnLoad;
         return *this;
     }
 
@@ -169,6 +173,20 @@ public:
      */
     int GetLogoCorner() const;
 
+    /**
+     * check if logo detection is reduced to plane 0
+     * @return true if planes are reduced or will be reduced after logo is loaded
+     */
+    bool IsReducedPlanes() const {
+        return reducedPlanes || reducePlanesOnLoad;
+    }
+
+    /**
+     * get logo detection status
+     * @return logo detection status
+     */
+    int State() const;
+
     /**
      * detect logo status
      * @param[out] logoPacketNumber packet number of logo change
@@ -178,7 +196,7 @@ public:
     int Detect(int *logoPacketNumber, int64_t *logoFramePTS);
 
     /**
-     * reduce used logo planes to plane 0
+     * reduce used logo planes to plane 0, if no logo is loaded yet, reduce after logo is loaded
      */
     void ReducePlanes();
 
@@ -271,6 +289,10 @@ private:
     //!<
     int64_t framePTSBefore            = -1;       //!< frame PTS before
     //!<
+    bool reducedPlanes                = false;    //!< true if logo detection is reduced to plane 0
+    //!<
+    bool reducePlanesOnLoad           = false;    //!< true if planes have to be reduced as soon as logo is loaded
+    //!<
     const char *aCorner[CORNERS] = { "TOP_LEFT", "TOP_RIGHT", "BOTTOM_LEFT", "BOTTOM_RIGHT" }; //!< array to transform enum corner to text
     //!<
 };
@@ -331,6 +353,12 @@ public:
      */
     int Process(int *changePacketNumber, int64_t *changeFramePTS);
 
+    /**
+     * get scene change detection status
+     * @return scene change detection status
+     */
+    int State() const;
+
 private:
     cDecoder *decoder     = nullptr;               //!< pointer to decoder
     //!<
@@ -373,6 +401,18 @@ public:
      */
     int Process();
 
+    /**
+     * get black screen detection status
+     * @return black screen detection status
+     */
+    int State() const;
+
+    /**
+     * get lower border detection status
+     * @return lower border detection status
+     */
+    int LowerBorderState() const;
+
     /**
      * clear blackscreen detection status
      */
@@ -453,6 +493,14 @@ private:
     int64_t hBorderStartFramePTS = -1;                    //!< frame PTS of detected horizontal border
     //!<
     bool valid                   = false;                 //!< true if we found hborder in bright picture
+    //!<
+    int (*lineSum)(const uchar *line, const int width) = nullptr;  //!< line brightness kernel, specialized for video width
+    //!<
+    int kernelWidth              = 0;                     //!< video width of selected line kernel
+    //!<
+    double divisorTop            = 1;                     //!< pixel count of checked top lines
+    //!<
+    double divisorBottom         = 1;                     //!< pixel count of checked bottom lines
 };
 
 
@@ -484,6 +532,11 @@ public:
      */
     int Process(int *vBorderPacketNumber, int64_t *vBorderFramePTS);
 
+    /**
+     * get vertical border detection status
+     * @return border detection status
+     */
+    int State() const;
 
     /**
      * clear vertical border detection status
@@ -511,6 +564,10 @@ private:
     //!<
     bool valid                   = false;                  //!< first vborder frame, but need to check, because of dark picture
     //!<
+    int (*columnSum)(const uchar *plane, const int lineSize, const int height, const int xStart) = nullptr;  //!< column brightness kernel, specialized for video height
+    //!<
+    int kernelHeight             = 0;                      //!< video height of selected column kernel
+    //!<
 };
 
 
@@ -605,6 +662,12 @@ public:
      */
     void SetAspectRatioBroadcast(sAspectRatio aspectRatio);
 
+    /**
+     * get state of all video detectors
+     * @param[out] state detector state, audio part is not changed
+     */
+    void GetState(sDetectorState *state) const;
+
 private:
 
     /**
@@ -44,6 +44,7 @@ cPluginMarkAd::cPluginMarkAd(void) {
     setup.LogoOnly          = true;
     setup.DeferredShutdown  = true;
     setup.hwaccel           = 0;
+    setup.checkpoint        = false;
 }
 
 
@@ -219,12 +220,20 @@ void cPluginMarkAd::Stop(void) {
 }
 
 
+void cPluginMarkAd::MainThreadHook(void) {
+    // start queued markad and collect finished markad, Housekeeping is not called during recordings
+    if (statusMonitor) statusMonitor->Schedule(false);
+}
+
+
 void cPluginMarkAd::Housekeeping(void) {
     // Perform any cleanup or other regular tasks.
     // looks like only called if no recording is running, but that's enough to keep track of whether all the marks have been completed
     // DebugLog("cPluginMarkAd::Housekeeping(): called");
     // refresh markad status
     if (setup.ProcessDuring != PROCESS_NEVER) statusMonitor->RefreshStatus();
+    // extract missing logos of channels with upcoming timers
+    if (statusMonitor) statusMonitor->PrepareLogos();
 }
 
 
@@ -274,6 +283,8 @@ bool cPluginMarkAd::SetupParse(const char *Name, const char *Value) {
     else if (!strcasecmp(Name,"AutoLogoExtraction")) setup.autoLogoMenu      = atoi(Value);
     else if (!strcasecmp(Name,"FullDecode"))         setup.fulldecode        = atoi(Value);
     else if (!strcasecmp(Name,"hwaccel"))            setup.hwaccel           = atoi(Value);
+    else if (!strcasecmp(Name,"MaxJobs"))            setup.maxJobs           = atoi(Value);
+    else if (!strcasecmp(Name,"Checkpoint"))         setup.checkpoint        = atoi(Value);
     else return false;
 
     if (setup.verbosePlugin) logLevel = 3;
@@ -27,6 +27,8 @@ cSetupMarkAd::cSetupMarkAd(struct setup *Setup) {
     autologomenu      = setup->autoLogoMenu;
     fulldecode        = setup->fulldecode;
     hwaccel           = setup->hwaccel;
+    maxjobs           = setup->maxJobs;
+    checkpoint        = setup->checkpoint;
 
     processTexts[PROCESS_AFTER]  = tr("after");
     processTexts[PROCESS_DURING] = tr("during");
@@ -53,6 +55,7 @@ void cSetupMarkAd::write(void) {
     if (processduring < PROCESS_NEVER) {
         if (!processduring) Add(new cMenuEditBoolItem(tr("during another recording"), &whilerecording));
         Add(new cMenuEditBoolItem(tr("while replaying"), &whilereplaying));
+        Add(new cMenuEditIntItem(tr("max. parallel markad"), &maxjobs, 0, 16, tr("auto")));
         Add(new cMenuEditBoolItem(tr("scan only channels with logo"), &logoonly), true);
         lpos = Current();
         Add(new cMenuEditBoolItem(tr("deferred shutdown"), &deferredshutdown));
@@ -64,6 +67,7 @@ void cSetupMarkAd::write(void) {
         if (setup->autoLogoConf < 0) Add(new cMenuEditStraItem(tr("logo source"), &autologomenu, 3, autoLogoTexts));
         Add(new cMenuEditBoolItem(tr("full decode recording"), &fulldecode));
         Add(new cMenuEditStraItem(tr("hardware acceleration"), &hwaccel, MAX_HWACCEL, setup->hwaccelTexts));
+        Add(new cMenuEditBoolItem(tr("resume after VDR restart"), &checkpoint));
 
         if (current == -1) {
             SetCurrent(first);
@@ -129,6 +133,8 @@ void cSetupMarkAd::Store(void) {
     SetupStore("AutoLogoExtraction", autologomenu);
     SetupStore("FullDecode", fulldecode);
     SetupStore("hwaccel", hwaccel);
+    SetupStore("MaxJobs", maxjobs);
+    SetupStore("Checkpoint", checkpoint);
 
     setup->ProcessDuring     = static_cast<int>(processduring);
     setup->useVPS            = static_cast<bool>(usevps);
@@ -144,6 +150,8 @@ void cSetupMarkAd::Store(void) {
     setup->autoLogoMenu      = static_cast<int>(autologomenu);
     setup->fulldecode        = static_cast<bool>(fulldecode);
     setup->hwaccel           = static_cast<int>(hwaccel);
+    setup->maxJobs           = static_cast<int>(maxjobs);
+    setup->checkpoint        = static_cast<bool>(checkpoint);
     setup->Log2Rec           = log2rec;
     setup->LogoOnly          = logoonly;
 
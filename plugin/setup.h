@@ -38,6 +38,8 @@ struct setup {
     int autoLogoMenu       = 2;
     bool fulldecode        = false;
     int hwaccel            = 0;
+    int maxJobs            = 0;        // max. number of parallel markad, 0 = auto from number of CPUs
+    bool checkpoint        = false;    // markad writes checkpoints and resumes mark detection after VDR restart
     const char *PluginName = nullptr;
 #define MAX_HWACCEL 7
     const char *hwaccelTexts[MAX_HWACCEL] = {tr("off"), "vaapi", "vdpau", "vulkan", "cuda", "drm", "opencl"};
@@ -55,6 +57,8 @@ private:
     int autologomenu             = 0;
     int fulldecode               = 0;
     int hwaccel                  = 0;
+    int maxjobs                  = 0;
+    int checkpoint               = 0;
     int processduring            = 0;
     int usevps                   = 0;
     int logvps                   = 0;
@@ -5,12 +5,89 @@
  *
  */
 
+#include <algorithm>
 #include <signal.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <vector>
+#include <vdr/recording.h>
 #include "status.h"
 #include "setup.h"
 #include "debug.h"
 
 
+// cgroup v2 share of markad for each throttle level
+// markad always runs with nice 19 and idle io priority, raise of priority later needs CAP_SYS_NICE
+static const struct sThrottle {
+    int weight;        // cgroup cpu.weight and io.weight, 100 is default
+    int cpuMax;        // cgroup cpu.max in percent of all CPUs, 0 = no limit
+} throttleLevels[THROTTLE_LEVELS] = {
+    {100,  0},   // no recording and no replay
+    { 50,  0},   // one recording or replay
+    { 10, 50}    // more recordings and replays, or markad is not wanted while recording or replaying
+};
+
+
+// channel name as used by markad for logo file names
+static cString LogoChannelName(const char *channelName) {
+    if (!channelName) return "";
+    char cname[256] = {0};
+    strn0cpy(cname, channelName, sizeof(cname));
+    for (char *c = cname; *c; c++) {
+        if ((*c == ' ') || (*c == '.') || (*c == '/')) *c = '_';
+    }
+    return cname;
+}
+
+
+// check if directory contains a logo file of channel
+static bool HasLogo(const char *dirName, const char *cname) {
+    if (!dirName || !cname) return false;
+    DIR *dir = opendir(dirName);
+    if (!dir) return false;
+    cString prefix = cString::sprintf("%s-", cname);
+    bool found     = false;
+    while (struct dirent *entry = readdir(dir)) {
+        if (startswith(entry->d_name, *prefix) && endswith(entry->d_name, ".pgm")) {
+            found = true;
+            break;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+
+// copy file, remove incomplete destination on error
+static bool CopyLogoFile(const char *source, const char *destination) {
+    int in = open(source, O_RDONLY);
+    if (in < 0) return false;
+    int out = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    bool ok = true;
+    char buf[4096];
+    ssize_t len = 0;
+    while ((len = read(in, buf, sizeof(buf))) > 0) {
+        if (write(out, buf, len) != len) {
+            ok = false;
+            break;
+        }
+    }
+    if (len < 0) ok = false;
+    close(in);
+    if (close(out) != 0) ok = false;
+    if (!ok) unlink(destination);
+    return ok;
+}
+
+
 cEpgEventLog::cEpgEventLog(const char *recDir) {
     if (!recDir) return;
     char *eventLogName = nullptr;
@@ -649,6 +726,8 @@ cStatusMarkAd::cStatusMarkAd(const char *BinDir, const char *LogoDir, struct set
     logodir = LogoDir;
     actpos = 0;
     memset(&recs, 0, sizeof(recs));
+    for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) recs[i].statusFd = -1;
+    InitCgroup();
 
     DebugLog("cStatusMarkAd::cStatusMarkAd(): create epg event handler");
     epgHandlerMarkad = new cEpgHandlerMarkad(this);     // VDR will free at stop
@@ -656,9 +735,11 @@ cStatusMarkAd::cStatusMarkAd(const char *BinDir, const char *LogoDir, struct set
 
 
 cStatusMarkAd::~cStatusMarkAd() {
+    Pause(false);   // stopped markad can not handle SIGTERM
     for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
         Remove(i, true);
     }
+    RemoveCgroup();
 }
 
 
@@ -678,14 +759,8 @@ bool cStatusMarkAd::Replaying() {
 
 void cStatusMarkAd::Replaying(const cControl *UNUSED(Control), const char *UNUSED(Name), const char *FileName, bool On) {
     DebugLog("cStatusMarkAd::Replaying(): %s playing %s", On ? "start" : "stop", FileName ? FileName : "<nullptr>");
-    if (On) {
-        DebugLog("cStatusMarkAd::Replaying(): replaying started, pause all markad");
-        Pause(nullptr, false);
-    }
-    else {
-        DebugLog("cStatusMarkAd::Replaying(): replaying stopped, continue all markad");
-        Continue(nullptr);
-    }
+    Throttle();
+    if (!On) Schedule(true);
 }
 
 
@@ -744,8 +819,9 @@ bool cStatusMarkAd::Start(const char *Name, const char *FileName, sRecording *re
         ALLOC(strlen(hwaccelOption) + 1, "hwaccelOption");
     }
 
-    cString cmd = cString::sprintf("%s/markad %s%s%s%s%s%s%s%s%s%s%s -l \"%s\" %s \"%s\"",
-                                   bindir,
+    // with checkpoints markad resumes mark detection if it was stopped by VDR restart or kill
+    // markad binary and status pipe are added at launch
+    cString cmd = cString::sprintf("%s%s%s%s%s%s%s%s%s%s%s%s -l \"%s\" %s \"%s\"",
                                    setup->verboseMarkad ? " -v " : "",
                                    setup->OSDMessage ? svdrPortOption : "",
                                    setup->Log2Rec ? " -R " : "",
@@ -757,6 +833,7 @@ bool cStatusMarkAd::Start(const char *Name, const char *FileName, sRecording *re
                                    autoLogoOption ? autoLogoOption : "",
                                    setup->fulldecode ? " --fulldecode " : "",
                                    hwaccelOption ? hwaccelOption : "",
+                                   setup->checkpoint ? " --checkpoint " : "",
                                    logodir,
                                    cmdOption,
                                    FileName);
@@ -773,27 +850,184 @@ bool cStatusMarkAd::Start(const char *Name, const char *FileName, sRecording *re
         free(hwaccelOption);
     }
 
-    usleep(5000000); // wait 5 second to get some bytes of recording
-    DebugLog("cStatusMarkAd::Start(): executing %s", *cmd);
-    if (SystemExec(cmd) != -1) {
-        usleep(1000000); // wait 1 second to start markad
-        int pos = Add(Name, FileName, recording);
-        bool gotPID = getPid(pos); // will set recs[pos].pid
-        DebugLog("cStatusMarkAd::Start(): index: %d, pid: %d, filename: %s, status %c: stored in recording list", pos, recs[pos].pid, FileName ? FileName : "<nullptr>", recs[pos].status);
-        if (gotPID && getStatus(pos)) {
-            if (setup->ProcessDuring == PROCESS_AFTER) {
-                DebugLog("cStatusMarkAd::Start(): recording started with PROCESS_AFTER, pause %s", FileName ? FileName : "<nullptr>");
-                Pause(FileName, true);  // pause anyway, will wake up at end of recording
+    // queue job, markad is started by Schedule() if there is a free slot
+    cMutexLock MutexLock(&jobMutex);
+    int pos = Add(Name, FileName, recording);
+    if (pos < 0) {
+        esyslog("markad: recording list full, failed to queue %s", FileName ? FileName : "<nullptr>");
+        return false;
+    }
+    recs[pos].jobArgs = strdup(*cmd);
+    ALLOC(strlen(recs[pos].jobArgs) + 1, "recs[pos].jobArgs");
+    recs[pos].status    = 'Q';
+    recs[pos].queueTime = time(nullptr);
+    if (recs[pos].timerStopTime > recs[pos].timerStartTime) recs[pos].jobLength = recs[pos].timerStopTime - recs[pos].timerStartTime;
+    else recs[pos].jobLength = static_cast<int>(cIndexFile::GetLength(FileName) / DEFAULTFRAMESPERSECOND);  // started via SVDRP, use length of recording
+    DebugLog("cStatusMarkAd::Start(): index: %d, filename: %s, length %ds, recording active %d: queued", pos, FileName ? FileName : "<nullptr>", recs[pos].jobLength, recs[pos].recordingActive);
+
+    Schedule(true);
+    return true;
+}
+
+
+// start queued markad jobs, highest priority first, as long as we have free slots
+void cStatusMarkAd::Schedule(const bool force) {
+    time_t now = time(nullptr);
+    if (!force && (now == lastSchedule)) return;  // called from main thread loop, once per second is enough
+    lastSchedule = now;
+
+    cMutexLock MutexLock(&jobMutex);
+    // collect completed jobs from status pipe
+    int running = 0;
+    for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
+        if (recs[i].statusFd < 0) continue;
+        if (PollJob(i)) running++;
+    }
+
+    int next = NextJob(now);
+    if (next < 0) return;
+    int slots = JobSlots(running);
+    while ((next >= 0) && (running < slots)) {
+        if (Launch(next)) running++;
+        else {
+            esyslog("markad: failed to start markad for %s", recs[next].fileName ? recs[next].fileName : "<nullptr>");
+            FREE(strlen(recs[next].jobArgs) + 1, "recs[pos].jobArgs");
+            free(recs[next].jobArgs);
+            recs[next].jobArgs = nullptr;
+            recs[next].status  = 0;
+        }
+        next = NextJob(now);
+    }
+    if (next >= 0) DebugLog("cStatusMarkAd::Schedule(): %d of %d markad running, keep %s queued", running, slots, recs[next].fileName ? recs[next].fileName : "<nullptr>");
+}
+
+
+// get queued job with highest priority: jobs of finished recordings first, then shortest recording first, logo preparation last
+int cStatusMarkAd::NextJob(const time_t now) {
+    int next = -1;
+    for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
+        if (!recs[i].jobArgs) continue;
+        if (recs[i].recordingActive) {
+            if (setup->ProcessDuring == PROCESS_AFTER) continue;   // wait for end of recording
+            if ((now - recs[i].queueTime) < 5) continue;            // wait 5 second to get some bytes of recording
+        }
+        if (recs[i].logoJob && (runningRecordings > 0)) continue;   // logo preparation only in idle time
+        if (next >= 0) {
+            if (recs[i].logoJob && !recs[next].logoJob) continue;
+            if (recs[i].logoJob == recs[next].logoJob) {
+                if (recs[i].recordingActive && !recs[next].recordingActive) continue;
+                if (recs[i].recordingActive == recs[next].recordingActive) {
+                    if (recs[i].jobLength > recs[next].jobLength) continue;
+                    if ((recs[i].jobLength == recs[next].jobLength) && (recs[i].queueTime >= recs[next].queueTime)) continue;
+                }
             }
-            else {
-                DebugLog("cStatusMarkAd::Start(): recording started, check if we have to pause all markad");
-                Pause(nullptr, false);  // pause all
+        }
+        next = i;
+    }
+    return next;
+}
+
+
+// get number of markad we can run in parallel
+int cStatusMarkAd::JobSlots(const int running) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    int slots = setup->maxJobs;
+    if (slots <= 0) slots = (cpus + 1) / 2;  // auto: markad decoder uses more than one thread
+    if (slots < 1) slots = 1;
+
+    bool recording = (runningRecordings > 0);
+    bool replaying = Replaying();
+    if (recording && !setup->whileRecording) {
+        DebugLog("cStatusMarkAd::JobSlots(): no markad start during ongoing recordings: %d", runningRecordings);
+        return 0;
+    }
+    if (replaying && !setup->whileReplaying) {
+        DebugLog("cStatusMarkAd::JobSlots(): no markad start during ongoing replaying");
+        return 0;
+    }
+    if (recording || replaying) {
+        // leave CPU and disk bandwidth to VDR
+        slots = (slots + 1) / 2;
+        double load = 0;
+        if ((running > 0) && (getloadavg(&load, 1) == 1) && (load > cpus)) {
+            DebugLog("cStatusMarkAd::JobSlots(): system load %.2f with %ld CPUs, no additional markad start", load, cpus);
+            return running;
+        }
+    }
+    return slots;
+}
+
+
+// start markad for queued job, markad reports pid and gives EOF at exit over status pipe
+bool cStatusMarkAd::Launch(const int pos) {
+    int pipeFd[2] = {-1, -1};
+    if (pipe(pipeFd) == -1) {
+        esyslog("markad: failed to create status pipe, errno %d", errno);
+        return false;
+    }
+    // start with lowest nice and io priority, markad sets it for itself before it creates decoder threads
+    // throttle levels only change the share of the cgroup, a non root VDR can not raise the priority later
+    cString cmd = cString::sprintf("%s/markad --statusfd=%d --priority=19 --ioprio=3 %s", bindir, pipeFd[1], recs[pos].jobArgs);
+    DebugLog("cStatusMarkAd::Launch(): index %d: executing %s", pos, *cmd);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        esyslog("markad: fork failed, errno %d", errno);
+        close(pipeFd[0]);
+        close(pipeFd[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // child, do not inherit VDR file descriptors, only status pipe
+        int maxFd = getdtablesize();
+        for (int i = STDERR_FILENO + 1; i < maxFd; i++) {
+            if (i != pipeFd[1]) close(i);
+        }
+        execl("/bin/sh", "sh", "-c", *cmd, nullptr);
+        _exit(EXIT_FAILURE);
+    }
+    close(pipeFd[1]);
+    fcntl(pipeFd[0], F_SETFL, O_NONBLOCK);
+    fcntl(pipeFd[0], F_SETFD, FD_CLOEXEC);
+
+    isyslog("markad: start: %s", recs[pos].fileName ? recs[pos].fileName : "<nullptr>");
+    recs[pos].statusFd = pipeFd[0];
+    recs[pos].childPid = pid;
+    recs[pos].status   = 'R';
+    FREE(strlen(recs[pos].jobArgs) + 1, "recs[pos].jobArgs");
+    free(recs[pos].jobArgs);
+    recs[pos].jobArgs  = nullptr;
+    return true;
+}
+
+
+// read status pipe of markad job, remove job from list if markad exited
+bool cStatusMarkAd::PollJob(const int pos) {
+    if (recs[pos].statusFd < 0) return false;
+    // reap shell used to start markad, markad itself is running as daemon
+    if ((recs[pos].childPid > 0) && (waitpid(recs[pos].childPid, nullptr, WNOHANG) == recs[pos].childPid)) recs[pos].childPid = 0;
+
+    while (true) {
+        char buf[64] = {0};
+        ssize_t len = read(recs[pos].statusFd, buf, sizeof(buf) - 1);
+        if (len > 0) {
+            int pid = 0;
+            if (sscanf(buf, "pid %10d", &pid) == 1) {
+                recs[pos].pid = pid;
+                DebugLog("cStatusMarkAd::PollJob(): index %d, pid %d, filename %s: markad is running", pos, recs[pos].pid, recs[pos].fileName ? recs[pos].fileName : "<nullptr>");
+                MoveToCgroup(pos);
+                if (jobsPaused && !recs[pos].changedByUser) kill(recs[pos].pid, SIGTSTP);  // started while markad is not wanted
             }
+            continue;
         }
-        else esyslog("markad: cannot find running process");
-        return true;
+        if ((len < 0) && (errno == EINTR)) continue;
+        if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) return true;  // markad still running
+        break;
     }
-    esyslog("markad: failed to start markad");
+    // EOF, markad done or crashed
+    isyslog("markad: end: %s", recs[pos].fileName ? recs[pos].fileName : "<nullptr>");
+    Remove(pos);
     return false;
 }
 
@@ -929,6 +1163,7 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
     if (On) {
         runningRecordings++;
         DebugLog("cStatusMarkAd::Recording():  recording: %s, file name: %s, started, recording count now %d", Name, FileName, runningRecordings);
+        Throttle();
         // check if markad is running for the same recording, this can happen if we have a short recording interuption
         int runningPos = Get(FileName, nullptr);
         if (runningPos >= 0) {
@@ -937,6 +1172,7 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
         }
 
         sRecording recording;
+        recording.recordingActive = true;
         GetEventID(Device, Name, &recording);
         SaveVPSTimer(FileName, recording.timerVPS);
 
@@ -953,14 +1189,13 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
             return; // markad deactivated
         }
 
-        bool autoLogo = false;
-        if (setup->autoLogoConf >= 0) autoLogo = (setup->autoLogoConf > 0);
-        else autoLogo = (setup->autoLogoMenu > 0);
-
+        bool autoLogo = AutoLogo();
         if (!autoLogo && setup->LogoOnly && !LogoExists(Device,FileName)) {   // we can find the logo in the recording
             isyslog("markad: no logo found for %s", Name);
             return;
         }
+        // use logo prepared from former recording of this channel, markad finds it in recording directory
+        if (autoLogo && recording.timerChannelName && !HasLogo(logodir, LogoChannelName(recording.timerChannelName))) CopyLogo(FileName, &recording);
 
         // Start markad with recording
         if (!Start(Name, FileName, &recording)) {
@@ -972,24 +1207,26 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
         runningRecordings--;      // reduce recording counter
         if (runningRecordings < 0) runningRecordings = 0;
         DebugLog("cStatusMarkAd::Recording(): recording stopped, recording count now %d", runningRecordings);
+        Throttle();
         // check if recording is in list
         int pos = Get(FileName, Name);
         if (pos >= 0) {
             DebugLog("cStatusMarkAd::Recording(): index: %d, recording: %s, pid: %d, status: %c recording stopped", pos, recs[pos].title, recs[pos].status, recs[pos].pid);
             if (setup->useVPS) SaveVPSEvents(pos);  // store to get error messages for incomplete sequence
+            recs[pos].recordingActive = false;     // job of a finished recording gets priority
+            Schedule(true);
+            if (recs[pos].status == 'Q') {
+                DebugLog("cStatusMarkAd::Recording(): index: %d, recording: %s, markad still queued", pos, recs[pos].title);
+                return;
+            }
             if ((recs[pos].status == 'R') || (recs[pos].status == 'S')) {
                 DebugLog("cStatusMarkAd::Recording(): index: %d, recording: %s, pid: %d, status: %c markad still running", pos, recs[pos].title, recs[pos].status, recs[pos].pid);
                 return;
             }
-            // check if we have to continue waiting markad
+            // check if we have to remove recording from list
             switch (setup->ProcessDuring) {
             case PROCESS_AFTER:
-                DebugLog("cStatusMarkAd:::Recording(): recording stopped, continue markad for %s", FileName ? FileName : "<nullptr>");
-                Continue(FileName);
-                return;
             case PROCESS_DURING:
-                DebugLog("cStatusMarkAd:::Recording(): recording stopped, continue all markad");
-                Continue(nullptr);
                 return;
             case PROCESS_NEVER:
                 DebugLog("cStatusMarkAd::Recording(): recording: %s, remove from list", recs[pos].title);
@@ -1008,6 +1245,13 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
 }
 
 
+// markad extracts logo from recording if there is no logo in logo cache
+bool cStatusMarkAd::AutoLogo() {
+    if (setup->autoLogoConf >= 0) return (setup->autoLogoConf > 0);
+    return (setup->autoLogoMenu > 0);
+}
+
+
 bool cStatusMarkAd::LogoExists(const cDevice *Device, const char *FileName) {
     if (!FileName) return false;
     if (!Device) return false;
@@ -1105,9 +1349,161 @@ bool cStatusMarkAd::LogoExists(const cDevice *Device, const char *FileName) {
 }
 
 
-// check if markad is running
+// prepare logos of channels with upcoming timers in idle time
+// a missing logo is extracted from newest recording of the channel and copied to the new recording at recording start
+void cStatusMarkAd::PrepareLogos() {
+    if (!bindir || !logodir) return;
+    if (setup->ProcessDuring == PROCESS_NEVER) return;
+    if (!AutoLogo()) return;   // markad uses only logo cache
+    time_t now = time(nullptr);
+    if ((now - lastPrepareLogos) < PREPARE_LOGOS_INTERVAL) return;
+    lastPrepareLogos = now;
+    if ((runningRecordings > 0) || Replaying()) return;
+
+#if APIVERSNUM>=20301  // feature not supported with old VDRs
+    // channels of upcoming timers
+    std::vector<tChannelID> channelIDs;
+    cStringList channelNames;
+    cStateKey StateKey;
+#ifdef DEBUG_LOCKS
+    DebugLog("PrepareLogos(): WANT timers READ");
+#endif
+    if (const cTimers *Timers = cTimers::GetTimersRead(StateKey, LOCK_TIMEOUT)) {
+#ifdef DEBUG_LOCKS
+        DebugLog("PrepareLogos(): LOCKED timers READ");
+#endif
+        for (const cTimer *Timer = Timers->First(); Timer; Timer = Timers->Next(Timer)) {
+            if (!Timer->HasFlags(tfActive) || Timer->Recording()) continue;
+            if ((Timer->StopTime() < now) || (Timer->StartTime() > (now + PREPARE_LOGOS_AHEAD))) continue;
+            const cChannel *channel = Timer->Channel();
+            if (!channel || !channel->Name()) continue;
+            if (std::find(channelIDs.begin(), channelIDs.end(), channel->GetChannelID()) != channelIDs.end()) continue;
+            channelIDs.push_back(channel->GetChannelID());
+            channelNames.Append(strdup(channel->Name()));
+        }
+#ifdef DEBUG_LOCKS
+        DebugLog("PrepareLogos(): UNLOCK timers READ");
+#endif
+        StateKey.Remove();
+    }
+    else {
+        esyslog("markad: cStatusMarkAd::PrepareLogos(): lock timers failed");
+        return;
+    }
+
+    for (unsigned int i = 0; i < channelIDs.size(); i++) {
+        cString cname = LogoChannelName(channelNames[i]);
+        if (HasLogo(logodir, cname)) continue;
+        cString recDir = LogoRecording(channelIDs[i], cname, false);
+        if (!*recDir) {
+            DebugLog("cStatusMarkAd::PrepareLogos(): channel %s: no logo in logo cache and no recording found", channelNames[i]);
+            continue;
+        }
+        if (HasLogo(recDir, cname)) continue;   // logo already extracted
+        if (logoSearched.Find(recDir) >= 0) continue;
+        if (Get(recDir, nullptr) >= 0) continue;  // markad job for this recording
+        if (AddLogoJob(channelNames[i], recDir)) logoSearched.Append(strdup(recDir));
+    }
+#endif
+}
+
+
+// get directory of newest recording of channel, not in use by VDR
+// withLogo: only recordings with extracted logo of this channel in recording directory
+cString cStatusMarkAd::LogoRecording(const tChannelID channelID, const char *cname, const bool withLogo) {
+    cString recDir;
+#if APIVERSNUM>=20301  // feature not supported with old VDRs
+    cStateKey StateKey;
+#ifdef DEBUG_LOCKS
+    DebugLog("LogoRecording(): WANT recordings READ");
+#endif
+    if (const cRecordings *Recordings = cRecordings::GetRecordingsRead(StateKey, LOCK_TIMEOUT)) {
+#ifdef DEBUG_LOCKS
+        DebugLog("LogoRecording(): LOCKED recordings READ");
+#endif
+        time_t newest = 0;
+        for (const cRecording *Recording = Recordings->First(); Recording; Recording = Recordings->Next(Recording)) {
+            if (!Recording->Info() || !(Recording->Info()->ChannelID() == channelID)) continue;
+            if (Recording->Start() <= newest) continue;
+            if (Recording->IsInUse() != ruNone) continue;   // recording, replaying, cutting or moving
+            if (withLogo && !HasLogo(Recording->FileName(), cname)) continue;
+            newest = Recording->Start();
+            recDir = Recording->FileName();
+        }
+#ifdef DEBUG_LOCKS
+        DebugLog("LogoRecording(): UNLOCK recordings READ");
+#endif
+        StateKey.Remove();
+    }
+    else esyslog("markad: cStatusMarkAd::LogoRecording(): lock recordings failed");
+#endif
+    return recDir;
+}
+
+
+// queue markad job to extract logo from an existing recording into its recording directory
+bool cStatusMarkAd::AddLogoJob(const char *channelName, const char *FileName) {
+    if (!channelName || !FileName) return false;
+    // run as daemon with cmd "after", the recording is already complete
+    cString cmd = cString::sprintf("%s%s --searchlogo --autologo=2 -l \"%s\" after \"%s\"",
+                                   setup->verboseMarkad ? " -v " : "",
+                                   setup->LogLevel ? setup->LogLevel : "",
+                                   logodir,
+                                   FileName);
+    cString title = cString::sprintf("logo: %s", channelName);
+
+    cMutexLock MutexLock(&jobMutex);
+    for (int pos = 0; pos < (MAXDEVICES * MAXRECEIVERS); pos++) {
+        if (recs[pos].fileName) continue;
+        recs[pos].fileName = strdup(FileName);
+        ALLOC(strlen(recs[pos].fileName) + 1, "recs[pos].fileName");
+        recs[pos].title = strdup(title);
+        ALLOC(strlen(recs[pos].title) + 1, "recs[pos].title");
+        recs[pos].jobArgs = strdup(cmd);
+        ALLOC(strlen(recs[pos].jobArgs) + 1, "recs[pos].jobArgs");
+        recs[pos].status    = 'Q';
+        recs[pos].queueTime = time(nullptr);
+        recs[pos].logoJob   = true;
+        if (pos > max_recs) max_recs = pos;
+        isyslog("markad: no logo for channel %s in logo cache, queue logo search in %s", channelName, FileName);
+        return true;
+    }
+    DebugLog("cStatusMarkAd::AddLogoJob(): recording list full, no logo search for channel %s", channelName);
+    return false;
+}
+
+
+// copy logo extracted from former recording of same channel to new recording directory
+void cStatusMarkAd::CopyLogo(const char *FileName, const sRecording *recording) {
+    if (!FileName || !recording) return;
+    cString cname  = LogoChannelName(recording->timerChannelName);
+    cString recDir = LogoRecording(recording->timerChannelID, cname, true);
+    if (!*recDir) return;
+
+    DIR *dir = opendir(recDir);
+    if (!dir) return;
+    cString prefix = cString::sprintf("%s-", *cname);
+    int copied     = 0;
+    while (struct dirent *entry = readdir(dir)) {
+        if (!startswith(entry->d_name, *prefix) || !endswith(entry->d_name, ".pgm")) continue;
+        if (CopyLogoFile(*cString::sprintf("%s/%s", *recDir, entry->d_name), *cString::sprintf("%s/%s", FileName, entry->d_name))) copied++;
+        else esyslog("markad: copy logo %s from %s failed", entry->d_name, *recDir);
+    }
+    closedir(dir);
+    if (copied > 0) isyslog("markad: use logo of channel %s from recording %s", recording->timerChannelName, *recDir);
+}
+
+
+// check if markad is running, completion is reported by EOF of status pipe
 bool cStatusMarkAd::getStatus(int Position) {
     if (Position < 0) return false;
+    if ((recs[Position].statusFd >= 0) && !PollJob(Position)) return false;
+    return readProcStatus(Position);
+}
+
+
+// get process state of running markad
+bool cStatusMarkAd::readProcStatus(int Position) {
     if (recs[Position].pid <= 0) return false;
     int ret = 0;
     char procname[256] = "";
@@ -1119,47 +1515,6 @@ bool cStatusMarkAd::getStatus(int Position) {
         DebugLog("pid: %d, status: %c", recs[Position].pid, recs[Position].status);
         fclose(fstat);
     }
-    else {
-        if (errno == ENOENT) {
-            // no such file or directory -> markad done or crashed
-            // remove filename from list
-            isyslog("markad: end: %s", recs[Position].fileName ? recs[Position].fileName : "<nullptr>");
-            Remove(Position);
-        }
-    }
-    return (ret == 1);
-}
-
-
-bool cStatusMarkAd::getPid(int Position) {
-    if (Position < 0) return false;
-    if (!recs[Position].fileName) return false;
-    if (recs[Position].pid) return true;
-    int ret = 0;
-    char *buf;
-    if (asprintf(&buf, "%s/markad.pid", recs[Position].fileName) == -1) return false;
-    ALLOC(strlen(buf)+1, "buf");
-
-    usleep(500*1000);   // wait 500ms to give markad time to create pid file
-    FILE *fpid = fopen(buf,"r");
-    if (fpid) {
-        FREE(strlen(buf)+1, "buf");
-        free(buf);
-        int pid;
-        ret = fscanf(fpid, "%10i\n", &pid);
-        if (ret == 1) recs[Position].pid = pid;
-        fclose(fpid);
-    }
-    else {
-        esyslog("markad: failed to open pid file %s with errno %i", buf, errno);
-        if (errno == ENOENT) {
-            // no such file or directory -> markad done or crashed
-            // remove entry from list
-            Remove(Position);
-        }
-        FREE(strlen(buf)+1, "buf");
-        free(buf);
-    }
     return (ret == 1);
 }
 
@@ -1171,7 +1526,7 @@ bool cStatusMarkAd::GetNextActive(struct sRecording **RecEntry) {
     if (actpos >= (MAXDEVICES*MAXRECEIVERS)) return false;
 
     do {
-        if ((recs[actpos].fileName) && (recs[actpos].pid)) {
+        if ((recs[actpos].fileName) && ((recs[actpos].pid) || (recs[actpos].statusFd >= 0))) {
             if (getStatus(actpos)) {
                 /* check if recording directory still exists */
                 if (access(recs[actpos].fileName, R_OK) == -1) {
@@ -1202,10 +1557,17 @@ bool cStatusMarkAd::MarkAdRunning() {
     ResetActPos();
     bool running = false;
     while (GetNextActive(&tmpRecs)) {
+        if (tmpRecs->logoJob) continue;   // logo preparation can be done later
         if (tmpRecs->title) DebugLog("cStatusMarkAd::MarkAdRunning(): markad is running for recording %s, defer shutdown", tmpRecs->title);
         else                DebugLog("cStatusMarkAd::MarkAdRunning(): markad is running for unknown recording, defer shutdown");
         running = true;
     }
+    for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
+        if (recs[i].jobArgs && !recs[i].logoJob) {
+            DebugLog("cStatusMarkAd::MarkAdRunning(): markad is queued for recording %s, defer shutdown", recs[i].fileName);
+            running = true;
+        }
+    }
     return (running);
 }
 
@@ -1257,8 +1619,14 @@ void cStatusMarkAd::Remove(int pos, bool Kill) {
         free(recs[pos].timerChannelName);
         recs[pos].timerChannelName = nullptr;
     }
-    if ((Kill) && (recs[pos].pid)) {
-        if (getStatus(pos)) {
+    // queued job
+    if (recs[pos].jobArgs) {
+        FREE(strlen(recs[pos].jobArgs) + 1, "recs[pos].jobArgs");
+        free(recs[pos].jobArgs);
+        recs[pos].jobArgs = nullptr;
+    }
+    if ((Kill) && (recs[pos].pid) && (recs[pos].statusFd >= 0)) {
+        if (readProcStatus(pos)) {
             if ((recs[pos].status == 'R') || (recs[pos].status == 'S')) {
                 DebugLog("cStatusMarkAd::Remove(): index %d, pid %d: terminating markad process", pos, recs[pos].pid);
                 isyslog("markad: state -> terminate: %s", recs[pos].fileName ? recs[pos].fileName : "<nullptr>");
@@ -1271,6 +1639,18 @@ void cStatusMarkAd::Remove(int pos, bool Kill) {
             }
         }
     }
+    // running job, status pipe of a killed markad gives no more information
+    if (recs[pos].statusFd >= 0) {
+        close(recs[pos].statusFd);
+        recs[pos].statusFd = -1;
+    }
+    if ((recs[pos].childPid > 0) && (waitpid(recs[pos].childPid, nullptr, WNOHANG) == 0)) {
+        DebugLog("cStatusMarkAd::Remove(): index %d: shell pid %d for markad start still running", pos, recs[pos].childPid);
+    }
+    recs[pos].childPid          = 0;
+    recs[pos].recordingActive   = false;
+    recs[pos].queueTime         = 0;
+    recs[pos].jobLength         = 0;
     recs[pos].status            = 0;
     recs[pos].pid               = 0;
     recs[pos].changedByUser     = false;
@@ -1288,6 +1668,7 @@ void cStatusMarkAd::Remove(int pos, bool Kill) {
     recs[pos].vpsPauseStartTime = 0;
     recs[pos].vpsPauseStopTime  = 0;
     recs[pos].timerVPS          = false;
+    recs[pos].logoJob           = false;
     if (recs[pos].epgEventLog) {
         FREE(sizeof(*(recs[pos].epgEventLog)), "recs[pos].epgEventLog");
         delete recs[pos].epgEventLog;
@@ -1310,7 +1691,7 @@ char *cStatusMarkAd::GetStatus() {
         DebugLog("cStatusMarkAd::GetStatus(): active recording with markad running: %s",recs[pos].fileName);
         char *line = nullptr;
         char *tmp = nullptr;
-        if (asprintf(&line, "markad: running for %s\n", recs[pos].fileName) != -1) {
+        if (asprintf(&line, "markad: %s for %s\n", recs[pos].jobArgs ? "queued" : "running", recs[pos].fileName) != -1) {
             if (asprintf(&tmp, "%s%s", (status) ? status : "", line) != -1) {
                 free(status);
                 free(line);
@@ -1479,65 +1860,113 @@ int cStatusMarkAd::Add(const char *Name, const char *FileName, sRecording *recor
 }
 
 
-void cStatusMarkAd::Pause(const char *FileName, bool force) {
-    DebugLog("cStatusMarkAd::Pause(): filename %s", FileName ? FileName : "<nullptr>");
-    // check if we need to pause
-    if (force || ((!setup->whileRecording) && (runningRecordings > 0)) || ((!setup->whileReplaying) && Replaying())) {
-        for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
-            if (FileName) {
-                if ((recs[i].fileName) && (!strcmp(recs[i].fileName,FileName)) && (recs[i].pid) && (!recs[i].changedByUser)) {
-                    isyslog("markad: pause: %s", recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                    DebugLog("cStatusMarkAd::Pause(): index %d, pid %d, filename %s: pause markad process", i, recs[i].pid, recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                    kill(recs[i].pid, SIGTSTP);
-                }
-            }
-            else {
-                if ((recs[i].pid) && (!recs[i].changedByUser)) {
-                    isyslog("markad: pause: %s", recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                    DebugLog("cStatusMarkAd::Pause(): index %d, pid %d, filename %s: pause markad process", i, recs[i].pid, recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                    kill(recs[i].pid, SIGTSTP);
-                }
-            }
-        }
-    }
-    else {
-        DebugLog("cStatusMarkAd::Pause(): no need for pause, setup->whileRecording: %d, runningRecording: %d, setup->whileReplaying: %d, Replaying: %d", setup->whileRecording, runningRecordings, setup->whileReplaying, Replaying());
-        return;
+// get throttle level of running markad from count of active recordings and replays
+int cStatusMarkAd::ThrottleLevel() {
+    bool replaying = Replaying();
+    if (((runningRecordings > 0) && !setup->whileRecording) || (replaying && !setup->whileReplaying)) return THROTTLE_LEVELS - 1;
+    return std::min(runningRecordings + (replaying ? 1 : 0), THROTTLE_LEVELS - 1);
+}
+
+
+// adjust CPU and io share of all running markad to current count of recordings and replays
+// markad keeps running with reduced share, without cgroup stop and continue with SIGTSTP/SIGCONT
+void cStatusMarkAd::Throttle() {
+    if (!*cgroupDir) Pause(((runningRecordings > 0) && !setup->whileRecording) || (!setup->whileReplaying && Replaying()));
+    int level = ThrottleLevel();
+    if (level == throttleLevel) return;
+    isyslog("markad: change throttle level from %d to %d, recordings %d", throttleLevel, level, runningRecordings);
+    throttleLevel = level;
+    if (!*cgroupDir) return;   // without cgroup markad runs with lowest nice and io priority on all levels
+    const sThrottle *throttle = &throttleLevels[throttleLevel];
+
+    // cgroup limits are valid for all markad in cgroup
+    WriteCgroup("cpu.weight", *cString::sprintf("%d", throttle->weight));
+    WriteCgroup("io.weight", *cString::sprintf("default %d", throttle->weight));
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (throttle->cpuMax > 0) WriteCgroup("cpu.max", *cString::sprintf("%ld 100000", cpus * 1000 * throttle->cpuMax));
+    else WriteCgroup("cpu.max", "max 100000");
+}
+
+
+// stop all markad while they are not wanted during recording or replay and continue them after, used without cgroup
+void cStatusMarkAd::Pause(const bool pause) {
+    if (pause == jobsPaused) return;
+    jobsPaused = pause;
+    for (int i = 0; i < (MAXDEVICES * MAXRECEIVERS); i++) {
+        if ((recs[i].pid <= 0) || recs[i].changedByUser) continue;
+        isyslog("markad: %s: %s", pause ? "pause" : "continue", recs[i].fileName ? recs[i].fileName : "<nullptr>");
+        DebugLog("cStatusMarkAd::Pause(): index %d, pid %d, filename %s: %s markad process", i, recs[i].pid, recs[i].fileName ? recs[i].fileName : "<nullptr>", pause ? "pause" : "resume");
+        kill(recs[i].pid, pause ? SIGTSTP : SIGCONT);
     }
 }
 
 
-void cStatusMarkAd::Continue(const char *FileName) {
-    DebugLog("cStatusMarkAd::Continue(): called with filename %s", FileName ? FileName : "<nullptr>");
-    if ((setup->ProcessDuring == PROCESS_AFTER) && !FileName) {  // no global continue on PROCESS_AFTER, only dedicated per recording
-        DebugLog("cStatusMarkAd::Continue(): ignore continue due to PROCESS_AFTER");
+// move running markad to cgroup of all markad jobs, new threads stay in cgroup
+void cStatusMarkAd::MoveToCgroup(const int pos) {
+    if (recs[pos].pid <= 0) return;
+    if (!*cgroupDir) return;
+    bool ok = WriteCgroup("cgroup.procs", *cString::sprintf("%d", recs[pos].pid));
+    DebugLog("cStatusMarkAd::MoveToCgroup(): index %d, pid %d: move to cgroup %s %s", pos, recs[pos].pid, *cgroupDir, ok ? "successful" : "failed");
+}
+
+
+// use cgroup v2 below cgroup of VDR for all markad, only if cpu controller is enabled for it
+void cStatusMarkAd::InitCgroup() {
+    FILE *file = fopen("/proc/self/cgroup", "r");
+    if (!file) return;
+    char line[512] = {0};
+    char *path     = nullptr;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "0::", 3) == 0) {  // cgroup v2 unified hierarchy
+            path = line + 3;
+            path[strcspn(path, "\n")] = 0;
+            break;
+        }
+    }
+    fclose(file);
+    if (!path) {
+        DebugLog("cStatusMarkAd::InitCgroup(): no cgroup v2 found");
         return;
     }
-
-    // check if it is allowed to continue
-    if ((!setup->whileRecording) && (runningRecordings > 0)) {
-        DebugLog("cStatusMarkAd::Continue(): preventing continuation due to ongoing recordings: %d", runningRecordings);
+    cString dir = cString::sprintf("/sys/fs/cgroup%s/markad", (strcmp(path, "/") == 0) ? "" : path);
+    bool created = (mkdir(*dir, 0755) == 0);
+    if (!created && (errno != EEXIST)) {
+        DebugLog("cStatusMarkAd::InitCgroup(): create cgroup %s failed, errno %d", *dir, errno);
         return;
     }
-    if ((!setup->whileReplaying) && Replaying()) {
-        DebugLog("cStatusMarkAd::Continue(): preventing continuation due to ongoing replaying");
+    if (access(*cString::sprintf("%s/cpu.weight", *dir), W_OK) != 0) {
+        isyslog("markad: cgroup %s has no cpu controller, markad runs with lowest nice and io priority without throttling", *dir);
+        if (created) rmdir(*dir);
         return;
     }
+    cgroupDir = dir;
+    isyslog("markad: use cgroup %s", *cgroupDir);
+}
 
-    for (int i = 0; i < (MAXDEVICES*MAXRECEIVERS); i++) {
-        if (FileName) {
-            if ((recs[i].fileName) && (!strcmp(recs[i].fileName,FileName)) && (recs[i].pid) && (!recs[i].changedByUser) ) {
-                isyslog("markad: continue: %s", recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                DebugLog("cStatusMarkAd::Continue(): index %d, pid %d, filename %s: resume markad process", i, recs[i].pid, recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                kill(recs[i].pid, SIGCONT);
-            }
-        }
-        else {
-            if ((recs[i].pid) && (!recs[i].changedByUser)) {
-                isyslog("markad: continue: %s", recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                DebugLog("cStatusMarkAd::Continue(): index %d, pid %d, filename %s: resume markad process", i, recs[i].pid, recs[i].fileName ? recs[i].fileName : "<nullptr>");
-                kill(recs[i].pid, SIGCONT);
-            }
-        }
+
+// remove cgroup of all markad jobs, move markad still running after terminate back to cgroup of VDR before
+void cStatusMarkAd::RemoveCgroup() {
+    if (!*cgroupDir) return;
+    FILE *file = fopen(*cString::sprintf("%s/cgroup.procs", *cgroupDir), "r");
+    if (file) {
+        int pid = 0;
+        while (fscanf(file, "%d", &pid) == 1) WriteCgroup("../cgroup.procs", *cString::sprintf("%d", pid));
+        fclose(file);
     }
+    if (rmdir(*cgroupDir) == 0) isyslog("markad: cgroup %s removed", *cgroupDir);
+    else esyslog("markad: remove cgroup %s failed, errno %d", *cgroupDir, errno);
+    cgroupDir = nullptr;
+}
+
+
+bool cStatusMarkAd::WriteCgroup(const char *file, const char *value) {
+    if (!file || !value) return false;
+    cString fileName = cString::sprintf("%s/%s", *cgroupDir, file);
+    int fd = open(*fileName, O_WRONLY);
+    if (fd < 0) return false;  // controller not available
+    bool ok = (write(fd, value, strlen(value)) == static_cast<ssize_t>(strlen(value)));
+    close(fd);
+    if (!ok) DebugLog("cStatusMarkAd::WriteCgroup(): write %s to %s failed, errno %d", value, *fileName, errno);
+    return ok;
 }
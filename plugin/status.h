@@ -8,6 +8,7 @@
 #define __status_h_
 
 #include <vdr/status.h>
+#include <vdr/thread.h>
 #include "setup.h"
 
 #if __GNUC__ > 3
@@ -30,7 +31,8 @@ struct sRecording {
     char        *title             = nullptr;
     char        *fileName          = nullptr;
     pid_t        pid               = 0;
-    char         status            = 0;        // R=running
+    char         status            = 0;        // Q=queued      -> waiting in job queue for a free markad slot
+    // R=running
     // S=sleeping   -> markad sleeping to wait for new recording data
     // D=inactive
     // Z=zombie
@@ -61,6 +63,14 @@ struct sRecording {
     time_t       vpsPauseStartTime = 0;
     time_t       vpsPauseStopTime  = 0;
     cEpgEventLog *epgEventLog;
+    // job
+    bool         recordingActive   = false;    // VDR is still recording, job of a finished recording has priority
+    char        *jobArgs           = nullptr;  // markad arguments, only set while job is queued
+    time_t       queueTime         = 0;        // time job was queued
+    int          jobLength         = 0;        // length of recording in s, short jobs have priority
+    int          statusFd          = -1;       // read end of markad status pipe, EOF if markad exits
+    pid_t        childPid          = 0;        // pid of shell used to start markad
+    bool         logoJob           = false;    // markad only extracts logo from an existing recording, lowest priority
 };
 
 
@@ -86,6 +96,14 @@ private:
 class cEpgHandlerMarkad;
 
 
+// graduated throttling of running markad, level is selected by count of active recordings and replays
+#define THROTTLE_LEVELS 3
+
+// logo preparation for channels of upcoming timers
+#define PREPARE_LOGOS_INTERVAL  600     // check timers every 10 min
+#define PREPARE_LOGOS_AHEAD   86400     // prepare logos for timers starting within next 24h
+
+
 // --- cStatusMarkAd
 class cStatusMarkAd : public cStatus {
 private:
@@ -96,17 +114,37 @@ private:
     int             actpos            = 0;
     struct          setup *setup      = nullptr;
     int             runningRecordings = 0;
+    time_t          lastSchedule      = 0;
+    cMutex          jobMutex;
+    int             throttleLevel     = 0;
+    cString         cgroupDir;                // cgroup v2 of all markad jobs, empty if not available
+    bool            jobsPaused        = false;    // true if markad jobs are stopped with SIGTSTP, only without cgroup
+    time_t          lastPrepareLogos  = 0;
+    cStringList     logoSearched;             // recordings with logo search done, do not search again
 
-    bool getPid(int Position);
     bool getStatus(int Position);
+    bool readProcStatus(int Position);
+    bool PollJob(const int pos);
+    int NextJob(const time_t now);
+    int JobSlots(const int running);
+    bool Launch(const int pos);
     bool Replaying();
     int Get(const char *FileName, const char *Name = nullptr);
     int Add(const char *Name, const char *FileName, sRecording *recording);
     void Remove(int pos, bool Kill = false);
     void Remove(const char *Name, bool Kill = false);
-    void Pause(const char *FileName, bool force);
-    void Continue(const char *FileName);
+    int ThrottleLevel();
+    void Throttle();
+    void Pause(const bool pause);
+    void MoveToCgroup(const int pos);
+    void InitCgroup();
+    void RemoveCgroup();
+    bool WriteCgroup(const char *file, const char *value);
+    bool AutoLogo();
     bool LogoExists(const cDevice *Device, const char *FileName);
+    cString LogoRecording(const tChannelID channelID, const char *cname, const bool withLogo);
+    bool AddLogoJob(const char *channelName, const char *FileName);
+    void CopyLogo(const char *FileName, const sRecording *recording);
     void GetEventID(const cDevice *Device,const char *Name, sRecording *recording);
     void SaveVPSTimer(const char *FileName, const bool timerVPS);
     void SaveVPSEvents(const int index);
@@ -127,6 +165,8 @@ public:
     void RefreshStatus(void);
     bool GetNextActive(struct sRecording **RecEntry);
     bool Start(const char *Name, const char *FileName, sRecording *recording);
+    void Schedule(const bool force);
+    void PrepareLogos();
     int Get_EIT_EventID(const sRecording *recording, const cEvent *event, const SI::EIT::Event *eitEvent, const cSchedule *schedule, const bool nextEvent);
     void FindRecording(const cEvent *event, const SI::EIT::Event *eitEvent, const cSchedule *Schedule);
     void SetVPSStatus(const int index, int runningStatus, const bool eventEIT);